@@ -4,6 +4,16 @@
 #include "CommonModules.h"
 #include "FileIO.h"
 
-ProcessorErrorCode AssembleFile (TextBuffer *text, FileBuffer *file, int binaryDescriptor, int listingDescriptor);
+const size_t MAX_STREAMED_LINE_LENGTH = 1 << 20;
+const size_t MAX_ASSEMBLY_THREADS     = 64;
+const size_t MIN_CHUNK_LINES          = 4096;     // smaller pieces of the source are not worth a thread
+const size_t INITIAL_CONSTANTS_CAPACITY = 1024;   // bytes of data directives
+
+ProcessorErrorCode AssembleFile       (TextBuffer *text, FileBuffer *file, int binaryDescriptor, int listingDescriptor);
+// Same binary and listing as AssembleFile gives. Zero threads count means a thread per processor
+ProcessorErrorCode ParallelAssembleFile (TextBuffer *text, int binaryDescriptor, int listingDescriptor, size_t threadsCount);
+// Source is read and code is written in pieces, so only labels and label references stay in memory.
+// Binary descriptor has to be opened for reading too
+ProcessorErrorCode StreamAssembleFile (int sourceDescriptor, int binaryDescriptor, int listingDescriptor);
 
 #endif
@@ -2,11 +2,43 @@
 #define FILE_FUNCTIONS_H_
 
 #include <cstddef>
+#include <stdio.h>
 
 #include "AssemblyHeader.h"
 #include "Buffer.h"
 #include "CommonModules.h"
+#include "Label.h"
 
-ProcessorErrorCode WriteDataToFiles (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer, int binaryDescriptor, int listingDescriptor);
+// Binary gets code and symbols sections, debug lines are added in debug mode and constants if the source has data directives
+ProcessorErrorCode WriteDataToFiles (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, Buffer <Label> *labelsBuffer,
+                                        Buffer <DebugInfoChunk> *debugInfoBuffer, Buffer <char> *constantsBuffer,
+                                        int binaryDescriptor, int listingDescriptor);
+
+const size_t STREAM_BUFFER_SIZE = 1 << 20;      // code, listing, debug lines and constants are flushed when they take that many bytes
+
+// Binary written while the source is compiled. Code goes to the file right away, listing, debug lines and constants wait
+// in temporary files, as the header and the sections before them are known only when the code ends
+struct CodeStream {
+    int    binaryDescriptor  = -1;              // opened for reading too, code is read back for its checksum
+    int    listingDescriptor = -1;
+
+    FILE  *listingFile       = NULL;
+    FILE  *debugInfoFile     = NULL;
+    FILE  *constantsFile     = NULL;              // created by the first data directive
+
+    size_t sectionsCount     = 0;                 // without constants
+    size_t codeOffset        = 0;
+    size_t codeSize          = 0;               // written to the file
+};
+
+ProcessorErrorCode OpenCodeStream    (CodeStream *stream, int binaryDescriptor, int listingDescriptor);
+// Buffers are written out and emptied
+ProcessorErrorCode FlushCodeStream   (CodeStream *stream, Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer,
+                                        Buffer <DebugInfoChunk> *debugInfoBuffer, Buffer <char> *constantsBuffer);
+// Overwrites already flushed code
+ProcessorErrorCode PatchStreamedCode (CodeStream *stream, size_t address, const void *data, size_t size);
+// Writes the remaining sections, header and listing. Stream is destroyed in any case
+ProcessorErrorCode CloseCodeStream   (CodeStream *stream, Buffer <Label> *labelsBuffer);
+ProcessorErrorCode DestroyCodeStream (CodeStream *stream);
 
 #endif
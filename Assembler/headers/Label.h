@@ -3,22 +3,52 @@
 
 #include <string.h>
 #include <stddef.h>
+#include <stdint.h>
 
+#include "Buffer.h"
 #include "CommonModules.h"
 #include "CustomAssert.h"
 #include "Logger.h"
 
-const size_t LABEL_NAME_LENGTH = 128;
+const size_t INITIAL_LABELS_CAPACITY = 128;
 
+// Name points into the source text or into the names kept by the label table, and is not null-terminated
 struct Label {
-    char name [LABEL_NAME_LENGTH] = "";
-    long long address = -1;
+    const char *name       = NULL;
+    size_t      nameLength = 0;
+    uint64_t    hash       = 0;
+    long long   address    = -1;
 };
 
-ProcessorErrorCode InitLabel (Label *label, char *name, long long address);
+// Use of a label defined later in the source. Address is written over the placeholder when assembly ends
+struct LabelReference {
+    Label  label            = {};
+    size_t immediateAddress = 0;                // of the int32 immediate in the binary
+};
+
+// Open addressing with linear probing. Labels are kept in definition order, slots hold their indices
+struct LabelTable {
+    Buffer <Label> labels = {0, 0, NULL};
+    size_t *slots         = NULL;               // label index plus one, zero is an empty slot
+    size_t  slotsCount    = 0;                  // power of two, at least twice as many as labels
+
+    bool            copyNames  = false;         // set when the source text does not outlive the table
+    Buffer <char *> ownedNames = {0, 0, NULL};
+
+    // labels of a source piece compiled apart from others. Their addresses are counted from the piece beginning,
+    // so label uses are not resolved by the table and are always left to be patched
+    bool            isRelative = false;
+};
+
+ProcessorErrorCode InitLabel (Label *label, const char *name, size_t nameLength, long long address);
+
+ProcessorErrorCode InitLabelTable    (LabelTable *table, size_t capacity);
+ProcessorErrorCode DestroyLabelTable (LabelTable *table);
 
-long long LabelComparator          (void *value1, void *value2);
-long long LabelComparatorByName    (void *value1, void *value2);
-long long LabelComparatorByAddress (void *value1, void *value2);
+// The first definition of a label is kept. Name is copied to the table if it copies names
+ProcessorErrorCode AddLabel  (LabelTable *table, Label *label);
+// Label name is replaced with a copy, which lives as long as the table
+ProcessorErrorCode KeepLabelName (LabelTable *table, Label *label);
+Label             *FindLabel (LabelTable *table, Label *label);
 
 #endif
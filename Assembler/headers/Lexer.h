@@ -0,0 +1,49 @@
+#ifndef LEXER_H_
+#define LEXER_H_
+
+#include <stddef.h>
+
+#include "Buffer.h"
+#include "CommonModules.h"
+#include "Registers.h"
+#include "TextTypes.h"
+
+const size_t MAX_LINE_TOKENS = 8;
+
+const char DATA_DIRECTIVE [] = ".data";
+
+enum TokenType {
+    MNEMONIC_TOKEN         = 0,                 // the first word of the line
+    LABEL_DEFINITION_TOKEN = 1,                 // the first word followed by ':'
+    OPEN_BRACKET_TOKEN     = 2,
+    CLOSE_BRACKET_TOKEN    = 3,
+    PLUS_TOKEN             = 4,
+    REGISTER_TOKEN         = 5,
+    IMMEDIATE_TOKEN        = 6,
+    LABEL_TOKEN            = 7,                 // any other word
+};
+
+// Token text is not copied and is not null-terminated
+struct Token {
+    TokenType     type          = MNEMONIC_TOKEN;
+    const char   *begin         = NULL;
+    size_t        length        = 0;
+
+    elem_t        value         = 0;            // of immediate
+    unsigned char registerIndex = REGISTER_COUNT;
+};
+
+struct TokenizedLine {
+    Token  tokens [MAX_LINE_TOKENS] = {};
+    size_t tokensCount              = 0;
+};
+
+// Splits the line in one scan without allocations. Comment after ';' is skipped, blank line has no tokens
+ProcessorErrorCode TokenizeLine (TextLine *line, TokenizedLine *tokenizedLine, int lineNumber);
+
+// Data directive is ".data [address] value value ...". Its values are read by a separate scan, so their count is not limited
+bool               IsDataDirective       (TextLine *line);
+// Values are appended to the buffer as elem_t
+ProcessorErrorCode TokenizeDataDirective (TextLine *line, size_t *address, Buffer <char> *valuesBuffer, int lineNumber);
+
+#endif
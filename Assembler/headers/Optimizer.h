@@ -0,0 +1,40 @@
+#ifndef OPTIMIZER_H_
+#define OPTIMIZER_H_
+
+#include <math.h>
+#include <stddef.h>
+
+#include "Buffer.h"
+#include "CommonModules.h"
+#include "Label.h"
+#include "TextTypes.h"
+
+// Source line kept between parsing and emission, so the code can be rewritten before it gets addresses. Blank lines are not kept
+struct ParsedLine {
+    bool                 isLabel     = false;   // label definition, otherwise an instruction
+    bool                 isData      = false;   // data directive, its values are already in the constants
+    bool                 isRemoved   = false;   // removed instruction has no code, but stays in the listing
+
+    AssemblerInstruction instruction = {"", {0, 0}, LINEAR_FLOW, NULL};
+    InstructionArguments arguments   = {NAN, REGISTER_COUNT};
+    Label                label       = {};      // defined by the line or used as the argument
+
+    TextLine            *line        = NULL;
+    int                  lineNumber  = 0;
+};
+
+struct OptimizationStats {
+    size_t unreachableCount = 0;                // instructions of blocks which can not be reached from the program beginning
+    size_t foldedCount      = 0;                // operations on immediates computed by the assembler and their pushes
+    size_t peepholeCount    = 0;                // sequences which do nothing
+};
+
+// Removes unreachable code, then folds constants and removes useless sequences in every basic block.
+// Lines are only marked as removed. Program which may jump to numeric addresses is not optimized, as its code can not be moved.
+// Jump through a register or memory counts as numeric when the program pushes or stores any number which is not a label
+ProcessorErrorCode OptimizeProgram (Buffer <ParsedLine> *program, OptimizationStats *stats);
+
+void SetOptimization       (bool optimization);
+bool IsOptimizationEnabled ();
+
+#endif
@@ -1,6 +1,8 @@
 #include <bits/types/FILE.h>
 #include <cstdio>
+#include <fcntl.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "AssemblyHeader.h"
 #include "CommonModules.h"
@@ -11,50 +13,86 @@
 #include "MessageHandler.h"
 #include "TextTypes.h"
 #include "Assembler.h"
+#include "Optimizer.h"
 
-static char *SourceFile  = NULL;
-static char *ListingFile = NULL;
-static char *BinaryFile  = "a.out";
+static char  *SourceFile   = NULL;
+static char  *ListingFile  = NULL;
+static char  *BinaryFile   = "a.out";
+static bool   StreamMode   = false;
+static size_t ThreadsCount = 1;
 
 void AddSource       (char **arguments);
 void AddBinary       (char **arguments);
 void AddListing      (char **arguments);
 void EnableDebugMode (char **arguments);
+void EnableCompression (char **arguments);
+void EnableStreamMode  (char **arguments);
+void SetThreadsCount   (char **arguments);
+void EnableOptimization (char **arguments);
 
 static bool PrepareForAssembling (FileBuffer *fileBuffer, TextBuffer *textBuffer, int *binaryDescriptor, int *listingDescriptor);
+static bool PrepareForStreaming  (int *sourceDescriptor, int *binaryDescriptor, int *listingDescriptor);
+static bool OpenListingFile      (int *listingDescriptor);
+static void FinishAssembling     (ProcessorErrorCode errorCode, int binaryDescriptor, int listingDescriptor);
 
 int main (int argc, char **argv) {
     PushLog (1);
 
     SetGlobalMessagePrefix ("Assembler");
     SetDebugMode (false);
+    SetCodeCompression (false);
+    SetOptimization (false);
 
     //Process console line arguments
-    register_flag ("-s", "--source",  AddSource,       1);
-    register_flag ("-l", "--listing", AddListing,      1);
-    register_flag ("-o", "--output",  AddBinary,       1);
-    register_flag ("-d", "--debug",   EnableDebugMode, 0);
+    register_flag ("-s", "--source",   AddSource,         1);
+    register_flag ("-l", "--listing",  AddListing,        1);
+    register_flag ("-o", "--output",   AddBinary,         1);
+    register_flag ("-d", "--debug",    EnableDebugMode,   0);
+    register_flag ("-z", "--compress", EnableCompression, 0);
+    register_flag ("-t", "--stream",   EnableStreamMode,  0);
+    register_flag ("-j", "--jobs",     SetThreadsCount,   1);
+    register_flag ("-O", "--optimize", EnableOptimization, 0);
     parse_flags (argc, argv);
 
+    int binaryDescriptor  = -1;
+    int listingDescriptor = -1;
+
+    if (StreamMode) {
+        int sourceDescriptor = -1;
+
+        if (ThreadsCount != 1) {
+            PrintWarningMessage (NO_PROCESSOR_ERRORS, "Streaming assembly is done in one thread", NULL, NULL, -1);
+        }
+
+        if (IsOptimizationEnabled ()) {
+            PrintWarningMessage (NO_PROCESSOR_ERRORS, "Code is not optimized in streaming mode", NULL, NULL, -1);
+        }
+
+        if (PrepareForStreaming (&sourceDescriptor, &binaryDescriptor, &listingDescriptor)) {
+            FinishAssembling (StreamAssembleFile (sourceDescriptor, binaryDescriptor, listingDescriptor), binaryDescriptor, listingDescriptor);
+        }
+
+        if (sourceDescriptor != -1)
+            close (sourceDescriptor);
+
+        RETURN 0;
+    }
+
     //Process source files
     FileBuffer fileBuffer = {};
     TextBuffer textBuffer = {};
 
-    int binaryDescriptor  = -1;
-    int listingDescriptor = -1;
+    // optimizer needs the whole program parsed before any code is emitted
+    if (IsOptimizationEnabled () && ThreadsCount != 1) {
+        PrintWarningMessage (NO_PROCESSOR_ERRORS, "Optimized assembly is done in one thread", NULL, NULL, -1);
+        ThreadsCount = 1;
+    }
 
     if (PrepareForAssembling (&fileBuffer, &textBuffer, &binaryDescriptor, &listingDescriptor)) {
-        ProcessorErrorCode errorCode = AssembleFile (&textBuffer, &fileBuffer, binaryDescriptor, listingDescriptor);
-
-        CloseFile (binaryDescriptor);
-        if (listingDescriptor != -1)
-            CloseFile (listingDescriptor);
+        ProcessorErrorCode errorCode = ThreadsCount == 1 ? AssembleFile (&textBuffer, &fileBuffer, binaryDescriptor, listingDescriptor) :
+                                            ParallelAssembleFile (&textBuffer, binaryDescriptor, listingDescriptor, ThreadsCount);
 
-        if (errorCode != NO_PROCESSOR_ERRORS) {
-            if (remove (BinaryFile)) {
-                PrintErrorMessage (OUTPUT_FILE_ERROR, "Unable to delete corrupted binary file", NULL, NULL, -1);
-            }
-        }
+        FinishAssembling (errorCode, binaryDescriptor, listingDescriptor);
     }
 
     DestroyFileBuffer (&fileBuffer);
@@ -125,6 +163,34 @@ static bool PrepareForAssembling (FileBuffer *fileBuffer, TextBuffer *textBuffer
             RETURN false;
         }
 
+    RETURN OpenListingFile (listingDescriptor);
+}
+
+// Source is not read here, streaming assembler reads it in pieces
+static bool PrepareForStreaming (int *sourceDescriptor, int *binaryDescriptor, int *listingDescriptor) {
+    PushLog (2);
+
+    if (!SourceFile) {
+        RETURN false;
+    }
+
+    if ((*sourceDescriptor = open (SourceFile, O_RDONLY)) == -1) {
+        PrintErrorMessage (INPUT_FILE_ERROR, "Error occuried while opening source file", NULL, NULL, -1);
+        RETURN false;
+    }
+
+    // code is read back to compute its checksum
+    if ((*binaryDescriptor = open (BinaryFile, O_RDWR | O_CREAT | O_TRUNC, 0644)) == -1) {
+        PrintErrorMessage (OUTPUT_FILE_ERROR, "Error occuried while opening binary file", NULL, NULL, -1);
+        RETURN false;
+    }
+
+    RETURN OpenListingFile (listingDescriptor);
+}
+
+static bool OpenListingFile (int *listingDescriptor) {
+    PushLog (3);
+
     if (ListingFile) {
         if ((*listingDescriptor = OpenFileWrite (ListingFile)) == -1) {
             PrintErrorMessage (OUTPUT_FILE_ERROR, "Error occuried while opening listing file", NULL, NULL, -1);
@@ -147,4 +213,62 @@ void EnableDebugMode (char **arguments) {
     RETURN;
 }
 
+void EnableCompression (char **arguments) {
+    PushLog (3);
 
+    SetCodeCompression (true);
+
+    RETURN;
+}
+
+void EnableStreamMode (char **arguments) {
+    PushLog (3);
+
+    StreamMode = true;
+
+    RETURN;
+}
+
+// Zero means a thread per processor
+void SetThreadsCount (char **arguments) {
+    PushLog (3);
+
+    custom_assert (arguments,     pointer_is_null, (void)0);
+    custom_assert (arguments [0], pointer_is_null, (void)0);
+
+    char *countEnd = NULL;
+    long  count    = strtol (arguments [0], &countEnd, 10);
+
+    if (countEnd == arguments [0] || *countEnd != '\0' || count < 0) {
+        PrintWarningMessage (NO_PROCESSOR_ERRORS, "Wrong threads count. Assembling in one thread.", NULL, NULL, -1);
+        RETURN;
+    }
+
+    ThreadsCount = (size_t) count;
+
+    RETURN;
+}
+
+void EnableOptimization (char **arguments) {
+    PushLog (3);
+
+    SetOptimization (true);
+
+    RETURN;
+}
+
+static void FinishAssembling (ProcessorErrorCode errorCode, int binaryDescriptor, int listingDescriptor) {
+    PushLog (2);
+
+    CloseFile (binaryDescriptor);
+    if (listingDescriptor != -1)
+        CloseFile (listingDescriptor);
+
+    if (errorCode != NO_PROCESSOR_ERRORS) {
+        if (remove (BinaryFile)) {
+            PrintErrorMessage (OUTPUT_FILE_ERROR, "Unable to delete corrupted binary file", NULL, NULL, -1);
+        }
+    }
+
+    RETURN;
+}
@@ -1,11 +1,14 @@
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <pthread.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include "Assembler.h"
 #include "Buffer.h"
@@ -20,32 +23,103 @@
 #include "Stack/Stack.h"
 #include "DSLFunctions.h"
 #include "Label.h"
+#include "Lexer.h"
+#include "Optimizer.h"
 #include "StringProcessing.h"
 #include "FileFunctions.h"
 
-const size_t MAX_LABELS_COUNT    = 128;
+static ProcessorErrorCode DoCompilationPass (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable,
+                                                Buffer <LabelReference> *referencesBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer,
+                                                Buffer <char> *constantsBuffer, TextBuffer *text);
+static ProcessorErrorCode DoOptimizingPass  (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable,
+                                                Buffer <LabelReference> *referencesBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer,
+                                                Buffer <char> *constantsBuffer, TextBuffer *text);
+static void               ReportOptimization (OptimizationStats *stats, size_t instructionsCount);
+static ProcessorErrorCode CompileLine       (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable,
+                                                Buffer <LabelReference> *referencesBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer,
+                                                Buffer <char> *constantsBuffer, size_t codeBase, TextLine *line, int lineNumber);
+static ProcessorErrorCode ParseLine         (ParsedLine *parsedLine, LabelTable *labelTable, Buffer <char> *constantsBuffer,
+                                                TextLine *line, int lineNumber);
+static ProcessorErrorCode CompileDataDirective (Buffer <char> *constantsBuffer, TextLine *line, int lineNumber);
+static ProcessorErrorCode EmitParsedLine    (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable,
+                                                Buffer <LabelReference> *referencesBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer, size_t codeBase,
+                                                ParsedLine *parsedLine);
+static ProcessorErrorCode ResolveLabelReferences (Buffer <char> *binaryBuffer, LabelTable *labelTable, Buffer <LabelReference> *referencesBuffer);
+
+static ProcessorErrorCode DoStreamingPass      (int sourceDescriptor, Buffer <char> *sourceBuffer, CodeStream *stream, Buffer <char> *binaryBuffer,
+                                                    Buffer <char> *listingBuffer, LabelTable *labelTable, Buffer <LabelReference> *referencesBuffer,
+                                                    Buffer <DebugInfoChunk> *debugInfoBuffer, Buffer <char> *constantsBuffer);
+static ProcessorErrorCode CompileStreamedLine  (CodeStream *stream, Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable,
+                                                    Buffer <LabelReference> *referencesBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer,
+                                                    Buffer <char> *constantsBuffer, TextLine *line, int lineNumber);
+static ProcessorErrorCode PatchLabelReferences (CodeStream *stream, LabelTable *labelTable, Buffer <LabelReference> *referencesBuffer);
+
+struct ParallelAssembly;
+
+// Piece of the source compiled by its own thread. Addresses are counted from the piece beginning until pieces are joined
+struct AssemblyChunk {
+    ParallelAssembly       *assembly         = NULL;
+
+    TextBuffer              text             = {};      // lines of the whole source
+    size_t                  firstLineIndex   = 0;
+
+    Buffer <char>           binaryBuffer     = {0, 0, NULL};
+    Buffer <char>           listingBuffer    = {0, 0, NULL};
+    LabelTable              labelTable       = {};
+    Buffer <LabelReference> referencesBuffer = {0, 0, NULL};
+    Buffer <DebugInfoChunk> debugInfoBuffer  = {0, 0, NULL};
+    Buffer <char>           constantsBuffer  = {0, 0, NULL};
+
+    size_t                  codeOffset       = 0;       // in the joined code
+    size_t                  debugInfoOffset  = 0;       // in the joined debug info
+
+    ProcessorErrorCode      errorCode        = NO_PROCESSOR_ERRORS;
+};
+
+struct ParallelAssembly {
+    AssemblyChunk          *chunks           = NULL;
+    size_t                  chunksCount      = 0;
+
+    Buffer <char>           binaryBuffer     = {0, 0, NULL};
+    Buffer <char>           listingBuffer    = {0, 0, NULL};
+    LabelTable              labelTable       = {};
+    Buffer <DebugInfoChunk> debugInfoBuffer  = {0, 0, NULL};
+    Buffer <char>           constantsBuffer  = {0, 0, NULL};
+};
+
+static ProcessorErrorCode RunChunkThreads (ParallelAssembly *assembly, void *(*chunkFunction) (void *));
+static void              *CompileChunk    (void *chunkPointer);
+static void              *RelocateChunk   (void *chunkPointer);
 
-static ProcessorErrorCode DoCompilationPass (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer,
-                                                Buffer <Label> *labelsBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer, TextBuffer *text, size_t *commandsCount);
-static ProcessorErrorCode CompileLine       (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer,
-                                                Buffer <Label> *labelsBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer, TextLine *line, int lineNumber);
+static ProcessorErrorCode JoinChunkLabels    (ParallelAssembly *assembly);
+static ProcessorErrorCode JoinChunkListings  (ParallelAssembly *assembly);
+static ProcessorErrorCode JoinChunkConstants (ParallelAssembly *assembly);
+static ProcessorErrorCode RebaseListing      (Buffer <char> *listingBuffer, size_t codeOffset);
 
-static ProcessorErrorCode CompileInstructionOpcode        (TextLine *line, AssemblerInstruction *instruction, ArgumentsType *permittedArguments, int lineNumber);
-static ProcessorErrorCode CompileInstructionArgumentsData (AssemblerInstruction *instruction, TextLine *line, InstructionArguments *arguments,
-                                                                ArgumentsType permittedArguments, Buffer <Label> *labelsBuffer, int lineNumber);
+static void DestroyParallelAssembly (ParallelAssembly *assembly);
 
-static ProcessorErrorCode ReadRamBrackets (AssemblerInstruction *instruction, TextLine *line, ssize_t *offset, ArgumentsType permittedArguments, int lineNumber);
+static ProcessorErrorCode CompileInstructionOpcode        (TextLine *line, Token *mnemonic, AssemblerInstruction *instruction,
+                                                                ArgumentsType *permittedArguments, int lineNumber);
+static ProcessorErrorCode CompileInstructionArgumentsData (AssemblerInstruction *instruction, TextLine *line, Token *argumentTokens, size_t argumentsCount,
+                                                                InstructionArguments *arguments, ArgumentsType permittedArguments, LabelTable *labelTable,
+                                                                Label *argumentLabel, int lineNumber);
 
-static ProcessorErrorCode SaveLabel              (Buffer <char> *binaryBuffer, Buffer <Label> *labelsBuffer,  TextLine *sourceLine, char *labelName);
-static ProcessorErrorCode EmitLabelListing       (Buffer <char> *binaryBuffer, Buffer <char>  *listingBuffer, TextLine *sourceLine, int   lineNumber);
-static ProcessorErrorCode EmitInstructionListing (Buffer <char> *binaryBuffer, Buffer <char>  *listingBuffer, AssemblerInstruction *instruction,
+static ProcessorErrorCode ReadRamBrackets (AssemblerInstruction *instruction, TextLine *line, Token **arguments, size_t *argumentsCount,
+                                            ArgumentsType permittedArguments, int lineNumber);
+
+static ProcessorErrorCode SaveLabel              (size_t address, LabelTable    *labelTable,    Label    *label);
+static ProcessorErrorCode EmitLabelListing       (size_t address, Buffer <char>  *listingBuffer, TextLine *sourceLine, int   lineNumber);
+static ProcessorErrorCode EmitListingLine        (Buffer <char> *listingBuffer, const char *listingInfo, TextLine *sourceLine);
+static ProcessorErrorCode EmitInstructionListing (size_t address, Buffer <char>  *listingBuffer, AssemblerInstruction *instruction,
                                                     InstructionArguments *arguments, TextLine *sourceLine, int lineNumber);
 static ProcessorErrorCode EmitInstructionBinary  (Buffer <char> *binaryBuffer, AssemblerInstruction *instruction,
                                                     InstructionArguments *arguments, TextLine *sourceLine, int lineNumber);
 
-static ProcessorErrorCode CreateAssemblyBuffers  (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, Buffer <Label> *labelsBuffer,
+static ImmediateFormat GetImmediateFormat (elem_t value);
+
+static ProcessorErrorCode CreateAssemblyBuffers  (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable,
                                                     FileBuffer *sourceFile, TextBuffer *sourceText);
-static ProcessorErrorCode DestroyAssemblyBuffers (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, Buffer <Label> *labelsBuffer);
+static ProcessorErrorCode DestroyAssemblyBuffers (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable);
 
 ProcessorErrorCode AssembleFile (TextBuffer *text, FileBuffer *file, int binaryDescriptor, int listingDescriptor) {
     PushLog (1);
@@ -56,57 +130,202 @@ ProcessorErrorCode AssembleFile (TextBuffer *text, FileBuffer *file, int binaryD
 
     Buffer <char>            binaryBuffer    = {0, 0, NULL};
     Buffer <char>            listingBuffer   = {0, 0, NULL};
-    Buffer <Label>           labelsBuffer    = {0, 0, NULL};
-    Buffer <DebugInfoChunk> debugInfoBuffer  = {0, 0, NULL};
+    LabelTable               labelTable       = {};
+    Buffer <LabelReference>  referencesBuffer = {0, 0, NULL};
+    Buffer <DebugInfoChunk>  debugInfoBuffer  = {0, 0, NULL};
+    Buffer <char>            constantsBuffer  = {0, 0, NULL};
 
     DeleteExcessWhitespaces (text);
 
     PrintSuccessMessage ("Starting assembly...", NULL);
 
-    ProgramErrorCheck (CreateAssemblyBuffers (&binaryBuffer, &listingBuffer, &labelsBuffer, file, text), "Error occuried while creating file buffers");
+    ProgramErrorCheck (CreateAssemblyBuffers (&binaryBuffer, &listingBuffer, &labelTable, file, text), "Error occuried while creating file buffers");
+
+    #define TerminateIfErrorsWereFound(message, ...)                                                                                    \
+        do {                                                                                                                            \
+            ProcessorErrorCode errorCode = NO_PROCESSOR_ERRORS;                                                                         \
+            if ((errorCode = (__VA_ARGS__)) != NO_PROCESSOR_ERRORS) {                                                                   \
+                errorCode = (ProcessorErrorCode) (errorCode | DestroyAssemblyBuffers (&binaryBuffer, &listingBuffer, &labelTable));   \
+                errorCode = (ProcessorErrorCode) (errorCode | DestroyBuffer (&referencesBuffer));                                       \
+                errorCode = (ProcessorErrorCode) (errorCode | DestroyBuffer (&debugInfoBuffer));                                        \
+                errorCode = (ProcessorErrorCode) (errorCode | DestroyBuffer (&constantsBuffer));                                        \
+                ProgramErrorCheck (errorCode, message);                                                                                 \
+            }                                                                                                                           \
+        } while (0)
+
+    // every line has at most one instruction
+    TerminateIfErrorsWereFound ("Unable to create debug info buffer",       InitBuffer (&debugInfoBuffer,  text->line_count + 1));
+    TerminateIfErrorsWereFound ("Unable to create label references buffer", InitBuffer (&referencesBuffer, INITIAL_LABELS_CAPACITY));
+    TerminateIfErrorsWereFound ("Unable to create constants buffer",        InitBuffer (&constantsBuffer,  INITIAL_CONSTANTS_CAPACITY));
+
+    if (IsOptimizationEnabled ()) {
+        TerminateIfErrorsWereFound ("Compilation error", DoOptimizingPass  (&binaryBuffer, &listingBuffer, &labelTable,
+                                        &referencesBuffer, &debugInfoBuffer, &constantsBuffer, text));
+    } else {
+        TerminateIfErrorsWereFound ("Compilation error", DoCompilationPass (&binaryBuffer, &listingBuffer, &labelTable,
+                                        &referencesBuffer, &debugInfoBuffer, &constantsBuffer, text));
+    }
+    TerminateIfErrorsWereFound ("Error occuried while resolving labels", ResolveLabelReferences (&binaryBuffer, &labelTable,
+                                    &referencesBuffer));
+    TerminateIfErrorsWereFound ("Error occuried while writing data to output file", WriteDataToFiles (&binaryBuffer, &listingBuffer,
+                                    &labelTable.labels, &debugInfoBuffer, &constantsBuffer, binaryDescriptor, listingDescriptor));
+
+    #undef TerminateIfErrorsWereFound
+
+    ProgramErrorCheck (DestroyAssemblyBuffers (&binaryBuffer, &listingBuffer, &labelTable),
+                            "Error occuried while destroying assembly buffers");
+    DestroyBuffer (&referencesBuffer);
+    DestroyBuffer (&debugInfoBuffer);
+    DestroyBuffer (&constantsBuffer);
+
+    PrintSuccessMessage ("Assembly finished successfully!", NULL);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode StreamAssembleFile (int sourceDescriptor, int binaryDescriptor, int listingDescriptor) {
+    PushLog (1);
+
+    custom_assert (sourceDescriptor != -1, invalid_arguments, INPUT_FILE_ERROR);
+    custom_assert (binaryDescriptor != -1, invalid_arguments, OUTPUT_FILE_ERROR);
+
+    Buffer <char>            sourceBuffer     = {0, 0, NULL};
+    Buffer <char>            binaryBuffer     = {0, 0, NULL};
+    Buffer <char>            listingBuffer    = {0, 0, NULL};
+    LabelTable               labelTable       = {};
+    Buffer <LabelReference>  referencesBuffer = {0, 0, NULL};
+    Buffer <DebugInfoChunk>  debugInfoBuffer  = {0, 0, NULL};
+    Buffer <char>            constantsBuffer  = {0, 0, NULL};
+    CodeStream               stream           = {};
 
-    size_t commandsCount = 0;
+    PrintSuccessMessage ("Starting assembly...", NULL);
 
     #define TerminateIfErrorsWereFound(message, ...)                                                                                    \
         do {                                                                                                                            \
             ProcessorErrorCode errorCode = NO_PROCESSOR_ERRORS;                                                                         \
             if ((errorCode = (__VA_ARGS__)) != NO_PROCESSOR_ERRORS) {                                                                   \
-                errorCode = (ProcessorErrorCode) (errorCode | DestroyAssemblyBuffers (&binaryBuffer, &listingBuffer, &labelsBuffer));   \
+                errorCode = (ProcessorErrorCode) (errorCode | DestroyAssemblyBuffers (&binaryBuffer, &listingBuffer, &labelTable));   \
+                errorCode = (ProcessorErrorCode) (errorCode | DestroyBuffer (&sourceBuffer));                                           \
+                errorCode = (ProcessorErrorCode) (errorCode | DestroyBuffer (&referencesBuffer));                                       \
                 errorCode = (ProcessorErrorCode) (errorCode | DestroyBuffer (&debugInfoBuffer));                                        \
+                errorCode = (ProcessorErrorCode) (errorCode | DestroyBuffer (&constantsBuffer));                                        \
+                errorCode = (ProcessorErrorCode) (errorCode | DestroyCodeStream (&stream));                                             \
                 ProgramErrorCheck (errorCode, message);                                                                                 \
             }                                                                                                                           \
         } while (0)
 
-    TerminateIfErrorsWereFound("Compilation error", DoCompilationPass (&binaryBuffer, &listingBuffer, &labelsBuffer,
-                                    NULL, text, &commandsCount));
+    // buffers are flushed when they are half full, so a line never makes them grow
+    TerminateIfErrorsWereFound ("Unable to create source buffer",           InitBuffer (&sourceBuffer,     MAX_STREAMED_LINE_LENGTH + 1));
+    TerminateIfErrorsWereFound ("Unable to create binary buffer",           InitBuffer (&binaryBuffer,     STREAM_BUFFER_SIZE * 2));
+    TerminateIfErrorsWereFound ("Unable to create listing buffer",          InitBuffer (&listingBuffer,    STREAM_BUFFER_SIZE * 2));
+    TerminateIfErrorsWereFound ("Unable to create debug info buffer",       InitBuffer (&debugInfoBuffer,  STREAM_BUFFER_SIZE * 2 / sizeof (DebugInfoChunk)));
+    TerminateIfErrorsWereFound ("Unable to create constants buffer",        InitBuffer (&constantsBuffer,  STREAM_BUFFER_SIZE * 2));
+    TerminateIfErrorsWereFound ("Unable to create label references buffer", InitBuffer (&referencesBuffer, INITIAL_LABELS_CAPACITY));
+    TerminateIfErrorsWereFound ("Unable to create labels table",            InitLabelTable (&labelTable, INITIAL_LABELS_CAPACITY));
 
-    InitBuffer (&debugInfoBuffer, commandsCount);
+    labelTable.copyNames = true;
 
-    TerminateIfErrorsWereFound ("Compilation error", DoCompilationPass( &binaryBuffer, &listingBuffer, &labelsBuffer,
-                                    &debugInfoBuffer, text, NULL));
-    TerminateIfErrorsWereFound ("Error occuried while writing data to output file", WriteDataToFiles (&binaryBuffer, &listingBuffer,
-                                    &debugInfoBuffer, binaryDescriptor, listingDescriptor));
+    TerminateIfErrorsWereFound ("Unable to open binary for streaming", OpenCodeStream (&stream, binaryDescriptor, listingDescriptor));
+
+    TerminateIfErrorsWereFound ("Compilation error", DoStreamingPass (sourceDescriptor, &sourceBuffer, &stream, &binaryBuffer, &listingBuffer,
+                                    &labelTable, &referencesBuffer, &debugInfoBuffer, &constantsBuffer));
+    TerminateIfErrorsWereFound ("Error occuried while resolving labels", PatchLabelReferences (&stream, &labelTable, &referencesBuffer));
+    TerminateIfErrorsWereFound ("Error occuried while writing data to output file", CloseCodeStream (&stream, &labelTable.labels));
 
     #undef TerminateIfErrorsWereFound
 
-    ProgramErrorCheck (DestroyAssemblyBuffers (&binaryBuffer, &listingBuffer, &labelsBuffer),
+    ProgramErrorCheck (DestroyAssemblyBuffers (&binaryBuffer, &listingBuffer, &labelTable),
                             "Error occuried while destroying assembly buffers");
+    DestroyBuffer (&sourceBuffer);
+    DestroyBuffer (&referencesBuffer);
     DestroyBuffer (&debugInfoBuffer);
+    DestroyBuffer (&constantsBuffer);
 
     PrintSuccessMessage ("Assembly finished successfully!", NULL);
 
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode DoCompilationPass (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, Buffer <Label> *labelsBuffer,
-                                                Buffer <DebugInfoChunk> *debugInfoBuffer, TextBuffer *text, size_t *commandsCount) {
+// Pieces are compiled concurrently with their own labels, then their labels are joined in source order,
+// code of every piece gets its offset and label uses are patched concurrently again
+ProcessorErrorCode ParallelAssembleFile (TextBuffer *text, int binaryDescriptor, int listingDescriptor, size_t threadsCount) {
     PushLog (1);
 
-    custom_assert (binaryBuffer,  pointer_is_null, NO_BUFFER);
-    custom_assert (listingBuffer, pointer_is_null, NO_BUFFER);
-    custom_assert (labelsBuffer,  pointer_is_null, NO_BUFFER);
-    custom_assert (text,          pointer_is_null, NO_BUFFER);
-    custom_assert (text->lines,   pointer_is_null, NO_BUFFER);
+    custom_assert (text,        pointer_is_null, NO_BUFFER);
+    custom_assert (text->lines, pointer_is_null, NO_BUFFER);
+
+    if (threadsCount == 0) {
+        threadsCount = (size_t) sysconf (_SC_NPROCESSORS_ONLN);
+    }
+
+    if (threadsCount > MAX_ASSEMBLY_THREADS) {
+        threadsCount = MAX_ASSEMBLY_THREADS;
+    }
+
+    if (threadsCount > text->line_count / MIN_CHUNK_LINES) {
+        threadsCount = text->line_count / MIN_CHUNK_LINES;
+    }
+
+    if (threadsCount == 0) {
+        threadsCount = 1;
+    }
+
+    PrintSuccessMessage ("Starting assembly...", NULL);
+
+    ParallelAssembly assembly {};
+
+    assembly.chunks      = new AssemblyChunk [threadsCount];
+    assembly.chunksCount = threadsCount;
+
+    for (size_t chunkIndex = 0; chunkIndex < threadsCount; chunkIndex++) {
+        size_t firstLine = text->line_count *  chunkIndex      / threadsCount;
+        size_t lastLine  = text->line_count * (chunkIndex + 1) / threadsCount;
+
+        assembly.chunks [chunkIndex].assembly       = &assembly;
+        assembly.chunks [chunkIndex].text           = {text->lines + firstLine, lastLine - firstLine};
+        assembly.chunks [chunkIndex].firstLineIndex = firstLine;
+    }
+
+    #define TerminateIfErrorsWereFound(message, ...)                            \
+        do {                                                                    \
+            ProcessorErrorCode errorCode = (__VA_ARGS__);                       \
+            if (errorCode != NO_PROCESSOR_ERRORS) {                             \
+                DestroyParallelAssembly (&assembly);                            \
+                ProgramErrorCheck (errorCode, message);                         \
+            }                                                                   \
+        } while (0)
+
+    TerminateIfErrorsWereFound ("Compilation error",                      RunChunkThreads (&assembly, CompileChunk));
+    TerminateIfErrorsWereFound ("Error occuried while joining labels",    JoinChunkLabels (&assembly));
+    TerminateIfErrorsWereFound ("Error occuried while resolving labels",  RunChunkThreads (&assembly, RelocateChunk));
+    TerminateIfErrorsWereFound ("Error occuried while joining listings",  JoinChunkListings (&assembly));
+    TerminateIfErrorsWereFound ("Error occuried while joining constants", JoinChunkConstants (&assembly));
+    TerminateIfErrorsWereFound ("Error occuried while writing data to output file", WriteDataToFiles (&assembly.binaryBuffer,
+                                    &assembly.listingBuffer, &assembly.labelTable.labels, &assembly.debugInfoBuffer, &assembly.constantsBuffer,
+                                    binaryDescriptor, listingDescriptor));
+
+    #undef TerminateIfErrorsWereFound
+
+    DestroyParallelAssembly (&assembly);
+
+    char message [MAX_MESSAGE_LENGTH] = "";
+    snprintf (message, MAX_MESSAGE_LENGTH, "Assembly finished successfully on %lu threads!", threadsCount);
+    PrintSuccessMessage (message, NULL);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode DoCompilationPass (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable,
+                                                Buffer <LabelReference> *referencesBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer,
+                                                Buffer <char> *constantsBuffer, TextBuffer *text) {
+    PushLog (1);
+
+    custom_assert (binaryBuffer,     pointer_is_null, NO_BUFFER);
+    custom_assert (listingBuffer,    pointer_is_null, NO_BUFFER);
+    custom_assert (labelTable,       pointer_is_null, NO_BUFFER);
+    custom_assert (referencesBuffer, pointer_is_null, NO_BUFFER);
+    custom_assert (text,             pointer_is_null, NO_BUFFER);
+    custom_assert (text->lines,      pointer_is_null, NO_BUFFER);
 
     ProcessorErrorCode errorCode = NO_PROCESSOR_ERRORS;
 
@@ -114,97 +333,715 @@ static ProcessorErrorCode DoCompilationPass (Buffer <char> *binaryBuffer, Buffer
     listingBuffer->currentIndex = 0;
 
     for (size_t lineIndex = 0; lineIndex < text->line_count; lineIndex++) {
-        errorCode = CompileLine (binaryBuffer, listingBuffer, labelsBuffer, debugInfoBuffer, text->lines + lineIndex, (int) lineIndex + 1);
+        errorCode = CompileLine (binaryBuffer, listingBuffer, labelTable, referencesBuffer, debugInfoBuffer, constantsBuffer, 0,
+                                    text->lines + lineIndex, (int) lineIndex + 1);
 
         if (errorCode != BLANK_LINE) {
             ProgramErrorCheck (errorCode, "Something has gone wrong while compiling line");
+        }
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// The whole source is parsed before the code is emitted, so the optimizer sees all lines. Every label use is left to be patched
+static ProcessorErrorCode DoOptimizingPass (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable,
+                                                Buffer <LabelReference> *referencesBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer,
+                                                Buffer <char> *constantsBuffer, TextBuffer *text) {
+    PushLog (1);
+
+    custom_assert (binaryBuffer,     pointer_is_null, NO_BUFFER);
+    custom_assert (listingBuffer,    pointer_is_null, NO_BUFFER);
+    custom_assert (labelTable,       pointer_is_null, NO_BUFFER);
+    custom_assert (referencesBuffer, pointer_is_null, NO_BUFFER);
+    custom_assert (text,             pointer_is_null, NO_BUFFER);
+    custom_assert (text->lines,      pointer_is_null, NO_BUFFER);
+
+    Buffer <ParsedLine> program = {0, 0, NULL};
+
+    ProgramErrorCheck (InitBuffer (&program, text->line_count + 1), "Unable to create parsed lines buffer");
+
+    binaryBuffer->currentIndex  = 0;
+    listingBuffer->currentIndex = 0;
+
+    #define StopIfErrorsWereFound(message, ...)                 \
+        do {                                                    \
+            ProcessorErrorCode errorCode = (__VA_ARGS__);       \
+            if (errorCode != NO_PROCESSOR_ERRORS) {             \
+                DestroyBuffer (&program);                       \
+                ProgramErrorCheck (errorCode, message);         \
+            }                                                   \
+        } while (0)
+
+    for (size_t lineIndex = 0; lineIndex < text->line_count; lineIndex++) {
+        ParsedLine parsedLine {};
+
+        ProcessorErrorCode parseErrorCode = ParseLine (&parsedLine, labelTable, constantsBuffer, text->lines + lineIndex, (int) lineIndex + 1);
+
+        if (parseErrorCode == BLANK_LINE) {
+            continue;
+        }
+
+        StopIfErrorsWereFound ("Something has gone wrong while compiling line", parseErrorCode);
+        StopIfErrorsWereFound ("Error occuried while writing parsed line to a buffer", WriteDataToBuffer (&program, &parsedLine, 1));
+    }
+
+    OptimizationStats stats {};
+
+    StopIfErrorsWereFound ("Error occuried while optimizing code", OptimizeProgram (&program, &stats));
+
+    size_t instructionsCount = 0;
+
+    for (size_t lineIndex = 0; lineIndex < program.currentIndex; lineIndex++) {
+        instructionsCount += !program.data [lineIndex].isLabel && !program.data [lineIndex].isData;
+
+        StopIfErrorsWereFound ("Something has gone wrong while emitting line", EmitParsedLine (binaryBuffer, listingBuffer, labelTable,
+                                    referencesBuffer, debugInfoBuffer, 0, program.data + lineIndex));
+    }
+
+    #undef StopIfErrorsWereFound
+
+    DestroyBuffer (&program);
+
+    ReportOptimization (&stats, instructionsCount);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static void ReportOptimization (OptimizationStats *stats, size_t instructionsCount) {
+    PushLog (2);
+
+    custom_assert (stats, pointer_is_null, (void) 0);
 
-            if (commandsCount) {
-                (*commandsCount)++;
+    char message [MAX_MESSAGE_LENGTH] = "";
+
+    snprintf (message, MAX_MESSAGE_LENGTH, "Instructions removed by optimizer: %lu of %lu",
+                stats->unreachableCount + stats->foldedCount + stats->peepholeCount, instructionsCount);
+    PrintInfoMessage (message, NULL);
+
+    snprintf (message, MAX_MESSAGE_LENGTH, "    %-18s %lu", "unreachable code", stats->unreachableCount);
+    PrintInfoMessage (message, NULL);
+    snprintf (message, MAX_MESSAGE_LENGTH, "    %-18s %lu", "constant folding", stats->foldedCount);
+    PrintInfoMessage (message, NULL);
+    snprintf (message, MAX_MESSAGE_LENGTH, "    %-18s %lu", "peephole",         stats->peepholeCount);
+    PrintInfoMessage (message, NULL);
+
+    RETURN;
+}
+
+// Source is read into the buffer in pieces. Unfinished line is moved to the buffer beginning and completed by the next piece
+static ProcessorErrorCode DoStreamingPass (int sourceDescriptor, Buffer <char> *sourceBuffer, CodeStream *stream, Buffer <char> *binaryBuffer,
+                                            Buffer <char> *listingBuffer, LabelTable *labelTable, Buffer <LabelReference> *referencesBuffer,
+                                            Buffer <DebugInfoChunk> *debugInfoBuffer, Buffer <char> *constantsBuffer) {
+    PushLog (1);
+
+    custom_assert (sourceBuffer,       pointer_is_null, NO_BUFFER);
+    custom_assert (sourceBuffer->data, pointer_is_null, NO_BUFFER);
+    custom_assert (stream,             pointer_is_null, NO_BUFFER);
+
+    size_t filledSize = 0;
+    int    lineNumber = 1;
+
+    while (true) {
+        // one byte is left for the terminating zero of the last line
+        ssize_t readSize = read (sourceDescriptor, sourceBuffer->data + filledSize, sourceBuffer->capacity - 1 - filledSize);
+
+        if (readSize < 0) {
+            ProgramErrorCheck (INPUT_FILE_ERROR, "Error occuried while reading source file");
+        }
+
+        filledSize += (size_t) readSize;
+
+        bool  isSourceEnd = readSize == 0;
+        char *lineBegin   = sourceBuffer->data;
+        char *dataEnd     = sourceBuffer->data + filledSize;
+
+        while (lineBegin < dataEnd) {
+            char *lineEnd = (char *) memchr (lineBegin, '\n', (size_t) (dataEnd - lineBegin));
+
+            if (!lineEnd && !isSourceEnd) {
+                break;
+            }
+
+            if (!lineEnd) {
+                lineEnd = dataEnd;
             }
+
+            *lineEnd = '\0';
+
+            TextLine line = {lineBegin, (size_t) (lineEnd - lineBegin)};
+
+            ProcessorErrorCode errorCode = CompileStreamedLine (stream, binaryBuffer, listingBuffer, labelTable, referencesBuffer,
+                                                                    debugInfoBuffer, constantsBuffer, &line, lineNumber++);
+            ProgramErrorCheck (errorCode, "Error occuried while compiling source piece");
+
+            lineBegin = lineEnd + 1;
+        }
+
+        if (isSourceEnd) {
+            break;
+        }
+
+        filledSize = lineBegin < dataEnd ? (size_t) (dataEnd - lineBegin) : 0;
+
+        if (filledSize == sourceBuffer->capacity - 1) {
+            SyntaxErrorCheck (INPUT_FILE_ERROR, "Line is too long for streaming mode", NULL, lineNumber);
         }
+
+        memmove (sourceBuffer->data, lineBegin, filledSize);
     }
 
+    ProgramErrorCheck (FlushCodeStream (stream, binaryBuffer, listingBuffer, debugInfoBuffer, constantsBuffer), "Error occuried while flushing code");
+
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode CompileLine (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, Buffer <Label> *labelsBuffer,
-                                        Buffer <DebugInfoChunk> *debugInfoBuffer, TextLine *line, int lineNumber) {
+// Line is compiled as in DoCompilationPass, names of new references are copied, as the source piece is going to be overwritten
+static ProcessorErrorCode CompileStreamedLine (CodeStream *stream, Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable,
+                                                Buffer <LabelReference> *referencesBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer,
+                                                Buffer <char> *constantsBuffer, TextLine *line, int lineNumber) {
     PushLog (2);
 
-    custom_assert (line,          pointer_is_null, NO_BUFFER);
-    custom_assert (line->pointer, pointer_is_null, NO_BUFFER);
-    custom_assert (binaryBuffer,  pointer_is_null, NO_BUFFER);
+    custom_assert (stream,           pointer_is_null, NO_BUFFER);
+    custom_assert (referencesBuffer, pointer_is_null, NO_BUFFER);
+    custom_assert (line,             pointer_is_null, NO_BUFFER);
+
+    TextBuffer lineText = {line, 1};
+    DeleteExcessWhitespaces (&lineText);
+
+    size_t referencesCount = referencesBuffer->currentIndex;
+
+    ProcessorErrorCode errorCode = CompileLine (binaryBuffer, listingBuffer, labelTable, referencesBuffer, debugInfoBuffer,
+                                                    constantsBuffer, stream->codeSize, line, lineNumber);
+
+    if (errorCode != BLANK_LINE) {
+        ProgramErrorCheck (errorCode, "Something has gone wrong while compiling line");
+    }
+
+    if (referencesBuffer->currentIndex > referencesCount) {
+        errorCode = KeepLabelName (labelTable, &referencesBuffer->data [referencesBuffer->currentIndex - 1].label);
+        ProgramErrorCheck (errorCode, "Error occuried while copying label name");
+    }
+
+    if (binaryBuffer->currentIndex >= STREAM_BUFFER_SIZE || listingBuffer->currentIndex >= STREAM_BUFFER_SIZE ||
+            debugInfoBuffer->currentIndex >= STREAM_BUFFER_SIZE / sizeof (DebugInfoChunk) || constantsBuffer->currentIndex >= STREAM_BUFFER_SIZE) {
+
+        errorCode = FlushCodeStream (stream, binaryBuffer, listingBuffer, debugInfoBuffer, constantsBuffer);
+        ProgramErrorCheck (errorCode, "Error occuried while flushing code");
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Same as ResolveLabelReferences, but the code is already in the binary file
+static ProcessorErrorCode PatchLabelReferences (CodeStream *stream, LabelTable *labelTable, Buffer <LabelReference> *referencesBuffer) {
+    PushLog (2);
+
+    custom_assert (stream,           pointer_is_null, NO_BUFFER);
+    custom_assert (labelTable,       pointer_is_null, NO_BUFFER);
+    custom_assert (referencesBuffer, pointer_is_null, NO_BUFFER);
+
+    for (size_t referenceIndex = 0; referenceIndex < referencesBuffer->currentIndex; referenceIndex++) {
+        LabelReference *reference = referencesBuffer->data + referenceIndex;
+
+        Label *foundLabel = FindLabel (labelTable, &reference->label);
+
+        if (!foundLabel) {
+            continue;
+        }
+
+        int32_t address = (int32_t) foundLabel->address;
+
+        ProcessorErrorCode errorCode = PatchStreamedCode (stream, reference->immediateAddress, &address, sizeof (address));
+        ProgramErrorCheck (errorCode, "Error occuried while patching label address");
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Chunk which thread can not be created is processed by the calling thread
+static ProcessorErrorCode RunChunkThreads (ParallelAssembly *assembly, void *(*chunkFunction) (void *)) {
+    PushLog (2);
+
+    custom_assert (assembly,         pointer_is_null, NO_BUFFER);
+    custom_assert (assembly->chunks, pointer_is_null, NO_BUFFER);
+
+    pthread_t threads         [MAX_ASSEMBLY_THREADS] = {};
+    bool      isThreadRunning [MAX_ASSEMBLY_THREADS] = {};
+
+    for (size_t chunkIndex = 1; chunkIndex < assembly->chunksCount; chunkIndex++) {
+        isThreadRunning [chunkIndex] = pthread_create (threads + chunkIndex, NULL, chunkFunction, assembly->chunks + chunkIndex) == 0;
+    }
+
+    chunkFunction (assembly->chunks);
+
+    ProcessorErrorCode errorCode = assembly->chunks [0].errorCode;
+
+    for (size_t chunkIndex = 1; chunkIndex < assembly->chunksCount; chunkIndex++) {
+        if (isThreadRunning [chunkIndex]) {
+            pthread_join (threads [chunkIndex], NULL);
+        } else {
+            chunkFunction (assembly->chunks + chunkIndex);
+        }
+
+        errorCode = (ProcessorErrorCode) (errorCode | assembly->chunks [chunkIndex].errorCode);
+    }
+
+    RETURN errorCode;
+}
+
+// Buffers are estimated as in CreateAssemblyBuffers
+static void *CompileChunk (void *chunkPointer) {
+    PushLog (2);
+
+    AssemblyChunk *chunk = (AssemblyChunk *) chunkPointer;
+
+    custom_assert (chunk, pointer_is_null, NULL);
+
+    const size_t MaxBinaryAllocationCoefficient = 3;
+    const size_t ListingInfoInLineSize          = 30;
+
+    DeleteExcessWhitespaces (&chunk->text);
+
+    size_t sourceSize = 0;
+
+    for (size_t lineIndex = 0; lineIndex < chunk->text.line_count; lineIndex++) {
+        sourceSize += chunk->text.lines [lineIndex].length + 1;
+    }
+
+    #define StopIfErrorsWereFound(...)                                      \
+        do {                                                                \
+            if ((chunk->errorCode = (__VA_ARGS__)) != NO_PROCESSOR_ERRORS)  \
+                RETURN NULL;                                                \
+        } while (0)
+
+    StopIfErrorsWereFound (InitBuffer (&chunk->binaryBuffer,     sourceSize * MaxBinaryAllocationCoefficient + 1));
+    StopIfErrorsWereFound (InitBuffer (&chunk->listingBuffer,    sourceSize + chunk->text.line_count * ListingInfoInLineSize + 1));
+    StopIfErrorsWereFound (InitBuffer (&chunk->debugInfoBuffer,  chunk->text.line_count + 1));
+    StopIfErrorsWereFound (InitBuffer (&chunk->referencesBuffer, INITIAL_LABELS_CAPACITY));
+    StopIfErrorsWereFound (InitBuffer (&chunk->constantsBuffer,  INITIAL_CONSTANTS_CAPACITY));
+    StopIfErrorsWereFound (InitLabelTable (&chunk->labelTable,   INITIAL_LABELS_CAPACITY));
+
+    chunk->labelTable.isRelative = true;
+
+    for (size_t lineIndex = 0; lineIndex < chunk->text.line_count; lineIndex++) {
+        ProcessorErrorCode errorCode = CompileLine (&chunk->binaryBuffer, &chunk->listingBuffer, &chunk->labelTable, &chunk->referencesBuffer,
+                                                        &chunk->debugInfoBuffer, &chunk->constantsBuffer, 0, chunk->text.lines + lineIndex,
+                                                        (int) (chunk->firstLineIndex + lineIndex) + 1);
+
+        if (errorCode != BLANK_LINE) {
+            StopIfErrorsWereFound (errorCode);
+        }
+    }
+
+    #undef StopIfErrorsWereFound
+
+    RETURN NULL;
+}
+
+// Chunk labels are added in source order, so the first definition is kept as in sequential assembly
+static ProcessorErrorCode JoinChunkLabels (ParallelAssembly *assembly) {
+    PushLog (2);
+
+    custom_assert (assembly, pointer_is_null, NO_BUFFER);
+
+    size_t codeSize      = 0;
+    size_t debugInfoSize = 0;
+
+    for (size_t chunkIndex = 0; chunkIndex < assembly->chunksCount; chunkIndex++) {
+        AssemblyChunk *chunk = assembly->chunks + chunkIndex;
+
+        chunk->codeOffset      = codeSize;
+        chunk->debugInfoOffset = debugInfoSize;
+
+        codeSize      += chunk->binaryBuffer.currentIndex;
+        debugInfoSize += chunk->debugInfoBuffer.currentIndex;
+    }
+
+    ProgramErrorCheck (InitBuffer (&assembly->binaryBuffer,    codeSize + 1),      "Unable to create binary buffer");
+    ProgramErrorCheck (InitBuffer (&assembly->debugInfoBuffer, debugInfoSize + 1), "Unable to create debug info buffer");
+    ProgramErrorCheck (InitLabelTable (&assembly->labelTable,  INITIAL_LABELS_CAPACITY), "Unable to create labels table");
+
+    assembly->binaryBuffer.currentIndex    = codeSize;
+    assembly->debugInfoBuffer.currentIndex = debugInfoSize;
+
+    for (size_t chunkIndex = 0; chunkIndex < assembly->chunksCount; chunkIndex++) {
+        AssemblyChunk *chunk = assembly->chunks + chunkIndex;
+
+        for (size_t labelIndex = 0; labelIndex < chunk->labelTable.labels.currentIndex; labelIndex++) {
+            Label label = chunk->labelTable.labels.data [labelIndex];
+            label.address += (long long) chunk->codeOffset;
+
+            ProcessorErrorCode errorCode = AddLabel (&assembly->labelTable, &label);
+            ProgramErrorCheck (errorCode, "Error occuried while joining labels");
+        }
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Code and debug info go to their places in the joined buffers, every label use is patched from the joined labels
+static void *RelocateChunk (void *chunkPointer) {
+    PushLog (2);
+
+    AssemblyChunk *chunk = (AssemblyChunk *) chunkPointer;
+
+    custom_assert (chunk,           pointer_is_null, NULL);
+    custom_assert (chunk->assembly, pointer_is_null, NULL);
+
+    ParallelAssembly *assembly = chunk->assembly;
+    char             *code     = assembly->binaryBuffer.data + chunk->codeOffset;
+
+    memcpy (code, chunk->binaryBuffer.data, chunk->binaryBuffer.currentIndex);
+
+    for (size_t referenceIndex = 0; referenceIndex < chunk->referencesBuffer.currentIndex; referenceIndex++) {
+        LabelReference *reference = chunk->referencesBuffer.data + referenceIndex;
+
+        Label *foundLabel = FindLabel (&assembly->labelTable, &reference->label);
+
+        // undefined label keeps -1 address
+        if (!foundLabel) {
+            continue;
+        }
+
+        int32_t address = (int32_t) foundLabel->address;
+        memcpy (code + reference->immediateAddress, &address, sizeof (address));
+    }
+
+    for (size_t chunkIndex = 0; chunkIndex < chunk->debugInfoBuffer.currentIndex; chunkIndex++) {
+        DebugInfoChunk debugInfo = chunk->debugInfoBuffer.data [chunkIndex];
+        debugInfo.address += chunk->codeOffset;
+
+        assembly->debugInfoBuffer.data [chunk->debugInfoOffset + chunkIndex] = debugInfo;
+    }
+
+    chunk->errorCode = RebaseListing (&chunk->listingBuffer, chunk->codeOffset);
+
+    RETURN NULL;
+}
+
+static ProcessorErrorCode JoinChunkListings (ParallelAssembly *assembly) {
+    PushLog (2);
+
+    custom_assert (assembly, pointer_is_null, NO_BUFFER);
+
+    size_t listingSize = 0;
+
+    for (size_t chunkIndex = 0; chunkIndex < assembly->chunksCount; chunkIndex++) {
+        listingSize += assembly->chunks [chunkIndex].listingBuffer.currentIndex;
+    }
+
+    ProgramErrorCheck (InitBuffer (&assembly->listingBuffer, listingSize + 1), "Unable to create listing buffer");
+
+    for (size_t chunkIndex = 0; chunkIndex < assembly->chunksCount; chunkIndex++) {
+        Buffer <char> *chunkListing = &assembly->chunks [chunkIndex].listingBuffer;
+
+        memcpy (assembly->listingBuffer.data + assembly->listingBuffer.currentIndex, chunkListing->data, chunkListing->currentIndex);
+        assembly->listingBuffer.currentIndex += chunkListing->currentIndex;
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Blocks have ram addresses, so they are not moved with the code and are just written in source order
+static ProcessorErrorCode JoinChunkConstants (ParallelAssembly *assembly) {
+    PushLog (2);
+
+    custom_assert (assembly, pointer_is_null, NO_BUFFER);
+
+    size_t constantsSize = 0;
+
+    for (size_t chunkIndex = 0; chunkIndex < assembly->chunksCount; chunkIndex++) {
+        constantsSize += assembly->chunks [chunkIndex].constantsBuffer.currentIndex;
+    }
+
+    ProgramErrorCheck (InitBuffer (&assembly->constantsBuffer, constantsSize + 1), "Unable to create constants buffer");
+
+    for (size_t chunkIndex = 0; chunkIndex < assembly->chunksCount; chunkIndex++) {
+        Buffer <char> *chunkConstants = &assembly->chunks [chunkIndex].constantsBuffer;
+
+        memcpy (assembly->constantsBuffer.data + assembly->constantsBuffer.currentIndex, chunkConstants->data, chunkConstants->currentIndex);
+        assembly->constantsBuffer.currentIndex += chunkConstants->currentIndex;
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Every listing line starts with the instruction address, which is printed again with the chunk offset added
+static ProcessorErrorCode RebaseListing (Buffer <char> *listingBuffer, size_t codeOffset) {
+    PushLog (3);
+
     custom_assert (listingBuffer, pointer_is_null, NO_BUFFER);
-    custom_assert (labelsBuffer,  pointer_is_null, NO_BUFFER);
 
-    ssize_t lineBegin = FindActualStringBegin (line);
-    ssize_t lineEnd   = FindActualStringEnd   (line);
+    if (codeOffset == 0) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
 
-    if (lineBegin < 0 || lineBegin >= lineEnd) {
-        RETURN BLANK_LINE;
+    // address can get longer by the count of digits in the offset
+    const size_t MaxAddressLength = 20;
+
+    Buffer <char> rebasedListing = {0, 0, NULL};
+    ProgramErrorCheck (InitBuffer (&rebasedListing, listingBuffer->currentIndex * 2 + MaxAddressLength), "Unable to create listing buffer");
+
+    const char *listingEnd = listingBuffer->data + listingBuffer->currentIndex;
+
+    for (const char *line = listingBuffer->data; line < listingEnd;) {
+        char  *addressEnd = NULL;
+        size_t address    = strtoul (line, &addressEnd, 10);
+
+        const char *lineEnd = (const char *) memchr (addressEnd, '\n', (size_t) (listingEnd - addressEnd));
+        lineEnd = lineEnd ? lineEnd + 1 : listingEnd;
+
+        char addressString [MaxAddressLength + 1] = "";
+        int  addressLength = snprintf (addressString, sizeof (addressString), "%.4lu", address + codeOffset);
+
+        WriteDataToBufferErrorCheck ("Error occuried while writing listing address", &rebasedListing, addressString, (size_t) addressLength);
+        WriteDataToBufferErrorCheck ("Error occuried while writing listing line",    &rebasedListing, addressEnd,    (size_t) (lineEnd - addressEnd));
+
+        line = lineEnd;
     }
 
-    char labelName [LABEL_NAME_LENGTH] = "";
+    DestroyBuffer (listingBuffer);
+    *listingBuffer = rebasedListing;
 
-    if (IsLabelLine (line, labelName)) {
-        ProgramErrorCheck (SaveLabel (binaryBuffer, labelsBuffer, line, labelName),
-                            "Error occuried while saving label");
-        ProgramErrorCheck (EmitLabelListing (binaryBuffer, listingBuffer, line, lineNumber),
-                            "Error occuried while writing label to the listing");
+    RETURN NO_PROCESSOR_ERRORS;
+}
 
-        RETURN BLANK_LINE;
+static void DestroyParallelAssembly (ParallelAssembly *assembly) {
+    PushLog (3);
+
+    custom_assert (assembly, pointer_is_null, (void) 0);
+
+    for (size_t chunkIndex = 0; chunkIndex < assembly->chunksCount; chunkIndex++) {
+        AssemblyChunk *chunk = assembly->chunks + chunkIndex;
+
+        DestroyAssemblyBuffers (&chunk->binaryBuffer, &chunk->listingBuffer, &chunk->labelTable);
+        DestroyBuffer (&chunk->referencesBuffer);
+        DestroyBuffer (&chunk->debugInfoBuffer);
+        DestroyBuffer (&chunk->constantsBuffer);
+    }
+
+    DestroyAssemblyBuffers (&assembly->binaryBuffer, &assembly->listingBuffer, &assembly->labelTable);
+    DestroyBuffer (&assembly->debugInfoBuffer);
+    DestroyBuffer (&assembly->constantsBuffer);
+
+    delete [] assembly->chunks;
+
+    assembly->chunks      = NULL;
+    assembly->chunksCount = 0;
+
+    RETURN;
+}
+
+// Labels are written with INT32 format in any case, so placeholders are overwritten in place
+static ProcessorErrorCode ResolveLabelReferences (Buffer <char> *binaryBuffer, LabelTable *labelTable, Buffer <LabelReference> *referencesBuffer) {
+    PushLog (2);
+
+    custom_assert (binaryBuffer,     pointer_is_null, NO_BUFFER);
+    custom_assert (labelTable,       pointer_is_null, NO_BUFFER);
+    custom_assert (referencesBuffer, pointer_is_null, NO_BUFFER);
+
+    for (size_t referenceIndex = 0; referenceIndex < referencesBuffer->currentIndex; referenceIndex++) {
+        LabelReference *reference = referencesBuffer->data + referenceIndex;
+
+        Label *foundLabel = FindLabel (labelTable, &reference->label);
+
+        // undefined label keeps -1 address
+        if (!foundLabel) {
+            continue;
+        }
+
+        int32_t address = (int32_t) foundLabel->address;
+        memcpy (binaryBuffer->data + reference->immediateAddress, &address, sizeof (address));
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Addresses are counted from codeBase, which is the size of code written out of the binary buffer before
+static ProcessorErrorCode CompileLine (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable,
+                                        Buffer <LabelReference> *referencesBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer,
+                                        Buffer <char> *constantsBuffer, size_t codeBase, TextLine *line, int lineNumber) {
+    PushLog (2);
+
+    ParsedLine parsedLine {};
+
+    ProcessorErrorCode errorCode = ParseLine (&parsedLine, labelTable, constantsBuffer, line, lineNumber);
+
+    if (errorCode != NO_PROCESSOR_ERRORS) {
+        RETURN errorCode;
     }
 
+    RETURN EmitParsedLine (binaryBuffer, listingBuffer, labelTable, referencesBuffer, debugInfoBuffer, codeBase, &parsedLine);
+}
+
+// Label uses are resolved if the label is already in the table. Blank line gives BLANK_LINE error code.
+// Data directive goes to the constants right away, as the optimizer does not change it
+static ProcessorErrorCode ParseLine (ParsedLine *parsedLine, LabelTable *labelTable, Buffer <char> *constantsBuffer,
+                                        TextLine *line, int lineNumber) {
+    PushLog (2);
+
+    custom_assert (parsedLine,      pointer_is_null, NO_BUFFER);
+    custom_assert (line,            pointer_is_null, NO_BUFFER);
+    custom_assert (line->pointer,   pointer_is_null, NO_BUFFER);
+    custom_assert (labelTable,      pointer_is_null, NO_BUFFER);
+    custom_assert (constantsBuffer, pointer_is_null, NO_BUFFER);
+
     ProcessorErrorCode errorCode = NO_PROCESSOR_ERRORS;
 
-    InstructionArguments arguments {NAN, REGISTER_COUNT};
+    if (IsDataDirective (line)) {
+        parsedLine->isData     = true;
+        parsedLine->line       = line;
+        parsedLine->lineNumber = lineNumber;
+
+        RETURN CompileDataDirective (constantsBuffer, line, lineNumber);
+    }
+
+    TokenizedLine tokenizedLine = {};
+
+    if ((errorCode = TokenizeLine (line, &tokenizedLine, lineNumber)) != NO_PROCESSOR_ERRORS) {
+        RETURN errorCode;
+    }
+
+    if (tokenizedLine.tokensCount == 0) {
+        RETURN BLANK_LINE;
+    }
+
+    Token *tokens = tokenizedLine.tokens;
+
+    parsedLine->line       = line;
+    parsedLine->lineNumber = lineNumber;
+
+    if (tokens [0].type == LABEL_DEFINITION_TOKEN) {
+        parsedLine->isLabel = true;
+        InitLabel (&parsedLine->label, tokens [0].begin, tokens [0].length, -1);
+
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
     ArgumentsType permittedArguments = NO_ARGUMENTS;
-    AssemblerInstruction outputInstruction {"", {0, 0}, NULL};
 
-    if ((errorCode = CompileInstructionOpcode (line, &outputInstruction, &permittedArguments, lineNumber)) != NO_PROCESSOR_ERRORS) {
+    if ((errorCode = CompileInstructionOpcode (line, tokens, &parsedLine->instruction, &permittedArguments, lineNumber)) != NO_PROCESSOR_ERRORS) {
         RETURN errorCode;
     }
 
     ON_DEBUG(
         char message [MAX_MESSAGE_LENGTH] = "";
-        snprintf (message, MAX_MESSAGE_LENGTH, "Instruction found: %s", outputInstruction.instructionName);
+        snprintf (message, MAX_MESSAGE_LENGTH, "Instruction found: %s", parsedLine->instruction.instructionName);
         PrintInfoMessage (message, NULL);
     )
 
-    if ((errorCode = CompileInstructionArgumentsData (&outputInstruction, line, &arguments, permittedArguments, labelsBuffer, lineNumber)) != NO_PROCESSOR_ERRORS) {
+    if ((errorCode = CompileInstructionArgumentsData (&parsedLine->instruction, line, tokens + 1, tokenizedLine.tokensCount - 1, &parsedLine->arguments,
+                                                        permittedArguments, labelTable, &parsedLine->label, lineNumber)) != NO_PROCESSOR_ERRORS) {
         RETURN errorCode;
     }
 
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Label gets the current address. Data directive and instruction removed by the optimizer are written to the listing only
+static ProcessorErrorCode EmitParsedLine (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable,
+                                            Buffer <LabelReference> *referencesBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer, size_t codeBase,
+                                            ParsedLine *parsedLine) {
+    PushLog (2);
+
+    custom_assert (parsedLine,       pointer_is_null, NO_BUFFER);
+    custom_assert (binaryBuffer,     pointer_is_null, NO_BUFFER);
+    custom_assert (listingBuffer,    pointer_is_null, NO_BUFFER);
+    custom_assert (labelTable,       pointer_is_null, NO_BUFFER);
+    custom_assert (referencesBuffer, pointer_is_null, NO_BUFFER);
+
+    TextLine *line       = parsedLine->line;
+    int       lineNumber = parsedLine->lineNumber;
+
+    if (parsedLine->isLabel) {
+        ProgramErrorCheck (SaveLabel (codeBase + binaryBuffer->currentIndex, labelTable, &parsedLine->label),
+                            "Error occuried while saving label");
+        ProgramErrorCheck (EmitLabelListing (codeBase + binaryBuffer->currentIndex, listingBuffer, line, lineNumber),
+                            "Error occuried while writing label to the listing");
+
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    if (parsedLine->isRemoved || parsedLine->isData) {
+        ProgramErrorCheck (EmitLabelListing (codeBase + binaryBuffer->currentIndex, listingBuffer, line, lineNumber),
+                            "Error occuried while writing removed instruction to the listing");
+
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
     if (debugInfoBuffer && IsDebugMode ()) {
-        DebugInfoChunk commandDebugInfo = {binaryBuffer->currentIndex, lineNumber};
+        DebugInfoChunk commandDebugInfo = {codeBase + binaryBuffer->currentIndex, lineNumber};
         ProgramErrorCheck (WriteDataToBuffer (debugInfoBuffer, &commandDebugInfo, 1),
                             "Error occuried while writing debug information to a buffer");
     }
-    ProgramErrorCheck (EmitInstructionListing (binaryBuffer, listingBuffer, &outputInstruction, &arguments, line, lineNumber),
-                                                     "Error occuried while emitting instruction to a listing");
-    ProgramErrorCheck (EmitInstructionBinary  (binaryBuffer,                &outputInstruction, &arguments, line, lineNumber),
+    ProgramErrorCheck (EmitInstructionListing (codeBase + binaryBuffer->currentIndex, listingBuffer, &parsedLine->instruction,
+                                                &parsedLine->arguments, line, lineNumber), "Error occuried while emitting instruction to a listing");
+    ProgramErrorCheck (EmitInstructionBinary  (binaryBuffer, &parsedLine->instruction, &parsedLine->arguments, line, lineNumber),
                                                     "Error occuried while emitting instruction to a binary");
 
+    // immediate is the last field of an instruction
+    if (parsedLine->arguments.isLabel && parsedLine->label.address < 0) {
+        LabelReference reference {parsedLine->label, codeBase + binaryBuffer->currentIndex - sizeof (int32_t)};
+
+        ProgramErrorCheck (WriteDataToBuffer (referencesBuffer, &reference, 1), "Error occuried while writing label reference to a buffer");
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Block header is written before the values are known and is filled afterwards
+static ProcessorErrorCode CompileDataDirective (Buffer <char> *constantsBuffer, TextLine *line, int lineNumber) {
+    PushLog (3);
+
+    custom_assert (constantsBuffer, pointer_is_null, NO_BUFFER);
+    custom_assert (line,            pointer_is_null, NO_BUFFER);
+
+    ConstantsBlock block {};
+    size_t         blockOffset = constantsBuffer->currentIndex;
+
+    ProgramErrorCheck (WriteDataToBuffer (constantsBuffer, &block, sizeof (block)), "Error occuried while writing constants block to a buffer");
+
+    size_t address = 0;
+
+    ProcessorErrorCode errorCode = TokenizeDataDirective (line, &address, constantsBuffer, lineNumber);
+
+    if (errorCode != NO_PROCESSOR_ERRORS) {
+        RETURN errorCode;
+    }
+
+    block.address = address;
+    block.size    = (constantsBuffer->currentIndex - blockOffset - sizeof (block)) / sizeof (elem_t);
+
+    if (block.size == 0) {
+        SyntaxErrorCheck (TOO_FEW_ARGUMENTS, "Data directive has no values", line, lineNumber);
+    }
+
+    if (block.address > VRAM_SIZE + RAM_SIZE || block.size > VRAM_SIZE + RAM_SIZE - block.address) {
+        SyntaxErrorCheck (WRONG_ADDRESS, "Data does not fit into ram", line, lineNumber);
+    }
+
+    memcpy (constantsBuffer->data + blockOffset, &block, sizeof (block));
+
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode CompileInstructionOpcode  (TextLine *line, AssemblerInstruction *instruction,
+static ProcessorErrorCode CompileInstructionOpcode  (TextLine *line, Token *mnemonic, AssemblerInstruction *instruction,
                                                         ArgumentsType *permittedArguments, int lineNumber) {
     PushLog (3);
 
     custom_assert (instruction, pointer_is_null, WRONG_INSTRUCTION);
     custom_assert (line,        pointer_is_null, NO_BUFFER);
+    custom_assert (mnemonic,    pointer_is_null, NO_BUFFER);
 
-    char sscanfBuffer [MAX_INSTRUCTION_LENGTH + 1] = "";
-
-    int sscanfResult = sscanf (line->pointer, "%s", sscanfBuffer);
-
-    if (sscanfResult <= 0) {
-        RETURN BLANK_LINE;
+    if (mnemonic->length > MAX_INSTRUCTION_LENGTH) {
+        SyntaxErrorCheck (WRONG_INSTRUCTION, "Wrong instruction has been read", line, lineNumber);
     }
 
-    const AssemblerInstruction *templateInstruction = FindInstructionByName (sscanfBuffer);
+    char instructionName [MAX_INSTRUCTION_LENGTH + 1] = "";
+    memcpy (instructionName, mnemonic->begin, mnemonic->length);
+
+    const AssemblerInstruction *templateInstruction = FindInstructionByName (instructionName);
 
     if (!templateInstruction) {
         SyntaxErrorCheck (WRONG_INSTRUCTION, "Wrong instruction has been read", line, lineNumber);
@@ -212,6 +1049,7 @@ static ProcessorErrorCode CompileInstructionOpcode  (TextLine *line, AssemblerIn
 
     instruction->instructionName    = templateInstruction->instructionName;
     instruction->commandCode.opcode = templateInstruction->commandCode.opcode;
+    instruction->flow               = templateInstruction->flow;
     instruction->callbackFunction   = templateInstruction->callbackFunction;
 
     *permittedArguments = (ArgumentsType) templateInstruction->commandCode.arguments;
@@ -219,168 +1057,176 @@ static ProcessorErrorCode CompileInstructionOpcode  (TextLine *line, AssemblerIn
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode ReadRamBrackets (AssemblerInstruction *instruction, TextLine *line, ssize_t *offset,
+// Brackets are taken off the arguments
+static ProcessorErrorCode ReadRamBrackets (AssemblerInstruction *instruction, TextLine *line, Token **arguments, size_t *argumentsCount,
                                             ArgumentsType permittedArguments, int lineNumber) {
     PushLog (4);
 
-    ssize_t end = FindActualStringEnd (line);
-    bool foundOpenBracket = false;
+    if (*argumentsCount == 0 || (*arguments) [0].type != OPEN_BRACKET_TOKEN) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
 
-    if (*offset + 1 < (ssize_t) line->length && line->pointer [*offset + 1] == '[') {
-        foundOpenBracket = true;
+    if ((*arguments) [*argumentsCount - 1].type != CLOSE_BRACKET_TOKEN) {
+        SyntaxErrorCheck (WRONG_INSTRUCTION, "No closing ']' bracket", line, lineNumber);
     }
 
-    if (foundOpenBracket && line->pointer [end] == ']') {
-        *offset += 2;
+    if (!(permittedArguments & MEMORY_ARGUMENT)) {
+        SyntaxErrorCheck (WRONG_INSTRUCTION, "This instruction does not take memory address as an argument", line, lineNumber);
+    }
 
-        if (!(permittedArguments & MEMORY_ARGUMENT)) {
-            SyntaxErrorCheck (WRONG_INSTRUCTION, "This instruction does not take memory address as an argument", line, lineNumber);
-        }
+    instruction->commandCode.arguments |= MEMORY_ARGUMENT;
 
-        instruction->commandCode.arguments |= MEMORY_ARGUMENT;
-    } else if (foundOpenBracket) {
-        SyntaxErrorCheck (WRONG_INSTRUCTION, "No closing ']' bracket", line, lineNumber);
-    }
+    (*arguments)++;
+    *argumentsCount -= 2;
 
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode CompileInstructionArgumentsData (AssemblerInstruction *instruction, TextLine *line, InstructionArguments *arguments,
-                                                            ArgumentsType permittedArguments, Buffer <Label> *labelsBuffer, int lineNumber) {
+static ProcessorErrorCode CompileInstructionArgumentsData (AssemblerInstruction *instruction, TextLine *line, Token *argumentTokens, size_t argumentsCount,
+                                                            InstructionArguments *arguments, ArgumentsType permittedArguments, LabelTable *labelTable,
+                                                            Label *argumentLabel, int lineNumber) {
     PushLog (3);
-    custom_assert (line,        pointer_is_null, NO_BUFFER);
-    custom_assert (instruction, pointer_is_null, WRONG_INSTRUCTION);
-
-    ssize_t argumentsCount = CountWhitespaces (line);
-
-    if (argumentsCount < 0) {
-        ProgramErrorCheck (TOO_FEW_ARGUMENTS, "Less than zero arguments have been found");
-    }
+    custom_assert (line,           pointer_is_null, NO_BUFFER);
+    custom_assert (instruction,    pointer_is_null, WRONG_INSTRUCTION);
+    custom_assert (argumentTokens, pointer_is_null, NO_BUFFER);
+    custom_assert (argumentLabel,  pointer_is_null, WRONG_LABEL);
 
     *arguments = {NAN, REGISTER_COUNT};
 
-    TextLine argsLine = {line->pointer, line->length };
+    // instruction working on memory only takes an address of any kind, but nothing outside of brackets
+    if (permittedArguments == MEMORY_ARGUMENT) {
+        if (argumentsCount == 0 || argumentTokens [0].type != OPEN_BRACKET_TOKEN) {
+            SyntaxErrorCheck (WRONG_INSTRUCTION, "Instruction takes memory address only", line, lineNumber);
+        }
 
-    ssize_t offset = FindActualStringBegin (&argsLine);
-    int deltaOffset = 0;
-    sscanf (line->pointer + offset, "%*s%n", &deltaOffset);
-    if (deltaOffset <= 0) {
-        SyntaxErrorCheck (WRONG_INSTRUCTION, "Can not read instruction", line, lineNumber);
+        permittedArguments = (ArgumentsType) (IMMED_ARGUMENT | REGISTER_ARGUMENT | MEMORY_ARGUMENT);
     }
-    offset += deltaOffset;
 
-    SyntaxErrorCheck (ReadRamBrackets (instruction, line, &offset, permittedArguments, lineNumber),
+    SyntaxErrorCheck (ReadRamBrackets (instruction, line, &argumentTokens, &argumentsCount, permittedArguments, lineNumber),
                         "Error occuried while parsing brackets", line, lineNumber);
 
-    char argumentBuffer [MAX_INSTRUCTION_LENGTH] = "";
-
-    #define FIND_REGISTER()                                                             \
-                const Register *foundRegister = FindRegisterByName (argumentBuffer);    \
-                if ((permittedArguments & REGISTER_ARGUMENT) && foundRegister) {        \
-                    instruction->commandCode.arguments |= REGISTER_ARGUMENT;            \
-                    arguments->registerIndex = foundRegister->index;                    \
-                    break;                                                              \
-                }                                                                       \
+    bool isMemoryArgument = instruction->commandCode.arguments & MEMORY_ARGUMENT;
 
     switch (argumentsCount) {
-        case 2:
+        case 3:
             if (permittedArguments != (REGISTER_ARGUMENT | IMMED_ARGUMENT) &&
                     permittedArguments != (REGISTER_ARGUMENT | IMMED_ARGUMENT | MEMORY_ARGUMENT)) {
 
                 SyntaxErrorCheck (WRONG_INSTRUCTION, "Instruction does not takes this set of arguments", line, lineNumber);
             }
 
-            if (sscanf (line->pointer + offset, "%3s+%lf", argumentBuffer, &arguments->immedArgument) > 0) {
-                instruction->commandCode.arguments |= IMMED_ARGUMENT;
-
-                FIND_REGISTER ();
+            if (argumentTokens [1].type != PLUS_TOKEN || argumentTokens [2].type != IMMEDIATE_TOKEN) {
+                SyntaxErrorCheck (TOO_FEW_ARGUMENTS, "Wrong arguments format", line, lineNumber);
+            }
 
+            if (argumentTokens [0].type != REGISTER_TOKEN) {
                 SyntaxErrorCheck (TOO_FEW_ARGUMENTS, "Wrong register name format", line, lineNumber);
-            } else {
-                SyntaxErrorCheck (TOO_FEW_ARGUMENTS, "Wrong arguments format", line, lineNumber);
             }
+
+            instruction->commandCode.arguments |= REGISTER_ARGUMENT | IMMED_ARGUMENT;
+            arguments->registerIndex = argumentTokens [0].registerIndex;
+            arguments->immedArgument = argumentTokens [2].value;
             break;
 
         case 1:
-            if (sscanf (line->pointer + offset, "%lf", &arguments->immedArgument) > 0){
+            if (argumentTokens [0].type == IMMEDIATE_TOKEN) {
                 if (!(permittedArguments & IMMED_ARGUMENT)) {
                     SyntaxErrorCheck (WRONG_INSTRUCTION, "Instruction does not takes this set of arguments", line, lineNumber);
                 }
+
                 instruction->commandCode.arguments |= IMMED_ARGUMENT;
+                arguments->immedArgument = argumentTokens [0].value;
+                break;
+            }
 
-            } else if (sscanf (line->pointer + offset, "%s", argumentBuffer) > 0) {
-                size_t bufferLength = strlen (argumentBuffer);
+            if (argumentTokens [0].type == REGISTER_TOKEN && (permittedArguments & REGISTER_ARGUMENT)) {
+                instruction->commandCode.arguments |= REGISTER_ARGUMENT;
+                arguments->registerIndex = argumentTokens [0].registerIndex;
+                break;
+            }
 
-                if ((instruction->commandCode.arguments & MEMORY_ARGUMENT) && argumentBuffer [bufferLength - 1] == ']') {
-                    argumentBuffer [bufferLength - 1] = '\0';
-                }
+            // register name is a label for instructions which do not take registers
+            if (argumentTokens [0].type != REGISTER_TOKEN && argumentTokens [0].type != LABEL_TOKEN) {
+                SyntaxErrorCheck (TOO_FEW_ARGUMENTS, "Wrong arguments format", line, lineNumber);
+            }
 
-                FIND_REGISTER ();
+            if (isMemoryArgument) {
+                SyntaxErrorCheck (TOO_FEW_ARGUMENTS, "Can not use label as a memory address", line, lineNumber);
+            }
 
-                if (instruction->commandCode.arguments & MEMORY_ARGUMENT) {
-                    SyntaxErrorCheck (TOO_FEW_ARGUMENTS, "Can not use label as a memory address", line, lineNumber);
-                }
+            InitLabel (argumentLabel, argumentTokens [0].begin, argumentTokens [0].length, -1);
 
-                Label label {};
-                InitLabel (&label, argumentBuffer, -1);
-                Label *foundLabel = FindValueInBuffer (labelsBuffer, &label, LabelComparatorByName);
+            {
+                Label *foundLabel = labelTable->isRelative ? NULL : FindLabel (labelTable, argumentLabel);
 
-                arguments->immedArgument = -1;
+                // label defined later gets its address when the whole source is compiled
                 if (foundLabel) {
-                    arguments->immedArgument = (double) foundLabel->address;
+                    argumentLabel->address = foundLabel->address;
                 }
-
-                instruction->commandCode.arguments |= IMMED_ARGUMENT;
-            } else {
-                SyntaxErrorCheck (TOO_FEW_ARGUMENTS, "Wrong arguments format", line, lineNumber);
             }
+
+            arguments->immedArgument = (double) argumentLabel->address;
+            arguments->isLabel       = true;
+
+            instruction->commandCode.arguments |= IMMED_ARGUMENT;
             break;
 
         case 0:
+            if (isMemoryArgument) {
+                SyntaxErrorCheck (TOO_FEW_ARGUMENTS, "Wrong arguments format", line, lineNumber);
+            }
             break;
 
         default:
-            SyntaxErrorCheck (TOO_MANY_ARGUMENTS, "Too many arguments for this command", line, lineNumber);
+            if (argumentsCount > 3) {
+                SyntaxErrorCheck (TOO_MANY_ARGUMENTS, "Too many arguments for this command", line, lineNumber);
+            }
+
+            SyntaxErrorCheck (TOO_FEW_ARGUMENTS, "Wrong arguments format", line, lineNumber);
             break;
     }
 
-    #undef FIND_REGISTER
-    #undef INSTRUCTION
-
     RETURN NO_PROCESSOR_ERRORS;
 }
 
 
-static ProcessorErrorCode SaveLabel (Buffer <char> *binaryBuffer, Buffer <Label> *labelsBuffer, TextLine *sourceLine, char *labelName) {
+static ProcessorErrorCode SaveLabel (size_t address, LabelTable *labelTable, Label *label) {
     PushLog (3);
 
-    custom_assert (binaryBuffer, pointer_is_null, NO_BUFFER);
-    custom_assert (labelsBuffer, pointer_is_null, NO_BUFFER);
-    custom_assert (sourceLine,   pointer_is_null, NO_BUFFER);
-
-    size_t labelNameLength = strlen (labelName);
-
-    labelName [labelNameLength - 1] = '\0';
+    custom_assert (labelTable, pointer_is_null, NO_BUFFER);
+    custom_assert (label,      pointer_is_null, NO_BUFFER);
 
-    Label label {};
-    InitLabel (&label, labelName, (long long) binaryBuffer->currentIndex);
+    label->address = (long long) address;
 
-    WriteDataToBufferErrorCheck ("Error occuried while writing label to buffer", labelsBuffer, &label, 1);
+    ProgramErrorCheck (AddLabel (labelTable, label), "Error occuried while writing label to table");
 
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode EmitLabelListing (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, TextLine *sourceLine, int lineNumber) {
+static ProcessorErrorCode EmitLabelListing (size_t address, Buffer <char> *listingBuffer, TextLine *sourceLine, int lineNumber) {
     PushLog (3);
 
     const size_t ServiceInfoLength = 30;
-    char listingInfoBuffer [MAX_INSTRUCTION_LENGTH + ServiceInfoLength] = "";
+    char listingInfoBuffer [ServiceInfoLength] = "";
+
+    snprintf (listingInfoBuffer, ServiceInfoLength, "%.4lu\t--\t\t%.4d\t", address, lineNumber);
+
+    RETURN EmitListingLine (listingBuffer, listingInfoBuffer, sourceLine);
+}
 
-    sprintf (listingInfoBuffer, "%.4lu\t--\t\t%.4d\t%s\n", binaryBuffer->currentIndex,
-                lineNumber, sourceLine->pointer + FindActualStringBegin (sourceLine));
+// Source line is copied as it is, since label names are not limited in length
+static ProcessorErrorCode EmitListingLine (Buffer <char> *listingBuffer, const char *listingInfo, TextLine *sourceLine) {
+    PushLog (3);
+
+    custom_assert (listingBuffer, pointer_is_null, NO_BUFFER);
+    custom_assert (listingInfo,   pointer_is_null, NO_BUFFER);
+    custom_assert (sourceLine,    pointer_is_null, NO_BUFFER);
+
+    const char *source = sourceLine->pointer + FindActualStringBegin (sourceLine);
 
-    WriteDataToBufferErrorCheck ("Error occuried while writing label to listing buffer",
-                                    listingBuffer, listingInfoBuffer, strlen (listingInfoBuffer));
+    WriteDataToBufferErrorCheck ("Error occuried while writing listing info to listing buffer", listingBuffer, listingInfo, strlen (listingInfo));
+    WriteDataToBufferErrorCheck ("Error occuried while writing source to listing buffer",      listingBuffer, source,      strlen (source));
+    WriteDataToBufferErrorCheck ("Error occuried while writing new line to listing buffer",    listingBuffer, "\n",        1);
 
     RETURN NO_PROCESSOR_ERRORS;
 }
@@ -411,10 +1257,35 @@ static ProcessorErrorCode EmitInstructionBinary (Buffer <char> *binaryBuffer, As
     }
 
     if (instruction->commandCode.arguments & IMMED_ARGUMENT) {
-        WriteDataToBufferErrorCheck ("Error occuried while writing immed argument to binary buffer",
-                                            binaryBuffer, &arguments->immedArgument, sizeof (elem_t));
+        // label defined later is not known yet, so its address always takes 4 bytes to be patched
+        ImmediateFormat format = arguments->isLabel ? INT32_IMMEDIATE : GetImmediateFormat (arguments->immedArgument);
+
+        unsigned char formatByte = (unsigned char) format;
+        WriteDataToBufferErrorCheck ("Error occuried while writing immed argument format to binary buffer",
+                                        binaryBuffer, &formatByte, sizeof (formatByte));
+
+        #define WriteImmediate(type)                                                                                    \
+                    do {                                                                                                \
+                        type value_ = (type) arguments->immedArgument;                                                  \
+                        WriteDataToBufferErrorCheck ("Error occuried while writing immed argument to binary buffer",    \
+                                                        binaryBuffer, &value_, sizeof (type));                          \
+                        ON_DEBUG (sprintf (message + strlen (message), "%lf (size = %lu)",                              \
+                                            arguments->immedArgument, sizeof (type)));                                  \
+                    } while (0)
+
+        switch (format) {
+            case INT8_IMMEDIATE:   WriteImmediate (int8_t);  break;
+            case INT16_IMMEDIATE:  WriteImmediate (int16_t); break;
+            case INT32_IMMEDIATE:  WriteImmediate (int32_t); break;
+            case DOUBLE_IMMEDIATE:
+            default:
+                WriteDataToBufferErrorCheck ("Error occuried while writing immed argument to binary buffer",
+                                                binaryBuffer, &arguments->immedArgument, sizeof (elem_t));
+                ON_DEBUG (sprintf (message + strlen (message), "%lf (size = %lu)", arguments->immedArgument, sizeof (elem_t)));
+                break;
+        }
 
-        ON_DEBUG (sprintf (message + strlen (message), "%lf (size = %lu)", arguments->immedArgument, sizeof (elem_t)));
+        #undef WriteImmediate
     }
 
     // checking if message != "Arguments: "
@@ -423,30 +1294,52 @@ static ProcessorErrorCode EmitInstructionBinary (Buffer <char> *binaryBuffer, As
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode EmitInstructionListing (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, AssemblerInstruction *instruction,
+// Integers are stored in the smallest type that fits them. Other values and -0 stay doubles
+static ImmediateFormat GetImmediateFormat (elem_t value) {
+    PushLog (4);
+
+    if (!(value >= INT32_MIN && value <= INT32_MAX)) {
+        RETURN DOUBLE_IMMEDIATE;
+    }
+
+    // compared bitwise, so -0 is not taken for an integer
+    elem_t integerValue = (int32_t) value;
+
+    if (memcmp (&integerValue, &value, sizeof (elem_t)) != 0) {
+        RETURN DOUBLE_IMMEDIATE;
+    }
+
+    if (value >= INT8_MIN && value <= INT8_MAX) {
+        RETURN INT8_IMMEDIATE;
+    }
+
+    if (value >= INT16_MIN && value <= INT16_MAX) {
+        RETURN INT16_IMMEDIATE;
+    }
+
+    RETURN INT32_IMMEDIATE;
+}
+
+static ProcessorErrorCode EmitInstructionListing (size_t address, Buffer <char> *listingBuffer, AssemblerInstruction *instruction,
                                                     InstructionArguments *arguments, TextLine *sourceLine, int lineNumber) {
     PushLog (3);
 
     custom_assert (instruction,         pointer_is_null, WRONG_INSTRUCTION);
     custom_assert (arguments,           pointer_is_null, TOO_FEW_ARGUMENTS);
     custom_assert (sourceLine,          pointer_is_null, NO_BUFFER);
-    custom_assert (binaryBuffer,        pointer_is_null, NO_BUFFER);
-    custom_assert (binaryBuffer->data,  pointer_is_null, NO_BUFFER);
     custom_assert (listingBuffer,       pointer_is_null, NO_BUFFER);
     custom_assert (listingBuffer->data, pointer_is_null, NO_BUFFER);
 
     const size_t ServiceInfoLength = 30;
-    char listingInfoBuffer [MAX_INSTRUCTION_LENGTH + ServiceInfoLength] = "";
-
-    sprintf (listingInfoBuffer, "%.4lu\t%.2x\t\t%.4d\t%s\n", binaryBuffer->currentIndex, *(unsigned char *) &instruction->commandCode,
-                 lineNumber, sourceLine->pointer + FindActualStringBegin (sourceLine));
+    char listingInfoBuffer [ServiceInfoLength] = "";
 
-    WriteDataToBufferErrorCheck ("Error occuried while writing instruction to listing buffer", listingBuffer, listingInfoBuffer, strlen (listingInfoBuffer));
+    snprintf (listingInfoBuffer, ServiceInfoLength, "%.4lu\t%.2x\t\t%.4d\t", address,
+                *(unsigned char *) &instruction->commandCode, lineNumber);
 
-    RETURN NO_PROCESSOR_ERRORS;
+    RETURN EmitListingLine (listingBuffer, listingInfoBuffer, sourceLine);
 }
 
-static ProcessorErrorCode CreateAssemblyBuffers (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, Buffer <Label> *labelsBuffer, FileBuffer *sourceFile, TextBuffer *sourceText) {
+static ProcessorErrorCode CreateAssemblyBuffers (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable, FileBuffer *sourceFile, TextBuffer *sourceText) {
     PushLog (3);
 
     custom_assert (binaryBuffer,  pointer_is_null, OUTPUT_FILE_ERROR);
@@ -455,10 +1348,10 @@ static ProcessorErrorCode CreateAssemblyBuffers (Buffer <char> *binaryBuffer, Bu
 
     // maximum difference between source and binary:
     // 2 sym  command + 1 sym   argument + 1 whitespace = 4 bytes in source
-    // 1 byte command + 8 bytes arguments               = 9 bytes in binary
+    // 1 byte command + 1 byte format + 8 bytes argument = 10 bytes in binary
     //                  |
     //                 \ /
-    // max allocation coefficient = 9 / 4 = 2.25 ---> coef = 3
+    // max allocation coefficient = 10 / 4 = 2.5 ---> coef = 3
     const size_t MaxBinaryAllocationCoefficient = 3;
 
     ProgramErrorCheck (InitBuffer (binaryBuffer, (size_t) sourceFile->buffer_size * MaxBinaryAllocationCoefficient),
@@ -481,30 +1374,30 @@ static ProcessorErrorCode CreateAssemblyBuffers (Buffer <char> *binaryBuffer, Bu
     ProgramErrorCheck (InitBuffer (listingBuffer, listingAllocationSize + sizeof (Header) * MaxHeaderAllocationCoefficient),
                                     "Unable to create listing file buffer");
 
-    // Allocating labels buffer
+    // Allocating labels table
 
-    ProgramErrorCheck (InitBuffer (labelsBuffer, MAX_LABELS_COUNT), "Unable to create labels buffer");
+    ProgramErrorCheck (InitLabelTable (labelTable, INITIAL_LABELS_CAPACITY), "Unable to create labels table");
 
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode DestroyAssemblyBuffers (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, Buffer <Label> *labelsBuffer) {
+static ProcessorErrorCode DestroyAssemblyBuffers (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, LabelTable *labelTable) {
     PushLog (4);
 
     custom_assert (binaryBuffer,  pointer_is_null, NO_BUFFER);
     custom_assert (listingBuffer, pointer_is_null, NO_BUFFER);
-    custom_assert (labelsBuffer,  pointer_is_null, NO_BUFFER);
+    custom_assert (labelTable,    pointer_is_null, NO_BUFFER);
 
     DestroyBuffer (binaryBuffer);
     DestroyBuffer (listingBuffer);
-    DestroyBuffer (labelsBuffer);
+    DestroyLabelTable (labelTable);
 
     RETURN NO_PROCESSOR_ERRORS;
 }
 
 // Instruction callback functions
 
-#define INSTRUCTION(NAME, OPCODE, PROCESSOR_CALLBACK, ...)                      \
+#define INSTRUCTION(NAME, OPCODE, FLOW, PROCESSOR_CALLBACK, ...)                \
             INSTRUCTION_CALLBACK_FUNCTION (NAME) {                              \
                 return NO_PROCESSOR_ERRORS;                                     \
             }
@@ -1,93 +1,252 @@
 #include <cstddef>
 #include <ctype.h>
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "FileFunctions.h"
 #include "AssemblyHeader.h"
 #include "CommonModules.h"
+#include "Compression.h"
 #include "CustomAssert.h"
 #include "FileIO.h"
+#include "Label.h"
 #include "Logger.h"
+#include "MessageHandler.h"
 #include "TextTypes.h"
 
-static ProcessorErrorCode WriteHeader    (int binaryDescriptor, int listingDescriptor, size_t commandsCount);
-static ProcessorErrorCode WriteDebugInfo (int binaryDescriptor, int listingDescriptor, Buffer <DebugInfoChunk> *debugInfoBuffer);
+struct SectionData {
+    SectionType type  = CODE_SECTION;
+    uint32_t    flags = 0;
 
-ProcessorErrorCode WriteDataToFiles (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, Buffer <DebugInfoChunk> *debugInfoBuffer, int binaryDescriptor, int listingDescriptor) {
+    const char *data  = NULL;
+    size_t      size  = 0;
+};
+
+static ProcessorErrorCode WriteContainer     (int binaryDescriptor, int listingDescriptor, SectionData *sections, size_t sectionsCount);
+static ProcessorErrorCode WriteHeaderListing (int listingDescriptor, Header *header, SectionEntry *sectionTable);
+static ProcessorErrorCode WriteDebugInfo     (int listingDescriptor);
+static ProcessorErrorCode CreateSymbols      (Buffer <Label> *labelsBuffer, Buffer <SymbolEntry> *symbolsBuffer);
+static ProcessorErrorCode CreateCodeSection  (Buffer <char> *binaryBuffer, Buffer <char> *compressedCode, SectionData *codeSection);
+static ProcessorErrorCode WriteListingLegend (int listingDescriptor);
+
+static ProcessorErrorCode MoveStreamedCode     (CodeStream *stream, Buffer <char> *copyBuffer, size_t codeOffset);
+static ProcessorErrorCode ChecksumStreamedCode (CodeStream *stream, Buffer <char> *copyBuffer, uint64_t *checksum);
+static ProcessorErrorCode CopyTemporaryFile    (FILE *file, int descriptor, Buffer <char> *copyBuffer, uint64_t *checksum);
+static ProcessorErrorCode WritePadding         (int descriptor, size_t writtenSize, size_t offset);
+
+static size_t AlignSectionOffset (size_t offset);
+
+ProcessorErrorCode WriteDataToFiles (Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer, Buffer <Label> *labelsBuffer,
+                                        Buffer <DebugInfoChunk> *debugInfoBuffer, Buffer <char> *constantsBuffer,
+                                        int binaryDescriptor, int listingDescriptor) {
     PushLog (2);
 
     custom_assert (binaryBuffer,           pointer_is_null,   NO_BUFFER);
     custom_assert (listingBuffer,          pointer_is_null,   NO_BUFFER);
+    custom_assert (labelsBuffer,           pointer_is_null,   NO_BUFFER);
+    custom_assert (debugInfoBuffer,        pointer_is_null,   NO_BUFFER);
+    custom_assert (constantsBuffer,        pointer_is_null,   NO_BUFFER);
     custom_assert (binaryDescriptor != -1, invalid_arguments, OUTPUT_FILE_ERROR);
 
-    ProgramErrorCheck (WriteHeader    (binaryDescriptor, listingDescriptor, debugInfoBuffer->capacity), "Error occuried while writing header");
-    ProgramErrorCheck (WriteDebugInfo (binaryDescriptor, listingDescriptor, debugInfoBuffer),           "Error occuried while writing debug info");
+    Buffer <SymbolEntry> symbolsBuffer  = {0, 0, NULL};
+    Buffer <char>        compressedCode = {0, 0, NULL};
 
-    if (!WriteBuffer (binaryDescriptor, binaryBuffer->data, (ssize_t) binaryBuffer->currentIndex)) {
-        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing to binary file");
+    SectionData sections [MAX_SECTIONS_COUNT] = {};
+    size_t sectionsCount = 0;
+
+    ProgramErrorCheck (CreateSymbols (labelsBuffer, &symbolsBuffer), "Error occuried while creating symbols section");
+
+    ProcessorErrorCode errorCode = CreateCodeSection (binaryBuffer, &compressedCode, sections + sectionsCount++);
+
+    if (errorCode != NO_PROCESSOR_ERRORS) {
+        DestroyBuffer (&symbolsBuffer);
+        ProgramErrorCheck (errorCode, "Error occuried while creating code section");
     }
 
+    sections [sectionsCount++] = {SYMBOLS_SECTION, 0, (const char *) symbolsBuffer.data, symbolsBuffer.currentIndex * sizeof (SymbolEntry)};
+
+    if (IsDebugMode ()) {
+        sections [sectionsCount++] = {DEBUG_LINES_SECTION, 0, (const char *) debugInfoBuffer->data,
+                                        debugInfoBuffer->currentIndex * sizeof (DebugInfoChunk)};
+    }
+
+    // program can not run correctly without its data
+    if (constantsBuffer->currentIndex > 0) {
+        sections [sectionsCount++] = {CONSTANTS_SECTION, REQUIRED_SECTION, constantsBuffer->data, constantsBuffer->currentIndex};
+    }
+
+    errorCode = WriteContainer (binaryDescriptor, listingDescriptor, sections, sectionsCount);
+
+    DestroyBuffer (&symbolsBuffer);
+    DestroyBuffer (&compressedCode);
+
+    ProgramErrorCheck (errorCode, "Error occuried while writing binary");
+
     if (listingDescriptor == -1) {
         RETURN NO_PROCESSOR_ERRORS;
     }
 
-    const char *ListingLegend = " ip \topcode\tline \tsource\n";
+    ProgramErrorCheck (WriteListingLegend (listingDescriptor), "Error occuried while writing listing legend");
 
-    if (!WriteBuffer (listingDescriptor, ListingLegend, (ssize_t) strlen (ListingLegend))) {
+    if (!WriteBuffer (listingDescriptor, listingBuffer->data, (ssize_t) listingBuffer->currentIndex)) {
         ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing to a listing file");
     }
 
-    if (!WriteBuffer (listingDescriptor, listingBuffer->data, (ssize_t) listingBuffer->currentIndex)) {
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode WriteListingLegend (int listingDescriptor) {
+    PushLog (3);
+
+    ProgramErrorCheck (WriteDebugInfo (listingDescriptor), "Error occuried while writing debug info");
+
+    const char *ListingLegend = " ip \topcode\tline \tsource\n";
+
+    if (!WriteBuffer (listingDescriptor, ListingLegend, (ssize_t) strlen (ListingLegend))) {
         ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing to a listing file");
     }
 
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode WriteDebugInfo (int binaryDescriptor, int listingDescriptor, Buffer <DebugInfoChunk> *debugInfoBuffer) {
+// Sections are written in the given order, each one from an aligned offset. Gaps are filled with zeroes
+static ProcessorErrorCode WriteContainer (int binaryDescriptor, int listingDescriptor, SectionData *sections, size_t sectionsCount) {
     PushLog (2);
 
-    if (!IsDebugMode ()) {
-        RETURN NO_PROCESSOR_ERRORS;
+    custom_assert (binaryDescriptor != -1,              invalid_arguments, OUTPUT_FILE_ERROR);
+    custom_assert (sections,                            pointer_is_null,   NO_BUFFER);
+    custom_assert (sectionsCount <= MAX_SECTIONS_COUNT, invalid_arguments, OUTPUT_FILE_ERROR);
+
+    Header header {};
+    InitHeader (&header);
+
+    SectionEntry sectionTable [MAX_SECTIONS_COUNT] = {};
+
+    size_t fileSize = sizeof (Header) + sizeof (SectionEntry) * sectionsCount;
+
+    for (size_t sectionIndex = 0; sectionIndex < sectionsCount; sectionIndex++) {
+        SectionData *section = sections + sectionIndex;
+
+        sectionTable [sectionIndex] = {
+            .type     = section->type,
+            .flags    = section->flags,
+            .offset   = AlignSectionOffset (fileSize),
+            .size     = section->size,
+            .checksum = ComputeChecksum (section->data, section->size, CHECKSUM_SEED),
+        };
+
+        fileSize = sectionTable [sectionIndex].offset + section->size;
     }
 
-    if (!WriteBuffer (binaryDescriptor, (char *) debugInfoBuffer->data, (ssize_t) (debugInfoBuffer->capacity * sizeof (DebugInfoChunk)))) {
-        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing debug info to a binary file");
+    header.sectionsCount = (uint32_t) sectionsCount;
+    header.fileSize      = fileSize;
+    header.checksum      = ComputeHeaderChecksum (&header, sectionTable);
+
+    if (!WriteBuffer (binaryDescriptor, (char *) &header, sizeof (header))) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing header to a binary file");
+    }
+
+    if (!WriteBuffer (binaryDescriptor, (char *) sectionTable, (ssize_t) (sizeof (SectionEntry) * sectionsCount))) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing section table to a binary file");
+    }
+
+    size_t writtenSize = sizeof (Header) + sizeof (SectionEntry) * sectionsCount;
+
+    for (size_t sectionIndex = 0; sectionIndex < sectionsCount; sectionIndex++) {
+        SectionEntry *entry = sectionTable + sectionIndex;
+
+        ProcessorErrorCode errorCode = WritePadding (binaryDescriptor, writtenSize, entry->offset);
+        ProgramErrorCheck (errorCode, "Error occuried while writing section padding to a binary file");
+
+        if (entry->size > 0 && !WriteBuffer (binaryDescriptor, sections [sectionIndex].data, (ssize_t) entry->size)) {
+            ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing section to a binary file");
+        }
+
+        writtenSize = entry->offset + entry->size;
     }
 
     if (listingDescriptor == -1) {
         RETURN NO_PROCESSOR_ERRORS;
     }
 
-    const char DebugInfoLegend [] = "DEBUG INFO:\n";
+    RETURN WriteHeaderListing (listingDescriptor, &header, sectionTable);
+}
 
-    if (!WriteBuffer (listingDescriptor, DebugInfoLegend, sizeof (DebugInfoLegend) - 1)) {
-        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing header to listing file");
+// Compressed code is written only if it is smaller than the original one
+static ProcessorErrorCode CreateCodeSection (Buffer <char> *binaryBuffer, Buffer <char> *compressedCode, SectionData *codeSection) {
+    PushLog (3);
+
+    custom_assert (binaryBuffer,   pointer_is_null, NO_BUFFER);
+    custom_assert (compressedCode, pointer_is_null, NO_BUFFER);
+    custom_assert (codeSection,    pointer_is_null, NO_BUFFER);
+
+    *codeSection = {CODE_SECTION, REQUIRED_SECTION, binaryBuffer->data, binaryBuffer->currentIndex};
+
+    if (!IsCodeCompressed ()) {
+        RETURN NO_PROCESSOR_ERRORS;
     }
 
-    // TODO write debug info to listing
+    ProgramErrorCheck (CompressSection (binaryBuffer->data, binaryBuffer->currentIndex, compressedCode), "Error occuried while compressing code");
+
+    if (compressedCode->currentIndex >= binaryBuffer->currentIndex) {
+        PrintWarningMessage (NO_PROCESSOR_ERRORS, "Code can not be compressed. Writing it uncompressed.", NULL, NULL, -1);
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    *codeSection = {CODE_SECTION, REQUIRED_SECTION | COMPRESSED_SECTION, compressedCode->data, compressedCode->currentIndex};
 
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode WriteHeader (int binaryDescriptor, int listingDescriptor, size_t commandsCount) {
-    PushLog (2);
-    custom_assert (binaryDescriptor != -1, invalid_arguments, OUTPUT_FILE_ERROR);
+static ProcessorErrorCode CreateSymbols (Buffer <Label> *labelsBuffer, Buffer <SymbolEntry> *symbolsBuffer) {
+    PushLog (3);
 
-    Header header {};
-    InitHeader (&header);
+    custom_assert (labelsBuffer,  pointer_is_null, NO_BUFFER);
+    custom_assert (symbolsBuffer, pointer_is_null, NO_BUFFER);
 
-    header.commandsCount = commandsCount;
+    ProgramErrorCheck (InitBuffer (symbolsBuffer, labelsBuffer->currentIndex + 1), "Unable to create symbols buffer");
 
-    if (!WriteBuffer (binaryDescriptor, (char *) &header, sizeof (header))) {
-        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing header to a binary file");
+    // labels are saved in source order, so their addresses are ascending
+    for (size_t labelIndex = 0; labelIndex < labelsBuffer->currentIndex; labelIndex++) {
+        Label *label = labelsBuffer->data + labelIndex;
+
+        SymbolEntry *symbol = symbolsBuffer->data + symbolsBuffer->currentIndex++;
+
+        // longer names are cut, symbol name stays null-terminated
+        size_t nameLength = label->nameLength < SYMBOL_NAME_LENGTH - 1 ? label->nameLength : SYMBOL_NAME_LENGTH - 1;
+
+        symbol->address = (uint64_t) label->address;
+        memcpy (symbol->name, label->name, nameLength);
     }
 
-    if (listingDescriptor == -1) {
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode WriteDebugInfo (int listingDescriptor) {
+    PushLog (2);
+
+    if (!IsDebugMode ()) {
         RETURN NO_PROCESSOR_ERRORS;
     }
 
+    const char DebugInfoLegend [] = "DEBUG INFO:\n";
+
+    if (!WriteBuffer (listingDescriptor, DebugInfoLegend, sizeof (DebugInfoLegend) - 1)) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing header to listing file");
+    }
+
+    // TODO write debug info to listing
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode WriteHeaderListing (int listingDescriptor, Header *header, SectionEntry *sectionTable) {
+    PushLog (2);
+
+    custom_assert (header,       pointer_is_null, WRONG_HEADER);
+    custom_assert (sectionTable, pointer_is_null, WRONG_HEADER);
+
     const char HeaderLegend [] = "HEADER:\n";
 
     if (!WriteBuffer (listingDescriptor, HeaderLegend, (ssize_t) sizeof (HeaderLegend) - 1)) {
@@ -97,14 +256,21 @@ static ProcessorErrorCode WriteHeader (int binaryDescriptor, int listingDescript
     const size_t ListingHeaderBufferMaxSize = 256;
 
     Buffer <char> listingHeaderBuffer {};
-    InitBuffer (&listingHeaderBuffer, sizeof (header) * ListingHeaderBufferMaxSize);
+    InitBuffer (&listingHeaderBuffer, sizeof (Header) * ListingHeaderBufferMaxSize);
+
+    WriteHeaderField (&listingHeaderBuffer, header, signature, sizeof (uint16_t));
+    WriteHeaderField (&listingHeaderBuffer, header, version,   sizeof (VERSION) - 1);
+
+    for (size_t sectionIndex = 0; sectionIndex < header->sectionsCount; sectionIndex++) {
+        SectionEntry *section = sectionTable + sectionIndex;
 
-    WriteHeaderField (&listingHeaderBuffer, &header, signature,     sizeof (unsigned short));
-    WriteHeaderField (&listingHeaderBuffer, &header, version,       sizeof (VERSION) - 1);
-    WriteHeaderField (&listingHeaderBuffer, &header, byteOrder,     sizeof (SYSTEM_BYTE_ORDER) - 1);
+        char sectionLine [MAX_INSTRUCTION_LENGTH] = "";
+        int  lineLength = snprintf (sectionLine, MAX_INSTRUCTION_LENGTH, "\tsection:  %s, offset %lu, size %lu%s\n",
+                                        GetSectionName (section->type), section->offset, section->size,
+                                        (section->flags & COMPRESSED_SECTION) ? ", compressed" : "");
 
-    // TODO rewrite this macro
-    //WriteHeaderField (&listingHeaderBuffer, &header, commandsCount, sizeof (size_t));
+        WriteDataToBufferErrorCheck ("Error occuried while writing section to listing file", &listingHeaderBuffer, sectionLine, (size_t) lineLength);
+    }
 
     WriteDataToBufferErrorCheck ("Error occuried while writing new line to listing file", &listingHeaderBuffer, "\n\n", strlen ("\n\n"));
 
@@ -114,6 +280,345 @@ static ProcessorErrorCode WriteHeader (int binaryDescriptor, int listingDescript
 
     DestroyBuffer (&listingHeaderBuffer);
 
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Code section follows the section table, then symbols, debug lines and constants go, as in WriteDataToFiles.
+// Table has room for the constants entry, as it is not known yet whether the source has data directives.
+// Code is moved over the unused entry when the stream is closed, so the layout is the same as in WriteDataToFiles
+ProcessorErrorCode OpenCodeStream (CodeStream *stream, int binaryDescriptor, int listingDescriptor) {
+    PushLog (2);
+
+    custom_assert (stream,                 pointer_is_null,   NO_BUFFER);
+    custom_assert (binaryDescriptor != -1, invalid_arguments, OUTPUT_FILE_ERROR);
+
+    *stream = {};
+
+    stream->binaryDescriptor  = binaryDescriptor;
+    stream->listingDescriptor = listingDescriptor;
+    stream->sectionsCount     = IsDebugMode () ? 3 : 2;
+    stream->codeOffset        = AlignSectionOffset (sizeof (Header) + sizeof (SectionEntry) * (stream->sectionsCount + 1));
+
+    if (IsCodeCompressed ()) {
+        PrintWarningMessage (NO_PROCESSOR_ERRORS, "Code is not compressed in streaming mode", NULL, NULL, -1);
+    }
+
+    if (listingDescriptor != -1 && !(stream->listingFile = tmpfile ())) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Unable to create temporary listing file");
+    }
+
+    if (IsDebugMode () && !(stream->debugInfoFile = tmpfile ())) {
+        DestroyCodeStream (stream);
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Unable to create temporary debug info file");
+    }
+
+    // header and section table are written over the gap when the code ends
+    if (lseek (binaryDescriptor, (off_t) stream->codeOffset, SEEK_SET) < 0) {
+        DestroyCodeStream (stream);
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Unable to seek to the code section of a binary file");
+    }
 
     RETURN NO_PROCESSOR_ERRORS;
 }
+
+ProcessorErrorCode FlushCodeStream (CodeStream *stream, Buffer <char> *binaryBuffer, Buffer <char> *listingBuffer,
+                                        Buffer <DebugInfoChunk> *debugInfoBuffer, Buffer <char> *constantsBuffer) {
+    PushLog (3);
+
+    custom_assert (stream,          pointer_is_null, NO_BUFFER);
+    custom_assert (binaryBuffer,    pointer_is_null, NO_BUFFER);
+    custom_assert (listingBuffer,   pointer_is_null, NO_BUFFER);
+    custom_assert (debugInfoBuffer, pointer_is_null, NO_BUFFER);
+    custom_assert (constantsBuffer, pointer_is_null, NO_BUFFER);
+
+    if (binaryBuffer->currentIndex > 0 &&
+            !WriteBuffer (stream->binaryDescriptor, binaryBuffer->data, (ssize_t) binaryBuffer->currentIndex)) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing code to a binary file");
+    }
+
+    stream->codeSize           += binaryBuffer->currentIndex;
+    binaryBuffer->currentIndex  = 0;
+
+    if (stream->listingFile &&
+            fwrite (listingBuffer->data, sizeof (char), listingBuffer->currentIndex, stream->listingFile) != listingBuffer->currentIndex) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing to a temporary listing file");
+    }
+
+    listingBuffer->currentIndex = 0;
+
+    if (stream->debugInfoFile &&
+            fwrite (debugInfoBuffer->data, sizeof (DebugInfoChunk), debugInfoBuffer->currentIndex, stream->debugInfoFile) != debugInfoBuffer->currentIndex) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing to a temporary debug info file");
+    }
+
+    debugInfoBuffer->currentIndex = 0;
+
+    if (constantsBuffer->currentIndex == 0) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    if (!stream->constantsFile && !(stream->constantsFile = tmpfile ())) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Unable to create temporary constants file");
+    }
+
+    if (fwrite (constantsBuffer->data, sizeof (char), constantsBuffer->currentIndex, stream->constantsFile) != constantsBuffer->currentIndex) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing to a temporary constants file");
+    }
+
+    constantsBuffer->currentIndex = 0;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode PatchStreamedCode (CodeStream *stream, size_t address, const void *data, size_t size) {
+    PushLog (3);
+
+    custom_assert (stream, pointer_is_null, NO_BUFFER);
+    custom_assert (data,   pointer_is_null, NO_BUFFER);
+
+    if (address + size > stream->codeSize ||
+            pwrite (stream->binaryDescriptor, data, size, (off_t) (stream->codeOffset + address)) != (ssize_t) size) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while patching code in a binary file");
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode CloseCodeStream (CodeStream *stream, Buffer <Label> *labelsBuffer) {
+    PushLog (2);
+
+    custom_assert (stream,       pointer_is_null, NO_BUFFER);
+    custom_assert (labelsBuffer, pointer_is_null, NO_BUFFER);
+
+    Buffer <SymbolEntry> symbolsBuffer = {0, 0, NULL};
+    Buffer <char>        copyBuffer    = {0, 0, NULL};
+
+    Header header {};
+    InitHeader (&header);
+
+    SectionEntry sectionTable [MAX_SECTIONS_COUNT] = {};
+    uint64_t     codeChecksum                      = CHECKSUM_SEED;
+
+    #define CloseIfErrorsWereFound(message, ...)                                                        \
+        do {                                                                                            \
+            ProcessorErrorCode errorCode_ = (__VA_ARGS__);                                              \
+            if (errorCode_ != NO_PROCESSOR_ERRORS) {                                                    \
+                DestroyBuffer (&symbolsBuffer);                                                         \
+                DestroyBuffer (&copyBuffer);                                                            \
+                DestroyCodeStream (stream);                                                             \
+                ProgramErrorCheck (errorCode_, message);                                                \
+            }                                                                                           \
+        } while (0)
+
+    CloseIfErrorsWereFound ("Unable to create copy buffer",                   InitBuffer (&copyBuffer, STREAM_BUFFER_SIZE));
+    CloseIfErrorsWereFound ("Error occuried while creating symbols section", CreateSymbols (labelsBuffer, &symbolsBuffer));
+
+    if (!stream->constantsFile) {
+        CloseIfErrorsWereFound ("Error occuried while moving code",
+                                    MoveStreamedCode (stream, &copyBuffer,
+                                                        AlignSectionOffset (sizeof (Header) + sizeof (SectionEntry) * stream->sectionsCount)));
+    }
+
+    CloseIfErrorsWereFound ("Error occuried while reading code back",        ChecksumStreamedCode (stream, &copyBuffer, &codeChecksum));
+
+    sectionTable [0] = {CODE_SECTION, REQUIRED_SECTION, stream->codeOffset, stream->codeSize, codeChecksum};
+
+    size_t symbolsSize = symbolsBuffer.currentIndex * sizeof (SymbolEntry);
+    size_t writtenSize = stream->codeOffset + stream->codeSize;
+
+    sectionTable [1] = {SYMBOLS_SECTION, 0, AlignSectionOffset (writtenSize), symbolsSize,
+                            ComputeChecksum (symbolsBuffer.data, symbolsSize, CHECKSUM_SEED)};
+
+    CloseIfErrorsWereFound ("Error occuried while writing section padding to a binary file",
+                                WritePadding (stream->binaryDescriptor, writtenSize, sectionTable [1].offset));
+
+    if (symbolsSize > 0 && !WriteBuffer (stream->binaryDescriptor, (const char *) symbolsBuffer.data, (ssize_t) symbolsSize)) {
+        CloseIfErrorsWereFound ("Error occuried while writing section to a binary file", OUTPUT_FILE_ERROR);
+    }
+
+    writtenSize = sectionTable [1].offset + symbolsSize;
+
+    if (stream->debugInfoFile) {
+        sectionTable [2] = {DEBUG_LINES_SECTION, 0, AlignSectionOffset (writtenSize), 0, CHECKSUM_SEED};
+
+        CloseIfErrorsWereFound ("Error occuried while writing section padding to a binary file",
+                                    WritePadding (stream->binaryDescriptor, writtenSize, sectionTable [2].offset));
+        CloseIfErrorsWereFound ("Error occuried while writing debug lines to a binary file",
+                                    CopyTemporaryFile (stream->debugInfoFile, stream->binaryDescriptor, &copyBuffer, &sectionTable [2].checksum));
+
+        sectionTable [2].size = (uint64_t) ftell (stream->debugInfoFile);
+        writtenSize           = sectionTable [2].offset + sectionTable [2].size;
+    }
+
+    if (stream->constantsFile) {
+        SectionEntry *constants = sectionTable + stream->sectionsCount++;
+
+        *constants = {CONSTANTS_SECTION, REQUIRED_SECTION, AlignSectionOffset (writtenSize), 0, CHECKSUM_SEED};
+
+        CloseIfErrorsWereFound ("Error occuried while writing section padding to a binary file",
+                                    WritePadding (stream->binaryDescriptor, writtenSize, constants->offset));
+        CloseIfErrorsWereFound ("Error occuried while writing constants to a binary file",
+                                    CopyTemporaryFile (stream->constantsFile, stream->binaryDescriptor, &copyBuffer, &constants->checksum));
+
+        constants->size = (uint64_t) ftell (stream->constantsFile);
+        writtenSize     = constants->offset + constants->size;
+    }
+
+    header.sectionsCount = (uint32_t) stream->sectionsCount;
+    header.fileSize      = writtenSize;
+    header.checksum      = ComputeHeaderChecksum (&header, sectionTable);
+
+    size_t tableSize = sizeof (SectionEntry) * stream->sectionsCount;
+
+    if (pwrite (stream->binaryDescriptor, &header, sizeof (header), 0) != sizeof (header) ||
+            pwrite (stream->binaryDescriptor, sectionTable, tableSize, sizeof (header)) != (ssize_t) tableSize) {
+        CloseIfErrorsWereFound ("Error occuried while writing header to a binary file", OUTPUT_FILE_ERROR);
+    }
+
+    // moved code leaves its old tail after the last section
+    if (ftruncate (stream->binaryDescriptor, (off_t) writtenSize) != 0) {
+        CloseIfErrorsWereFound ("Error occuried while truncating a binary file", OUTPUT_FILE_ERROR);
+    }
+
+    if (stream->listingFile) {
+        CloseIfErrorsWereFound ("Error occuried while writing header to listing file",
+                                    WriteHeaderListing (stream->listingDescriptor, &header, sectionTable));
+        CloseIfErrorsWereFound ("Error occuried while writing listing legend",
+                                    WriteListingLegend (stream->listingDescriptor));
+        CloseIfErrorsWereFound ("Error occuried while writing to a listing file",
+                                    CopyTemporaryFile (stream->listingFile, stream->listingDescriptor, &copyBuffer, NULL));
+    }
+
+    #undef CloseIfErrorsWereFound
+
+    DestroyBuffer (&symbolsBuffer);
+    DestroyBuffer (&copyBuffer);
+
+    RETURN DestroyCodeStream (stream);
+}
+
+ProcessorErrorCode DestroyCodeStream (CodeStream *stream) {
+    PushLog (3);
+
+    custom_assert (stream, pointer_is_null, NO_BUFFER);
+
+    if (stream->listingFile) {
+        fclose (stream->listingFile);
+    }
+
+    if (stream->debugInfoFile) {
+        fclose (stream->debugInfoFile);
+    }
+
+    if (stream->constantsFile) {
+        fclose (stream->constantsFile);
+    }
+
+    stream->listingFile   = NULL;
+    stream->debugInfoFile = NULL;
+    stream->constantsFile = NULL;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Code is read in pieces, as it has been patched after it was written
+// Code only moves towards the file beginning, so it is copied from its start without overwriting the unread part
+static ProcessorErrorCode MoveStreamedCode (CodeStream *stream, Buffer <char> *copyBuffer, size_t codeOffset) {
+    PushLog (3);
+
+    custom_assert (codeOffset <= stream->codeOffset, invalid_arguments, OUTPUT_FILE_ERROR);
+
+    if (codeOffset == stream->codeOffset) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    for (size_t movedSize = 0; movedSize < stream->codeSize;) {
+        size_t  pieceSize  = stream->codeSize - movedSize < copyBuffer->capacity ? stream->codeSize - movedSize : copyBuffer->capacity;
+        ssize_t readResult = pread (stream->binaryDescriptor, copyBuffer->data, pieceSize, (off_t) (stream->codeOffset + movedSize));
+
+        if (readResult <= 0 ||
+                pwrite (stream->binaryDescriptor, copyBuffer->data, (size_t) readResult, (off_t) (codeOffset + movedSize)) != readResult) {
+            ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while moving code in a binary file");
+        }
+
+        movedSize += (size_t) readResult;
+    }
+
+    stream->codeOffset = codeOffset;
+
+    if (lseek (stream->binaryDescriptor, (off_t) (stream->codeOffset + stream->codeSize), SEEK_SET) < 0) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Unable to seek to the code end of a binary file");
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode ChecksumStreamedCode (CodeStream *stream, Buffer <char> *copyBuffer, uint64_t *checksum) {
+    PushLog (3);
+
+    for (size_t readSize = 0; readSize < stream->codeSize;) {
+        size_t  pieceSize  = stream->codeSize - readSize < copyBuffer->capacity ? stream->codeSize - readSize : copyBuffer->capacity;
+        ssize_t readResult = pread (stream->binaryDescriptor, copyBuffer->data, pieceSize, (off_t) (stream->codeOffset + readSize));
+
+        if (readResult <= 0) {
+            ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while reading code from a binary file");
+        }
+
+        *checksum  = ComputeChecksum (copyBuffer->data, (size_t) readResult, *checksum);
+        readSize  += (size_t) readResult;
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Checksum of the copied data is computed if it is not NULL
+static ProcessorErrorCode CopyTemporaryFile (FILE *file, int descriptor, Buffer <char> *copyBuffer, uint64_t *checksum) {
+    PushLog (3);
+
+    custom_assert (file,       pointer_is_null, OUTPUT_FILE_ERROR);
+    custom_assert (copyBuffer, pointer_is_null, NO_BUFFER);
+
+    if (fflush (file) != 0) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing temporary file");
+    }
+
+    long fileSize = ftell (file);
+    rewind (file);
+
+    for (size_t readSize = 0; readSize < (size_t) fileSize;) {
+        size_t pieceSize = fread (copyBuffer->data, sizeof (char), copyBuffer->capacity, file);
+
+        if (pieceSize == 0) {
+            ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while reading temporary file");
+        }
+
+        if (checksum) {
+            *checksum = ComputeChecksum (copyBuffer->data, pieceSize, *checksum);
+        }
+
+        if (!WriteBuffer (descriptor, copyBuffer->data, (ssize_t) pieceSize)) {
+            ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing data from temporary file");
+        }
+
+        readSize += pieceSize;
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Gap between the written data and the next section is filled with zeroes
+static ProcessorErrorCode WritePadding (int descriptor, size_t writtenSize, size_t offset) {
+    PushLog (4);
+
+    const char Padding [SECTION_ALIGNMENT] = {};
+
+    if (offset > writtenSize && !WriteBuffer (descriptor, Padding, (ssize_t) (offset - writtenSize))) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing padding");
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static size_t AlignSectionOffset (size_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
@@ -1,59 +1,191 @@
+#include <stdlib.h>
 #include <string.h>
 
 #include "Label.h"
 #include "Buffer.h"
 #include "CustomAssert.h"
 
-ProcessorErrorCode InitLabel (Label *label, char *name, long long address) {
+static ProcessorErrorCode GrowLabelTable (LabelTable *table);
+static size_t            *FindLabelSlot  (LabelTable *table, Label *label);
+
+ProcessorErrorCode InitLabel (Label *label, const char *name, size_t nameLength, long long address) {
     PushLog (4);
 
     custom_assert (label, pointer_is_null, WRONG_LABEL);
     custom_assert (name,  pointer_is_null, WRONG_LABEL);
 
-    strcpy (label->name, name);
-    label->address = address;
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325;
+
+    for (size_t symbolIndex = 0; symbolIndex < nameLength; symbolIndex++) {
+        hash = (hash ^ (unsigned char) name [symbolIndex]) * 0x100000001b3;
+    }
+
+    label->name       = name;
+    label->nameLength = nameLength;
+    label->hash       = hash;
+    label->address    = address;
 
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-long long LabelComparator (void *value1, void *value2) {
-    PushLog (4);
+ProcessorErrorCode InitLabelTable (LabelTable *table, size_t capacity) {
+    PushLog (3);
+
+    custom_assert (table, pointer_is_null, NO_BUFFER);
+
+    size_t slotsCount = 1;
+
+    while (slotsCount < capacity * 2) {
+        slotsCount *= 2;
+    }
 
-    custom_assert (value1, pointer_is_null, -1);
-    custom_assert (value2, pointer_is_null, -1);
+    ProgramErrorCheck (InitBuffer (&table->labels, capacity), "Unable to create labels buffer");
 
-    long long addressDiff = LabelComparatorByAddress (value1, value2);
+    table->slots      = (size_t *) calloc (slotsCount, sizeof (size_t));
+    table->slotsCount = slotsCount;
 
-    if (addressDiff) {
-        return addressDiff;
+    if (!table->slots) {
+        DestroyBuffer (&table->labels);
+        ProgramErrorCheck (NO_BUFFER, "Unable to create label slots");
     }
 
-    RETURN LabelComparatorByName (value1, value2);
+    RETURN NO_PROCESSOR_ERRORS;
 }
 
-long long LabelComparatorByName (void *value1, void *value2) {
-    PushLog (4);
+ProcessorErrorCode DestroyLabelTable (LabelTable *table) {
+    PushLog (3);
+
+    custom_assert (table, pointer_is_null, NO_BUFFER);
+
+    for (size_t nameIndex = 0; nameIndex < table->ownedNames.currentIndex; nameIndex++) {
+        free (table->ownedNames.data [nameIndex]);
+    }
+
+    DestroyBuffer (&table->labels);
+    DestroyBuffer (&table->ownedNames);
+    free (table->slots);
+
+    table->labels     = {0, 0, NULL};
+    table->ownedNames = {0, 0, NULL};
+    table->slots      = NULL;
+    table->slotsCount = 0;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode AddLabel (LabelTable *table, Label *label) {
+    PushLog (3);
+
+    custom_assert (table, pointer_is_null, NO_BUFFER);
+    custom_assert (label, pointer_is_null, WRONG_LABEL);
+
+    if ((table->labels.currentIndex + 1) * 2 > table->slotsCount) {
+        ProgramErrorCheck (GrowLabelTable (table), "Error occuried while growing label table");
+    }
+
+    size_t *slot = FindLabelSlot (table, label);
+
+    if (*slot != 0) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    if (table->copyNames) {
+        ProgramErrorCheck (KeepLabelName (table, label), "Error occuried while copying label name");
+    }
+
+    ProgramErrorCheck (WriteDataToBuffer (&table->labels, label, 1), "Error occuried while writing label to buffer");
+
+    *slot = table->labels.currentIndex;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode KeepLabelName (LabelTable *table, Label *label) {
+    PushLog (3);
+
+    custom_assert (table, pointer_is_null, NO_BUFFER);
+    custom_assert (label, pointer_is_null, WRONG_LABEL);
+
+    char *name = (char *) calloc (label->nameLength + 1, sizeof (char));
+
+    if (!name) {
+        ProgramErrorCheck (NO_BUFFER, "Unable to allocate label name");
+    }
+
+    memcpy (name, label->name, label->nameLength);
+
+    ProcessorErrorCode errorCode = WriteDataToBuffer (&table->ownedNames, &name, 1);
+
+    if (errorCode != NO_PROCESSOR_ERRORS) {
+        free (name);
+        ProgramErrorCheck (errorCode, "Error occuried while saving label name");
+    }
+
+    label->name = name;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
 
-    custom_assert (value1, pointer_is_null, -1);
-    custom_assert (value2, pointer_is_null, -1);
+Label *FindLabel (LabelTable *table, Label *label) {
+    PushLog (3);
 
-    Label *label1 = (Label *) value1;
-    Label *label2 = (Label *) value2;
+    custom_assert (table, pointer_is_null, NULL);
+    custom_assert (label, pointer_is_null, NULL);
 
-    RETURN strcmp (label1->name, label2->name);
+    size_t *slot = FindLabelSlot (table, label);
+
+    if (*slot == 0) {
+        RETURN NULL;
+    }
+
+    RETURN table->labels.data + *slot - 1;
 }
 
-long long LabelComparatorByAddress (void *value1, void *value2) {
+// Slot of the label or the empty slot where it has to be placed
+static size_t *FindLabelSlot (LabelTable *table, Label *label) {
     PushLog (4);
 
-    custom_assert (value1, pointer_is_null, -1);
-    custom_assert (value2, pointer_is_null, -1);
+    size_t slotMask  = table->slotsCount - 1;
+    size_t slotIndex = label->hash & slotMask;
+
+    for (;; slotIndex = (slotIndex + 1) & slotMask) {
+        size_t *slot = table->slots + slotIndex;
 
-    Label *label1 = (Label *) value1;
-    Label *label2 = (Label *) value2;
+        if (*slot == 0) {
+            RETURN slot;
+        }
 
-    long long addressDiff = label1->address - label2->address;
+        Label *storedLabel = table->labels.data + *slot - 1;
 
-    RETURN addressDiff;
+        if (storedLabel->hash == label->hash && storedLabel->nameLength == label->nameLength &&
+                memcmp (storedLabel->name, label->name, label->nameLength) == 0) {
+            RETURN slot;
+        }
+    }
 }
 
+// Slots are doubled and filled again from the stored hashes
+static ProcessorErrorCode GrowLabelTable (LabelTable *table) {
+    PushLog (4);
+
+    size_t *oldSlots      = table->slots;
+    size_t  oldSlotsCount = table->slotsCount;
+
+    table->slotsCount = oldSlotsCount * 2;
+    table->slots      = (size_t *) calloc (table->slotsCount, sizeof (size_t));
+
+    if (!table->slots) {
+        table->slots      = oldSlots;
+        table->slotsCount = oldSlotsCount;
+        ProgramErrorCheck (NO_BUFFER, "Unable to reallocate label slots");
+    }
+
+    for (size_t labelIndex = 0; labelIndex < table->labels.currentIndex; labelIndex++) {
+        *FindLabelSlot (table, table->labels.data + labelIndex) = labelIndex + 1;
+    }
+
+    free (oldSlots);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
@@ -0,0 +1,265 @@
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Lexer.h"
+#include "CustomAssert.h"
+#include "Logger.h"
+#include "MessageHandler.h"
+#include "Registers.h"
+
+const size_t MAX_EXACT_DIGITS = 15;             // any integer with that many digits is exact in double
+
+static bool ParseNumber  (const char *begin, const char **end, elem_t *value);
+static bool IsNumberBegin (const char *symbol);
+static bool IsDelimiter  (char symbol);
+
+static const char *SkipWord (const char *symbol);
+
+static void ClassifyWord (Token *token);
+
+ProcessorErrorCode TokenizeLine (TextLine *line, TokenizedLine *tokenizedLine, int lineNumber) {
+    PushLog (3);
+
+    custom_assert (line,          pointer_is_null, NO_BUFFER);
+    custom_assert (line->pointer, pointer_is_null, NO_BUFFER);
+    custom_assert (tokenizedLine, pointer_is_null, NO_BUFFER);
+
+    Token      *tokens = tokenizedLine->tokens;
+    const char *symbol = line->pointer;
+
+    tokenizedLine->tokensCount = 0;
+
+    while (true) {
+        while (isspace (*symbol)) {
+            symbol++;
+        }
+
+        if (*symbol == '\0' || *symbol == ';') {
+            break;
+        }
+
+        if (tokens [0].type == LABEL_DEFINITION_TOKEN && tokenizedLine->tokensCount > 0) {
+            SyntaxErrorCheck (WRONG_LABEL, "Label definition has to be the only one in the line", line, lineNumber);
+        }
+
+        if (*symbol == ':') {
+            if (tokenizedLine->tokensCount != 1 || tokens [0].type != MNEMONIC_TOKEN) {
+                SyntaxErrorCheck (WRONG_LABEL, "Only the first word of the line can be a label", line, lineNumber);
+            }
+
+            tokens [0].type = LABEL_DEFINITION_TOKEN;
+            symbol++;
+            continue;
+        }
+
+        if (tokenizedLine->tokensCount >= MAX_LINE_TOKENS) {
+            SyntaxErrorCheck (TOO_MANY_ARGUMENTS, "Too many arguments for this command", line, lineNumber);
+        }
+
+        Token *token = tokens + tokenizedLine->tokensCount++;
+        *token        = {};
+        token->begin  = symbol;
+        token->length = 1;
+
+        switch (*symbol) {
+            case '[': token->type = OPEN_BRACKET_TOKEN;  symbol++; continue;
+            case ']': token->type = CLOSE_BRACKET_TOKEN; symbol++; continue;
+            case '+': token->type = PLUS_TOKEN;          symbol++; continue;
+            default:                                               break;
+        }
+
+        if (tokenizedLine->tokensCount == 1) {
+            symbol        = SkipWord (symbol);
+            token->type   = MNEMONIC_TOKEN;
+            token->length = (size_t) (symbol - token->begin);
+            continue;
+        }
+
+        if (IsNumberBegin (symbol)) {
+            token->type = IMMEDIATE_TOKEN;
+
+            if (!ParseNumber (symbol, &symbol, &token->value) || !IsDelimiter (*symbol)) {
+                SyntaxErrorCheck (WRONG_INSTRUCTION, "Wrong number format", line, lineNumber);
+            }
+
+            token->length = (size_t) (symbol - token->begin);
+            continue;
+        }
+
+        symbol        = SkipWord (symbol);
+        token->length = (size_t) (symbol - token->begin);
+
+        ClassifyWord (token);
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+bool IsDataDirective (TextLine *line) {
+    PushLog (3);
+
+    custom_assert (line,          pointer_is_null, false);
+    custom_assert (line->pointer, pointer_is_null, false);
+
+    const char *symbol = line->pointer;
+
+    while (isspace (*symbol)) {
+        symbol++;
+    }
+
+    RETURN strncmp (symbol, DATA_DIRECTIVE, sizeof (DATA_DIRECTIVE) - 1) == 0 && IsDelimiter (symbol [sizeof (DATA_DIRECTIVE) - 1]);
+}
+
+ProcessorErrorCode TokenizeDataDirective (TextLine *line, size_t *address, Buffer <char> *valuesBuffer, int lineNumber) {
+    PushLog (3);
+
+    custom_assert (line,          pointer_is_null, NO_BUFFER);
+    custom_assert (line->pointer, pointer_is_null, NO_BUFFER);
+    custom_assert (address,       pointer_is_null, NO_BUFFER);
+    custom_assert (valuesBuffer,  pointer_is_null, NO_BUFFER);
+
+    const char *symbol = line->pointer;
+
+    while (isspace (*symbol)) {
+        symbol++;
+    }
+
+    symbol += sizeof (DATA_DIRECTIVE) - 1;
+
+    while (isspace (*symbol)) {
+        symbol++;
+    }
+
+    char *addressEnd = NULL;
+
+    if (*symbol != '[' || !isdigit (symbol [1])) {
+        SyntaxErrorCheck (WRONG_ADDRESS, "Data directive needs ram address in brackets", line, lineNumber);
+    }
+
+    *address = strtoul (symbol + 1, &addressEnd, 10);
+
+    if (*addressEnd != ']') {
+        SyntaxErrorCheck (WRONG_ADDRESS, "Data directive needs ram address in brackets", line, lineNumber);
+    }
+
+    symbol = addressEnd + 1;
+
+    while (true) {
+        while (isspace (*symbol)) {
+            symbol++;
+        }
+
+        if (*symbol == '\0' || *symbol == ';') {
+            break;
+        }
+
+        elem_t value = 0;
+
+        if (!ParseNumber (symbol, &symbol, &value) || !IsDelimiter (*symbol)) {
+            SyntaxErrorCheck (WRONG_INSTRUCTION, "Wrong number format", line, lineNumber);
+        }
+
+        ProgramErrorCheck (WriteDataToBuffer (valuesBuffer, &value, sizeof (value)), "Error occuried while writing data value to a buffer");
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Register name, special value (inf or nan) or label
+static void ClassifyWord (Token *token) {
+    PushLog (4);
+
+    token->type = LABEL_TOKEN;
+
+    if (token->length <= MAX_REGISTER_NAME_LENGTH) {
+        char registerName [MAX_REGISTER_NAME_LENGTH + 1] = "";
+        memcpy (registerName, token->begin, token->length);
+
+        const Register *foundRegister = FindRegisterByName (registerName);
+
+        if (foundRegister) {
+            token->type          = REGISTER_TOKEN;
+            token->registerIndex = foundRegister->index;
+            RETURN;
+        }
+    }
+
+    const char *first = token->begin;
+
+    if (*first == '-' || *first == '+') {
+        first++;
+    }
+
+    if (tolower (*first) == 'i' || tolower (*first) == 'n') {
+        const char *numberEnd = NULL;
+
+        if (ParseNumber (token->begin, &numberEnd, &token->value) && numberEnd == token->begin + token->length) {
+            token->type = IMMEDIATE_TOKEN;
+        }
+    }
+
+    RETURN;
+}
+
+// Decimal integers which are exact in double are parsed here, anything else is left to strtod
+static bool ParseNumber (const char *begin, const char **end, elem_t *value) {
+    PushLog (4);
+
+    const char *symbol     = begin;
+    bool        isNegative = *symbol == '-';
+
+    if (*symbol == '-' || *symbol == '+') {
+        symbol++;
+    }
+
+    uint64_t integer      = 0;
+    size_t   digitsCount  = 0;
+
+    for (; isdigit (*symbol) && digitsCount < MAX_EXACT_DIGITS; symbol++, digitsCount++) {
+        integer = integer * 10 + (uint64_t) (*symbol - '0');
+    }
+
+    // fraction, exponent, hexadecimal prefix or too many digits. strchr finds the terminating '\0' too
+    bool isInteger = digitsCount > 0 && !isdigit (*symbol) && !(*symbol != '\0' && strchr (".eExX", *symbol));
+
+    if (isInteger) {
+        *value = isNegative ? -(elem_t) integer : (elem_t) integer;
+        *end   = symbol;
+        RETURN true;
+    }
+
+    char *numberEnd = NULL;
+
+    *value = strtod (begin, &numberEnd);
+    *end   = numberEnd;
+
+    RETURN numberEnd != begin;
+}
+
+static bool IsNumberBegin (const char *symbol) {
+    PushLog (4);
+
+    if (*symbol == '-' || *symbol == '+') {
+        symbol++;
+    }
+
+    RETURN isdigit (*symbol) || *symbol == '.';
+}
+
+static bool IsDelimiter (char symbol) {
+    PushLog (4);
+
+    RETURN symbol == '\0' || isspace (symbol) || strchr (";[]+:", symbol);
+}
+
+static const char *SkipWord (const char *symbol) {
+    PushLog (4);
+
+    while (!IsDelimiter (*symbol)) {
+        symbol++;
+    }
+
+    RETURN symbol;
+}
@@ -0,0 +1,449 @@
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "Optimizer.h"
+#include "Buffer.h"
+#include "CommonModules.h"
+#include "CustomAssert.h"
+#include "Label.h"
+#include "Logger.h"
+#include "MessageHandler.h"
+
+static bool Optimization = false;
+
+static bool               HasNumericJumps       (Buffer <ParsedLine> *program);
+static ProcessorErrorCode RemoveUnreachableCode (Buffer <ParsedLine> *program, size_t *removedCount);
+static ProcessorErrorCode SplitIntoBlocks       (Buffer <ParsedLine> *program, Buffer <size_t> *blockStarts, LabelTable *blockLabels);
+static ProcessorErrorCode MarkReachableBlocks   (Buffer <ParsedLine> *program, Buffer <size_t> *blockStarts, LabelTable *blockLabels,
+                                                    bool *isReachable);
+static ProcessorErrorCode RunPeepholeOptimizer  (Buffer <ParsedLine> *program, OptimizationStats *stats);
+
+static bool IsInstruction       (ParsedLine *line, const char *instructionName);
+static bool IsConstantPush      (ParsedLine *line);
+static bool IsImmediatePush     (ParsedLine *line, elem_t value);
+static bool IsJumpToLabel       (ParsedLine *jump, ParsedLine *label);
+static bool CancelOut           (ParsedLine *first, ParsedLine *second);
+static bool FoldUnaryOperation  (ParsedLine *push, ParsedLine *operation);
+static bool FoldBinaryOperation (ParsedLine *first, ParsedLine *second, ParsedLine *operation);
+
+ProcessorErrorCode OptimizeProgram (Buffer <ParsedLine> *program, OptimizationStats *stats) {
+    PushLog (2);
+
+    custom_assert (program,       pointer_is_null, NO_BUFFER);
+    custom_assert (program->data, pointer_is_null, NO_BUFFER);
+    custom_assert (stats,         pointer_is_null, NO_BUFFER);
+
+    if (HasNumericJumps (program)) {
+        PrintWarningMessage (NO_PROCESSOR_ERRORS, "Program may jump to numeric addresses, directly or through a register or memory. "
+                                                  "Code is not optimized.", NULL, NULL, -1);
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    ProgramErrorCheck (RemoveUnreachableCode (program, &stats->unreachableCount), "Error occuried while removing unreachable code");
+    ProgramErrorCheck (RunPeepholeOptimizer  (program, stats),                    "Error occuried while optimizing basic blocks");
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Address reaching a register or memory jump can not be traced, so such jump is taken as numeric unless
+// every number pushed or stored as data by the program is a label
+static bool HasNumericJumps (Buffer <ParsedLine> *program) {
+    PushLog (3);
+
+    bool hasComputedJumps = false;
+    bool hasNumericValues = false;
+
+    for (size_t lineIndex = 0; lineIndex < program->currentIndex; lineIndex++) {
+        ParsedLine *line = program->data + lineIndex;
+
+        if (line->isData || IsConstantPush (line)) {
+            hasNumericValues = true;
+        }
+
+        if (line->isLabel || line->instruction.flow == LINEAR_FLOW || line->instruction.flow == RETURN_FLOW ||
+                line->instruction.flow == HALT_FLOW) {
+            continue;
+        }
+
+        if (line->instruction.commandCode.arguments != IMMED_ARGUMENT) {
+            hasComputedJumps = true;
+        } else if (!line->arguments.isLabel) {
+            RETURN true;
+        }
+    }
+
+    RETURN hasComputedJumps && hasNumericValues;
+}
+
+// Block is reachable from the program beginning or from a label which address is used as data, as it can be jumped to through a register.
+// Labels are left in place, so they keep pointing to the next surviving instruction
+static ProcessorErrorCode RemoveUnreachableCode (Buffer <ParsedLine> *program, size_t *removedCount) {
+    PushLog (3);
+
+    Buffer <size_t> blockStarts = {0, 0, NULL};
+    LabelTable      blockLabels = {};                   // label address is the index of its block
+    bool           *isReachable = NULL;
+
+    ProcessorErrorCode errorCode = InitBuffer (&blockStarts, INITIAL_LABELS_CAPACITY);
+
+    if (errorCode == NO_PROCESSOR_ERRORS) {
+        errorCode = InitLabelTable (&blockLabels, INITIAL_LABELS_CAPACITY);
+    }
+
+    if (errorCode == NO_PROCESSOR_ERRORS) {
+        errorCode = SplitIntoBlocks (program, &blockStarts, &blockLabels);
+    }
+
+    if (errorCode == NO_PROCESSOR_ERRORS) {
+        isReachable = (bool *) calloc (blockStarts.currentIndex, sizeof (bool));
+        errorCode   = isReachable ? NO_PROCESSOR_ERRORS : NO_BUFFER;
+    }
+
+    if (errorCode == NO_PROCESSOR_ERRORS) {
+        errorCode = MarkReachableBlocks (program, &blockStarts, &blockLabels, isReachable);
+    }
+
+    // the last block start is the program end
+    for (size_t blockIndex = 0; errorCode == NO_PROCESSOR_ERRORS && blockIndex + 1 < blockStarts.currentIndex; blockIndex++) {
+        if (isReachable [blockIndex]) {
+            continue;
+        }
+
+        for (size_t lineIndex = blockStarts.data [blockIndex]; lineIndex < blockStarts.data [blockIndex + 1]; lineIndex++) {
+            ParsedLine *line = program->data + lineIndex;
+
+            if (!line->isLabel && !line->isData && !line->isRemoved) {
+                line->isRemoved = true;
+                (*removedCount)++;
+            }
+        }
+    }
+
+    free (isReachable);
+    DestroyBuffer (&blockStarts);
+    DestroyLabelTable (&blockLabels);
+
+    ProgramErrorCheck (errorCode, "Error occuried while building control flow graph");
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Block begins with a label or after an instruction which may not pass control to the next one, so only the last
+// instruction of a block can jump. Program end is added as the last block start
+static ProcessorErrorCode SplitIntoBlocks (Buffer <ParsedLine> *program, Buffer <size_t> *blockStarts, LabelTable *blockLabels) {
+    PushLog (3);
+
+    bool isBlockEnd = true;
+
+    for (size_t lineIndex = 0; lineIndex < program->currentIndex; lineIndex++) {
+        ParsedLine *line = program->data + lineIndex;
+
+        if (isBlockEnd || line->isLabel) {
+            ProgramErrorCheck (WriteDataToBuffer (blockStarts, &lineIndex, 1), "Error occuried while writing block start");
+        }
+
+        if (line->isLabel) {
+            Label blockLabel = line->label;
+            blockLabel.address = (long long) blockStarts->currentIndex - 1;
+
+            ProgramErrorCheck (AddLabel (blockLabels, &blockLabel), "Error occuried while writing block label");
+        }
+
+        isBlockEnd = !line->isLabel && line->instruction.flow != LINEAR_FLOW;
+    }
+
+    ProgramErrorCheck (WriteDataToBuffer (blockStarts, &program->currentIndex, 1), "Error occuried while writing program end");
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode MarkReachableBlocks (Buffer <ParsedLine> *program, Buffer <size_t> *blockStarts, LabelTable *blockLabels,
+                                                bool *isReachable) {
+    PushLog (3);
+
+    size_t          blocksCount = blockStarts->currentIndex - 1;
+    Buffer <size_t> worklist    = {0, 0, NULL};
+
+    ProgramErrorCheck (InitBuffer (&worklist, INITIAL_LABELS_CAPACITY), "Unable to create blocks worklist");
+
+    ProcessorErrorCode errorCode = NO_PROCESSOR_ERRORS;
+
+    #define AddReachableBlock(blockIndex)                                           \
+        do {                                                                        \
+            size_t block_ = (blockIndex);                                           \
+            if (block_ < blocksCount && !isReachable [block_]) {                    \
+                isReachable [block_] = true;                                        \
+                errorCode = WriteDataToBuffer (&worklist, &block_, 1);              \
+            }                                                                       \
+        } while (0)
+
+    AddReachableBlock (0);
+
+    for (size_t lineIndex = 0; lineIndex < program->currentIndex && errorCode == NO_PROCESSOR_ERRORS; lineIndex++) {
+        ParsedLine *line = program->data + lineIndex;
+
+        if (!line->isLabel && line->arguments.isLabel && line->instruction.flow == LINEAR_FLOW) {
+            Label *usedLabel = FindLabel (blockLabels, &line->label);
+
+            if (usedLabel) {
+                AddReachableBlock ((size_t) usedLabel->address);
+            }
+        }
+    }
+
+    while (worklist.currentIndex > 0 && errorCode == NO_PROCESSOR_ERRORS) {
+        size_t      blockIndex = worklist.data [--worklist.currentIndex];
+        ParsedLine *lastLine   = program->data + blockStarts->data [blockIndex + 1] - 1;
+
+        InstructionFlow flow = lastLine->isLabel ? LINEAR_FLOW : lastLine->instruction.flow;
+
+        if (flow != JUMP_FLOW && flow != RETURN_FLOW && flow != HALT_FLOW) {
+            AddReachableBlock (blockIndex + 1);
+        }
+
+        // undefined label and computed address give no edge
+        if (flow != LINEAR_FLOW && lastLine->arguments.isLabel) {
+            Label *target = FindLabel (blockLabels, &lastLine->label);
+
+            if (target) {
+                AddReachableBlock ((size_t) target->address);
+            }
+        }
+    }
+
+    #undef AddReachableBlock
+
+    DestroyBuffer (&worklist);
+
+    ProgramErrorCheck (errorCode, "Error occuried while writing block to worklist");
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Surviving instructions after the last label are kept on a stack, so removing a pair lets the instructions around it meet:
+// push rax; push rbx; pop rbx; pop rax is removed completely, push 2; push 3; add; push 4; mul becomes push 20
+static ProcessorErrorCode RunPeepholeOptimizer (Buffer <ParsedLine> *program, OptimizationStats *stats) {
+    PushLog (3);
+
+    Buffer <size_t> survivors     = {0, 0, NULL};
+    LabelTable      definedLabels = {};
+
+    ProgramErrorCheck (InitBuffer (&survivors, INITIAL_LABELS_CAPACITY), "Unable to create instructions stack");
+
+    ProcessorErrorCode errorCode = InitLabelTable (&definedLabels, INITIAL_LABELS_CAPACITY);
+
+    if (errorCode != NO_PROCESSOR_ERRORS) {
+        DestroyBuffer (&survivors);
+        ProgramErrorCheck (errorCode, "Unable to create labels table");
+    }
+
+    bool isAfterLabel = false;
+
+    for (size_t lineIndex = 0; lineIndex < program->currentIndex && errorCode == NO_PROCESSOR_ERRORS; lineIndex++) {
+        ParsedLine *line = program->data + lineIndex;
+
+        // data directive has no code, so it does not split sequences
+        if (line->isRemoved || line->isData) {
+            continue;
+        }
+
+        if (line->isLabel) {
+            // jump to a label defined before does not lead here, as the first definition is used
+            bool isNewLabel = !FindLabel (&definedLabels, &line->label);
+
+            while (isNewLabel && survivors.currentIndex > 0 &&
+                    IsJumpToLabel (program->data + survivors.data [survivors.currentIndex - 1], line)) {
+
+                program->data [survivors.data [--survivors.currentIndex]].isRemoved = true;
+                stats->peepholeCount++;
+            }
+
+            errorCode    = AddLabel (&definedLabels, &line->label);
+            isAfterLabel = true;
+            continue;
+        }
+
+        // instruction after a label can be reached by a jump, so it is not combined with instructions before the label
+        if (isAfterLabel) {
+            survivors.currentIndex = 0;
+            isAfterLabel           = false;
+        }
+
+        ParsedLine *top   = survivors.currentIndex > 0 ? program->data + survivors.data [survivors.currentIndex - 1] : NULL;
+        ParsedLine *below = survivors.currentIndex > 1 ? program->data + survivors.data [survivors.currentIndex - 2] : NULL;
+
+        // result is written to the deeper push
+        if (below && FoldBinaryOperation (below, top, line)) {
+            top->isRemoved  = true;
+            line->isRemoved = true;
+            survivors.currentIndex--;
+
+            stats->foldedCount += 2;
+            continue;
+        }
+
+        if (top && FoldUnaryOperation (top, line)) {
+            line->isRemoved = true;
+
+            stats->foldedCount++;
+            continue;
+        }
+
+        if (top && CancelOut (top, line)) {
+            top->isRemoved  = true;
+            line->isRemoved = true;
+            survivors.currentIndex--;
+
+            stats->peepholeCount += 2;
+            continue;
+        }
+
+        errorCode = WriteDataToBuffer (&survivors, &lineIndex, 1);
+    }
+
+    DestroyBuffer (&survivors);
+    DestroyLabelTable (&definedLabels);
+
+    ProgramErrorCheck (errorCode, "Error occuried while optimizing code");
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// push x; pop x        - memory cell or register gets its own value
+// push 0; add (or sub) - adding zero, sign of zero result is not kept
+// push 1; mul (or div) - multiplying by one
+static bool CancelOut (ParsedLine *first, ParsedLine *second) {
+    PushLog (4);
+
+    if (IsInstruction (first, "push") && IsInstruction (second, "pop")) {
+        unsigned char argumentsType = first->instruction.commandCode.arguments;
+
+        if (argumentsType != second->instruction.commandCode.arguments) {
+            RETURN false;
+        }
+
+        if (argumentsType != REGISTER_ARGUMENT && !(argumentsType & MEMORY_ARGUMENT)) {
+            RETURN false;
+        }
+
+        if ((argumentsType & REGISTER_ARGUMENT) && first->arguments.registerIndex != second->arguments.registerIndex) {
+            RETURN false;
+        }
+
+        RETURN !(argumentsType & IMMED_ARGUMENT) ||
+                memcmp (&first->arguments.immedArgument, &second->arguments.immedArgument, sizeof (elem_t)) == 0;
+    }
+
+    if (IsImmediatePush (first, 0)) {
+        RETURN IsInstruction (second, "add") || IsInstruction (second, "sub");
+    }
+
+    if (IsImmediatePush (first, 1)) {
+        RETURN IsInstruction (second, "mul") || IsInstruction (second, "div");
+    }
+
+    RETURN false;
+}
+
+static bool IsJumpToLabel (ParsedLine *jump, ParsedLine *label) {
+    PushLog (4);
+
+    if (!IsInstruction (jump, "jmp") || !jump->arguments.isLabel) {
+        RETURN false;
+    }
+
+    RETURN jump->label.nameLength == label->label.nameLength &&
+            memcmp (jump->label.name, label->label.name, label->label.nameLength) == 0;
+}
+
+// Operations are computed as the processor does. Division by zero and truncation of values out of integer range are left to the processor
+static bool FoldBinaryOperation (ParsedLine *first, ParsedLine *second, ParsedLine *operation) {
+    PushLog (4);
+
+    if (!IsConstantPush (first) || !IsConstantPush (second)) {
+        RETURN false;
+    }
+
+    elem_t value1 = first->arguments.immedArgument;
+    elem_t value2 = second->arguments.immedArgument;
+    elem_t result = NAN;
+
+    if (IsInstruction (operation, "add")) {
+        result = value1 + value2;
+    } else if (IsInstruction (operation, "sub")) {
+        result = value1 - value2;
+    } else if (IsInstruction (operation, "mul")) {
+        result = value1 * value2;
+    } else if (IsInstruction (operation, "div") && fpclassify (value2) != FP_ZERO) {
+        result = value1 / value2;
+    } else {
+        RETURN false;
+    }
+
+    first->arguments.immedArgument = result;
+
+    RETURN true;
+}
+
+static bool FoldUnaryOperation (ParsedLine *push, ParsedLine *operation) {
+    PushLog (4);
+
+    if (!IsConstantPush (push)) {
+        RETURN false;
+    }
+
+    elem_t value  = push->arguments.immedArgument;
+    elem_t result = NAN;
+
+    if (IsInstruction (operation, "sin")) {
+        result = sin (value);
+    } else if (IsInstruction (operation, "cos")) {
+        result = cos (value);
+    } else if (IsInstruction (operation, "sqrt")) {
+        result = sqrt (value);
+    } else if (IsInstruction (operation, "floor") && value > (elem_t) LONG_MIN && value < (elem_t) LONG_MAX) {
+        result = (elem_t) (ssize_t) value;
+    } else {
+        RETURN false;
+    }
+
+    push->arguments.immedArgument = result;
+
+    RETURN true;
+}
+
+static bool IsConstantPush (ParsedLine *line) {
+    PushLog (4);
+
+    RETURN IsInstruction (line, "push") && line->instruction.commandCode.arguments == IMMED_ARGUMENT && !line->arguments.isLabel;
+}
+
+// Immediate is compared bitwise, so push -0 is not taken for push 0
+static bool IsImmediatePush (ParsedLine *line, elem_t value) {
+    PushLog (4);
+
+    RETURN IsConstantPush (line) && memcmp (&line->arguments.immedArgument, &value, sizeof (elem_t)) == 0;
+}
+
+static bool IsInstruction (ParsedLine *line, const char *instructionName) {
+    PushLog (4);
+
+    RETURN !line->isLabel && strcmp (line->instruction.instructionName, instructionName) == 0;
+}
+
+void SetOptimization (bool optimization) {
+    PushLog (4);
+
+    Optimization = optimization;
+
+    RETURN;
+}
+
+bool IsOptimizationEnabled () {
+    PushLog (4);
+    RETURN Optimization;
+}
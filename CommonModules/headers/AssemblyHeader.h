@@ -2,26 +2,85 @@
 #define ASSEMBLY_HEADER_H_
 
 #include <endian.h>
+#include <stdint.h>
 
+#include "Buffer.h"
 #include "CommonModules.h"
+#include "SPU.h"
+#include "TextTypes.h"
 
-#if BYTE_ORDER == LITTLE_ENDIAN
-    const char SYSTEM_BYTE_ORDER [] = "LITTLE ENDIAN";
-#else
-    const char SYSTEM_BYTE_ORDER [] = "BIG ENDIAN";
+// Binary is little-endian: header and tables are stored as they are laid out in memory, code keeps values in host order
+#if BYTE_ORDER != LITTLE_ENDIAN
+    #error "Binary format is little-endian only"
 #endif
 
-const char VERSION [] = "1.9.0";
-const short int DEFAULT_SIGNATURE = 0x4d54;
+const char VERSION [] = "2.3.0";
+const uint16_t DEFAULT_SIGNATURE = 0x4d54;
 
+const size_t VERSION_FIELD_LENGTH = 8;
+const size_t SECTION_ALIGNMENT    = 64;         // section offsets in the file, enough for any data used in place
+const size_t MAX_SECTIONS_COUNT   = 16;
+const size_t SYMBOL_NAME_LENGTH   = 128;
+
+const uint64_t CHECKSUM_SEED = 0xcbf29ce484222325;     // FNV-1a offset basis
+
+// File layout: header, section table, sections at aligned offsets in any order
 struct Header {
-    unsigned short signature = 0;
+    uint16_t signature     = 0;
+    uint16_t headerSize    = 0;
+    uint32_t sectionsCount = 0;
+
+    char version [VERSION_FIELD_LENGTH] = "";
 
-    char version   [sizeof (VERSION)]           = "";
-    char byteOrder [sizeof (SYSTEM_BYTE_ORDER)] = "";
+    uint64_t fileSize      = 0;
+    uint64_t checksum      = 0;                 // of the header with zero checksum followed by the section table
+};
+
+enum SectionType {
+    CODE_SECTION        = 1,
+    DEBUG_LINES_SECTION = 2,                    // DebugInfoChunk for every instruction in address order
+    SYMBOLS_SECTION     = 3,                    // SymbolEntry for every label in address order
+    CONSTANTS_SECTION   = 4,                    // data placed to ram before execution
+    ANALYSIS_SECTION    = 5,                    // facts about the code precomputed by the assembler
+};
 
-    bool hasDebugInfo    = false;
-    size_t commandsCount = 0;
+enum SectionFlags {
+    REQUIRED_SECTION   = 1 << 0,                // reader which does not know the section type can not load the binary
+    COMPRESSED_SECTION = 1 << 1,                // stored as described in Compression.h
+};
+
+struct SectionEntry {
+    uint32_t type     = 0;
+    uint32_t flags    = 0;
+    uint64_t offset   = 0;                      // from the file beginning, multiple of SECTION_ALIGNMENT
+    uint64_t size     = 0;                      // in bytes
+    uint64_t checksum = 0;
+};
+
+struct SymbolEntry {
+    uint64_t address = 0;
+    char name [SYMBOL_NAME_LENGTH] = "";
+};
+
+// Constants section is a sequence of blocks, each one is followed by its values
+struct ConstantsBlock {
+    uint64_t address = 0;                       // in ram of the first value
+    uint64_t size    = 0;                       // count of elem_t values
+};
+
+static_assert (sizeof (Header)         == 32,  "Header layout has changed");
+static_assert (sizeof (SectionEntry)   == 32,  "Section table layout has changed");
+static_assert (sizeof (SymbolEntry)    == 136, "Symbols section layout has changed");
+static_assert (sizeof (DebugInfoChunk) == 16,  "Debug lines section layout has changed");
+static_assert (sizeof (ConstantsBlock) == 16,  "Constants section layout has changed");
+
+// Opened binary. Header and section table are copied, sections are used right in the binary
+struct BinaryContainer {
+    Header       header                        = {};
+    SectionEntry sections [MAX_SECTIONS_COUNT] = {};
+
+    FileBuffer   binary                        = {};
+    bool         verifyChecksums               = true;  // sections are checked when they are taken, header is checked anyway
 };
 
 #define WriteHeaderField(buffer, header, field, fieldSize)                                                                  \
@@ -38,7 +97,26 @@ struct Header {
 ProcessorErrorCode InitHeader  (Header *header);
 ProcessorErrorCode CheckHeader (Header *header);
 
+// Checks header, section table and bounds of all sections. Section contents are not read
+ProcessorErrorCode OpenContainer (BinaryContainer *container, FileBuffer *binary);
+// Section is checked against its checksum if the container verifies them. Missing section is returned with NULL buffer and zero size
+ProcessorErrorCode GetSection    (BinaryContainer *container, SectionType type, FileBuffer *section);
+// Same as GetSection, but compressed section is decompressed into decompressedSection, which has to be destroyed by the caller
+ProcessorErrorCode ReadSection   (BinaryContainer *container, SectionType type, FileBuffer *section, Buffer <char> *decompressedSection);
+
+// Reads the block at offset of the constants section and moves offset to the next one. Block has to fit into the section and ram.
+// Values are not aligned in the binary, so they have to be copied
+ProcessorErrorCode ReadConstantsBlock (FileBuffer *section, size_t *offset, ConstantsBlock *block, const char **values);
+
+uint64_t ComputeChecksum (const void *data, size_t size, uint64_t checksum);
+uint64_t ComputeHeaderChecksum (Header *header, SectionEntry *sections);
+
+const char *GetSectionName (uint32_t type);
+
 void SetDebugMode (bool debugMode);
 bool IsDebugMode  ();
 
+void SetCodeCompression (bool codeCompression);
+bool IsCodeCompressed   ();
+
 #endif
@@ -42,9 +42,19 @@ enum ArgumentsType {
     MEMORY_ARGUMENT   = 1 << 2,
 };
 
+// Immediate argument is stored after a format byte in the smallest type which keeps its value exactly
+enum ImmediateFormat {
+    DOUBLE_IMMEDIATE = 0,
+    INT8_IMMEDIATE   = 1,
+    INT16_IMMEDIATE  = 2,
+    INT32_IMMEDIATE  = 3,
+};
+
 struct InstructionArguments {
     elem_t immedArgument        = NAN;
     unsigned char registerIndex = REGISTER_COUNT;
+
+    bool isLabel                = false;        // label addresses always have the same size, so they can be patched
 };
 
 struct CommandCode {
@@ -52,11 +62,40 @@ struct CommandCode {
     unsigned char arguments : 3;
 };
 
+const size_t OPCODES_COUNT         = 1 << 5;
+const size_t ARGUMENTS_MODES_COUNT = 1 << 3;
+
+// Instructions that take arguments need an immediate or register one (memory argument is an address of it).
+// MEMORY_ARGUMENT alone is permitted to instructions which work on memory only, their address may be of any kind
+constexpr bool IsPermittedArguments (unsigned char permittedArguments, unsigned char arguments) {
+    if (permittedArguments == MEMORY_ARGUMENT) {
+        return (arguments & MEMORY_ARGUMENT) && (arguments & (IMMED_ARGUMENT | REGISTER_ARGUMENT));
+    }
+
+    return !(arguments & ~permittedArguments) &&
+                (permittedArguments == NO_ARGUMENTS || (arguments & (IMMED_ARGUMENT | REGISTER_ARGUMENT)));
+}
+
+inline unsigned char GetRawCommandCode (CommandCode commandCode) {
+    return *(unsigned char *) &commandCode;
+}
+
+enum InstructionFlow {
+    LINEAR_FLOW           = 0,      // execution continues with the next instruction
+    JUMP_FLOW             = 1,
+    CONDITIONAL_JUMP_FLOW = 2,
+    CALL_FLOW             = 3,
+    RETURN_FLOW           = 4,
+    HALT_FLOW             = 5,
+    SPAWN_FLOW            = 6,      // starts another core at the argument address, execution continues with the next instruction
+};
+
 typedef ProcessorErrorCode (*callbackFunction_t)(SPU *spu, CommandCode *commandCode, elem_t *argument);
 
 struct AssemblerInstruction {
     const char *instructionName;
     CommandCode commandCode;
+    InstructionFlow flow;
 
     callbackFunction_t callbackFunction;
 };
@@ -0,0 +1,28 @@
+#ifndef COMPRESSION_H_
+#define COMPRESSION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Buffer.h"
+#include "CommonModules.h"
+#include "TextTypes.h"
+
+// Byte-oriented LZ77 in the spirit of LZ4: no entropy coding, so decompression is a sequence of short copies.
+// Data is split into chunks compressed independently, a chunk is decompressed without looking at others
+const size_t COMPRESSION_CHUNK_SIZE = 1 << 16;
+
+// Compressed section: header, end offsets of chunks counted from the first chunk (uint32_t each), chunks
+struct CompressedSectionHeader {
+    uint64_t dataSize    = 0;                   // before compression
+    uint32_t chunkSize   = 0;                   // of decompressed data, the last chunk can be shorter
+    uint32_t chunksCount = 0;
+};
+
+static_assert (sizeof (CompressedSectionHeader) == 16, "Compressed section layout has changed");
+
+ProcessorErrorCode CompressSection   (const char *data, size_t dataSize, Buffer <char> *compressedSection);
+// Decompressed data is stored in the allocated buffer, which is not changed on errors
+ProcessorErrorCode DecompressSection (FileBuffer *compressedSection, Buffer <char> *data);
+
+#endif
@@ -34,7 +34,7 @@ inline ComparisonResult CompareValues (elem_t value1, elem_t value2) {
             do {                                                                                                    \
                 char *bufferPointer = (spu)->bytecode.buffer + (spu)->ip;                                           \
                 custom_assert (bufferPointer, pointer_is_null, NO_BUFFER);                                          \
-                if ((ssize_t) (spu)->ip >= (spu)->bytecode.buffer_size) {                                           \
+                if ((spu)->ip + sizeof (type) * length > (size_t) (spu)->bytecode.buffer_size) {                    \
                     RETURN BUFFER_ENDED;                                                                            \
                 }                                                                                                   \
                 if (!CopyVariableValue (destination, bufferPointer, sizeof (type) * length)) {                      \
@@ -45,6 +45,40 @@ inline ComparisonResult CompareValues (elem_t value1, elem_t value2) {
 
 #define ReadData(spu, destination, type) ReadArrayData (spu, destination, 1, type)
 
+inline ProcessorErrorCode ReadImmediate (SPU *spu, elem_t *immediate) {
+    PushLog (4);
+
+    unsigned char format = DOUBLE_IMMEDIATE;
+    ReadData (spu, &format, unsigned char);
+
+    #define ReadImmediateValue(type)                    \
+                do {                                    \
+                    type value_ = 0;                    \
+                    ReadData (spu, &value_, type);      \
+                    *immediate = (elem_t) value_;       \
+                } while (0)
+
+    switch (format) {
+        case DOUBLE_IMMEDIATE: ReadData (spu, immediate, elem_t); break;
+        case INT8_IMMEDIATE:   ReadImmediateValue (int8_t);       break;
+        case INT16_IMMEDIATE:  ReadImmediateValue (int16_t);      break;
+        case INT32_IMMEDIATE:  ReadImmediateValue (int32_t);      break;
+        default:               RETURN WRONG_INSTRUCTION;
+    }
+
+    #undef ReadImmediateValue
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+#define ReadImmediateData(spu, destination)                                                                         \
+            do {                                                                                                    \
+                ProcessorErrorCode immediateError_ = ReadImmediate (spu, destination);                              \
+                if (immediateError_ != NO_PROCESSOR_ERRORS) {                                                       \
+                    RETURN immediateError_;                                                                         \
+                }                                                                                                   \
+            } while (0)
+
 #define PushValue(spu, value)                                                                                       \
             do {                                                                                                    \
                 if (StackPush_ (&((spu)->processorStack), value) != NO_ERRORS) {                                    \
@@ -0,0 +1,11 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include "TextTypes.h"
+
+// Maps the whole file read-only: pages are read on first access and shared by all processes which map the file,
+// so nothing is copied and the time does not depend on file size. Buffer must not be written to
+bool MapFile   (FileBuffer *fileBuffer, const char *filename);
+void UnmapFile (FileBuffer *fileBuffer);
+
+#endif
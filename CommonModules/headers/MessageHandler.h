@@ -23,6 +23,7 @@ struct ProcessorMessage {
 
 ProcessorErrorCode PrintMessage (FILE *stream, ProcessorMessage message);
 void SetGlobalMessagePrefix (char *newPrefix);
+void SetQuietMode (bool isQuiet);     // info and success messages are not printed in quiet mode
 
 #define PrintErrorMessage(errorCode, errorMessage, messagePrefix, asmLine, asmLineNumber) \
     PrintMessage (stderr, {errorCode,           ERROR_MESSAGE,   errorMessage, messagePrefix, __LINE__, __FILE__, __PRETTY_FUNCTION__, asmLine, asmLineNumber})
@@ -0,0 +1,67 @@
+#ifndef PERFECT_HASH_H_
+#define PERFECT_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+const unsigned char NO_HASH_SLOT_VALUE = 0xff;
+const uint32_t      MAX_HASH_SEED      = 1 << 16;
+
+// FNV-1a with seed mixed into the initial value
+constexpr uint32_t HashName (const char *name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+
+    for (; *name; name++) {
+        hash ^= (unsigned char) *name;
+        hash *= 16777619u;
+    }
+
+    return hash ^ (hash >> 15);
+}
+
+// slots [HashName (key, seed) % TABLE_SIZE] is the index of the key or NO_HASH_SLOT_VALUE.
+// seed == MAX_HASH_SEED means that no collision-free seed has been found
+template <size_t TABLE_SIZE>
+struct PerfectHashTable {
+    uint32_t      seed               = MAX_HASH_SEED;
+    unsigned char slots [TABLE_SIZE] = {};
+
+    constexpr unsigned char Find (const char *name) const {
+        return slots [HashName (name, seed) % TABLE_SIZE];
+    }
+};
+
+// Tries seeds one by one until all keys get different slots. Evaluated at compile time
+template <size_t TABLE_SIZE>
+constexpr PerfectHashTable <TABLE_SIZE> CreatePerfectHash (const char *const *keys, size_t keysCount) {
+    static_assert (TABLE_SIZE < NO_HASH_SLOT_VALUE, "Key index has to fit into a slot");
+
+    PerfectHashTable <TABLE_SIZE> table = {};
+
+    for (uint32_t seed = 0; seed < MAX_HASH_SEED; seed++) {
+        for (size_t slot = 0; slot < TABLE_SIZE; slot++) {
+            table.slots [slot] = NO_HASH_SLOT_VALUE;
+        }
+
+        bool hasCollisions = false;
+
+        for (size_t keyIndex = 0; keyIndex < keysCount && !hasCollisions; keyIndex++) {
+            unsigned char &slot = table.slots [HashName (keys [keyIndex], seed) % TABLE_SIZE];
+
+            if (slot != NO_HASH_SLOT_VALUE) {
+                hasCollisions = true;
+            } else {
+                slot = (unsigned char) keyIndex;
+            }
+        }
+
+        if (!hasCollisions) {
+            table.seed = seed;
+            return table;
+        }
+    }
+
+    return table;
+}
+
+#endif
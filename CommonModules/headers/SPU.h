@@ -3,6 +3,7 @@
 
 #include <SFML/System/Mutex.hpp>
 #include <cstddef>
+#include <stdint.h>
 #include <sys/types.h>
 
 #include "TextTypes.h"
@@ -16,11 +17,16 @@ const unsigned int MIN_FREQUENCY = 1;           // minimal and maximal frequency
 const unsigned int MAX_FREQUENCY = 4200;
 const useconds_t MAX_SLEEP_TIME  = 4200;        // Sleep time when minimal frequency is set
 
+// Stored in binaries as it is, so the layout is fixed
 struct DebugInfoChunk {
-    size_t address;
-    int line;
+    uint64_t address;
+    int32_t  line;
+    int32_t  reserved;
 };
 
+struct ProgramIO;
+struct MultiCore;
+
 struct SPU {
     FileBuffer bytecode;
     size_t ip = 0;
@@ -38,6 +44,12 @@ struct SPU {
 
     bool graphicsEnabled = false;
     bool isWorking       = false;
+
+    ProgramIO *io = NULL;                       // if set, in and out work with it instead of the console
+    size_t executedInstructions = 0;            // not counted by JIT engine
+
+    MultiCore *machine = NULL;                  // set in multi-core mode, ram is shared by all cores of the machine
+    size_t     coreId  = 0;
 };
 
 #undef REGISTER
@@ -4,12 +4,9 @@
 #include "CommonModules.h"
 #include "FileIO.h"
 
-ssize_t CountWhitespaces      (TextLine *line);
 ssize_t FindActualStringEnd   (TextLine *line);
 ssize_t FindActualStringBegin (TextLine *line);
 
-bool IsLabelLine (TextLine *line, char *labelName);
-
 ProcessorErrorCode DeleteExcessWhitespaces (TextBuffer *lines);
 
 #endif
@@ -3,9 +3,13 @@
 #include "CustomAssert.h"
 #include "Logger.h"
 #include "AssemblyHeader.h"
+#include "Compression.h"
 #include "DSLFunctions.h"
 
-static bool DebugMode = false;
+static bool DebugMode       = false;
+static bool CodeCompression = false;
+
+static bool IsKnownSection (uint32_t type);
 
 ProcessorErrorCode CheckHeader (Header *header) {
 	PushLog (2);
@@ -15,15 +19,16 @@ ProcessorErrorCode CheckHeader (Header *header) {
     Header mainHeader {};
     InitHeader (&mainHeader);
 
-    #define CheckHeaderField(field, fieldSize, predicate)                                   \
+    #define CheckHeaderField(field, predicate)                                              \
                 if (!(predicate)) {                                                         \
                     ProgramErrorCheck (WRONG_HEADER, "Header field " #field " is wrong"); \
                 }
 
 
-    CheckHeaderField (signature, sizeof (unsigned short),        header->signature == mainHeader.signature);
-    CheckHeaderField (version,   sizeof (VERSION) - 1,           !strcmp (header->version,   mainHeader.version));
-    CheckHeaderField (byteOrder, sizeof (SYSTEM_BYTE_ORDER) - 1, !strcmp (header->byteOrder, mainHeader.byteOrder));
+    CheckHeaderField (signature,     header->signature  == mainHeader.signature);
+    CheckHeaderField (headerSize,    header->headerSize == mainHeader.headerSize);
+    CheckHeaderField (version,       !strncmp (header->version, mainHeader.version, VERSION_FIELD_LENGTH));
+    CheckHeaderField (sectionsCount, header->sectionsCount <= MAX_SECTIONS_COUNT);
 
     #undef CheckHeaderField
 
@@ -34,15 +39,212 @@ ProcessorErrorCode InitHeader (Header *header) {
     PushLog (4);
     custom_assert (header, pointer_is_null, WRONG_HEADER);
 
-    strcpy (header->version,   VERSION);
-    strcpy (header->byteOrder, SYSTEM_BYTE_ORDER);
-    header->signature = DEFAULT_SIGNATURE;
+    static_assert (sizeof (VERSION) <= VERSION_FIELD_LENGTH, "Version does not fit into the header");
+
+    strncpy (header->version, VERSION, VERSION_FIELD_LENGTH);
+    header->signature  = DEFAULT_SIGNATURE;
+    header->headerSize = sizeof (Header);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode OpenContainer (BinaryContainer *container, FileBuffer *binary) {
+    PushLog (2);
+
+    custom_assert (container,      pointer_is_null, NO_BUFFER);
+    custom_assert (binary,         pointer_is_null, NO_BUFFER);
+    custom_assert (binary->buffer, pointer_is_null, NO_BUFFER);
+
+    container->binary = *binary;
+
+    // header and table are copied, as binary buffer is not guaranteed to be aligned
+    SPU reader = {
+        .bytecode = *binary,
+    };
+
+    ReadData (&reader, &container->header, Header);
+
+    ProgramErrorCheck (CheckHeader (&container->header), "Header is corrupted");
+
+    Header *header = &container->header;
+
+    ReadArrayData (&reader, container->sections, header->sectionsCount, SectionEntry);
+
+    if (header->fileSize > (uint64_t) binary->buffer_size) {
+        ProgramErrorCheck (BUFFER_ENDED, "Binary is shorter than its header says");
+    }
+
+    if (ComputeHeaderChecksum (header, container->sections) != header->checksum) {
+        ProgramErrorCheck (WRONG_HEADER, "Header checksum mismatch");
+    }
+
+    for (size_t sectionIndex = 0; sectionIndex < header->sectionsCount; sectionIndex++) {
+        SectionEntry *section = container->sections + sectionIndex;
+
+        if (section->offset % SECTION_ALIGNMENT != 0) {
+            ProgramErrorCheck (WRONG_HEADER, "Section is misaligned");
+        }
+
+        if (section->offset > header->fileSize || section->size > header->fileSize - section->offset) {
+            ProgramErrorCheck (BUFFER_ENDED, "Section is out of the binary");
+        }
+
+        if ((section->flags & REQUIRED_SECTION) && !IsKnownSection (section->type)) {
+            ProgramErrorCheck (WRONG_HEADER, "Binary requires an unknown section");
+        }
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode GetSection (BinaryContainer *container, SectionType type, FileBuffer *section) {
+    PushLog (3);
+
+    custom_assert (container, pointer_is_null, NO_BUFFER);
+    custom_assert (section,   pointer_is_null, NO_BUFFER);
+
+    section->buffer      = NULL;
+    section->buffer_size = 0;
+
+    for (size_t sectionIndex = 0; sectionIndex < container->header.sectionsCount; sectionIndex++) {
+        SectionEntry *entry = container->sections + sectionIndex;
+
+        if (entry->type != (uint32_t) type) {
+            continue;
+        }
+
+        char *sectionData = container->binary.buffer + entry->offset;
+
+        if (container->verifyChecksums && ComputeChecksum (sectionData, entry->size, CHECKSUM_SEED) != entry->checksum) {
+            ProgramErrorCheck (WRONG_HEADER, "Section checksum mismatch");
+        }
+
+        section->buffer      = sectionData;
+        section->buffer_size = (ssize_t) entry->size;
+
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode ReadSection (BinaryContainer *container, SectionType type, FileBuffer *section, Buffer <char> *decompressedSection) {
+    PushLog (3);
+
+    custom_assert (container,           pointer_is_null, NO_BUFFER);
+    custom_assert (section,             pointer_is_null, NO_BUFFER);
+    custom_assert (decompressedSection, pointer_is_null, NO_BUFFER);
+
+    ProgramErrorCheck (GetSection (container, type, section), "Error occuried while reading section");
+
+    bool isCompressed = false;
+
+    for (size_t sectionIndex = 0; sectionIndex < container->header.sectionsCount; sectionIndex++) {
+        if (container->sections [sectionIndex].type == (uint32_t) type) {
+            isCompressed = (container->sections [sectionIndex].flags & COMPRESSED_SECTION) != 0;
+            break;
+        }
+    }
+
+    if (!section->buffer || !isCompressed) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    ProgramErrorCheck (DecompressSection (section, decompressedSection), "Error occuried while decompressing section");
+
+    section->buffer      = decompressedSection->data;
+    section->buffer_size = (ssize_t) decompressedSection->currentIndex;
 
-    header->hasDebugInfo = DebugMode;
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode ReadConstantsBlock (FileBuffer *section, size_t *offset, ConstantsBlock *block, const char **values) {
+    PushLog (3);
+
+    custom_assert (section, pointer_is_null, NO_BUFFER);
+    custom_assert (offset,  pointer_is_null, NO_BUFFER);
+    custom_assert (block,   pointer_is_null, NO_BUFFER);
+    custom_assert (values,  pointer_is_null, NO_BUFFER);
+
+    size_t sectionSize = (size_t) section->buffer_size;
+
+    if (*offset > sectionSize || sectionSize - *offset < sizeof (ConstantsBlock)) {
+        ProgramErrorCheck (BUFFER_ENDED, "Constants block is out of the section");
+    }
+
+    memcpy (block, section->buffer + *offset, sizeof (ConstantsBlock));
+    *offset += sizeof (ConstantsBlock);
+
+    if (block->size > (sectionSize - *offset) / sizeof (elem_t)) {
+        ProgramErrorCheck (BUFFER_ENDED, "Constants block is out of the section");
+    }
+
+    if (block->address > VRAM_SIZE + RAM_SIZE || block->size > VRAM_SIZE + RAM_SIZE - block->address) {
+        ProgramErrorCheck (WRONG_ADDRESS, "Constants block is out of ram");
+    }
+
+    *values  = section->buffer + *offset;
+    *offset += block->size * sizeof (elem_t);
 
     RETURN NO_PROCESSOR_ERRORS;
 }
 
+// FNV-1a taking 8 bytes at a step, the tail is padded with zeroes
+uint64_t ComputeChecksum (const void *data, size_t size, uint64_t checksum) {
+    PushLog (4);
+
+    const uint64_t FnvPrime = 0x100000001b3;
+
+    const char *bytes = (const char *) data;
+    uint64_t    word  = 0;
+
+    for (; size >= sizeof (word); size -= sizeof (word), bytes += sizeof (word)) {
+        memcpy (&word, bytes, sizeof (word));
+        checksum = (checksum ^ word) * FnvPrime;
+    }
+
+    if (size > 0) {
+        word = 0;
+        memcpy (&word, bytes, size);
+        checksum = (checksum ^ word) * FnvPrime;
+    }
+
+    RETURN checksum;
+}
+
+uint64_t ComputeHeaderChecksum (Header *header, SectionEntry *sections) {
+    PushLog (4);
+
+    custom_assert (header,   pointer_is_null, 0);
+    custom_assert (sections, pointer_is_null, 0);
+
+    Header checkedHeader   = *header;
+    checkedHeader.checksum = 0;
+
+    uint64_t checksum = ComputeChecksum (&checkedHeader, sizeof (Header), CHECKSUM_SEED);
+
+    RETURN ComputeChecksum (sections, sizeof (SectionEntry) * header->sectionsCount, checksum);
+}
+
+const char *GetSectionName (uint32_t type) {
+    PushLog (4);
+
+    switch (type) {
+        case CODE_SECTION:        RETURN "code";
+        case DEBUG_LINES_SECTION: RETURN "debug lines";
+        case SYMBOLS_SECTION:     RETURN "symbols";
+        case CONSTANTS_SECTION:   RETURN "constants";
+        case ANALYSIS_SECTION:    RETURN "analysis";
+        default:                  RETURN "unknown";
+    }
+}
+
+static bool IsKnownSection (uint32_t type) {
+    PushLog (4);
+
+    RETURN type >= CODE_SECTION && type <= ANALYSIS_SECTION;
+}
+
 void SetDebugMode (bool debugMode) {
     PushLog (4);
 
@@ -55,3 +257,16 @@ bool IsDebugMode () {
     PushLog (4);
     RETURN DebugMode;
 }
+
+void SetCodeCompression (bool codeCompression) {
+    PushLog (4);
+
+    CodeCompression = codeCompression;
+
+    RETURN;
+}
+
+bool IsCodeCompressed () {
+    PushLog (4);
+    RETURN CodeCompression;
+}
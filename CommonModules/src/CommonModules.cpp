@@ -2,40 +2,89 @@
 
 #include "CustomAssert.h"
 #include "CommonModules.h"
+#include "PerfectHash.h"
 
-#define INSTRUCTION(NAME, COMMAND_CODE, ...)        \
+#define INSTRUCTION(NAME, COMMAND_CODE, FLOW, ...)  \
             {                                       \
                 .instructionName = #NAME,           \
                 .commandCode = COMMAND_CODE,        \
+                .flow = FLOW,                       \
                 .callbackFunction = NAME##Callback, \
             },
 
-static const struct AssemblerInstruction AvailableInstructions [] = {
+static constexpr AssemblerInstruction AvailableInstructions [] = {
     #include "Instructions.def"
 };
 #undef INSTRUCTION
 
-#define  FindInstruction(predicate)                                                                                                                         \
-            do {                                                                                                                                            \
-                for (size_t instructionIndex = 0; instructionIndex < sizeof (AvailableInstructions) / sizeof (AssemblerInstruction); instructionIndex++) {  \
-                    if (predicate) {                                                                                                                        \
-                        RETURN AvailableInstructions + instructionIndex;                                                                                    \
-                    }                                                                                                                                       \
-                }                                                                                                                                           \
-                RETURN NULL;                                                                                                                                \
-            }while (0)                                                                                                                                      \
+const size_t INSTRUCTIONS_COUNT     = sizeof (AvailableInstructions) / sizeof (AssemblerInstruction);
+const size_t INSTRUCTIONS_HASH_SIZE = 128;
 
+struct OpcodeTable {
+    unsigned char instructionIndexes [OPCODES_COUNT] = {};      // opcode -> index in AvailableInstructions
+};
+
+struct InstructionNames {
+    const char *names [INSTRUCTIONS_COUNT] = {};
+};
+
+static constexpr OpcodeTable CreateOpcodeTable () {
+    OpcodeTable table = {};
+
+    for (size_t opcode = 0; opcode < OPCODES_COUNT; opcode++) {
+        table.instructionIndexes [opcode] = NO_HASH_SLOT_VALUE;
+    }
+
+    for (size_t instructionIndex = 0; instructionIndex < INSTRUCTIONS_COUNT; instructionIndex++) {
+        table.instructionIndexes [AvailableInstructions [instructionIndex].commandCode.opcode] = (unsigned char) instructionIndex;
+    }
+
+    return table;
+}
+
+static constexpr InstructionNames GetInstructionNames () {
+    InstructionNames instructionNames = {};
+
+    for (size_t instructionIndex = 0; instructionIndex < INSTRUCTIONS_COUNT; instructionIndex++) {
+        instructionNames.names [instructionIndex] = AvailableInstructions [instructionIndex].instructionName;
+    }
+
+    return instructionNames;
+}
+
+static constexpr OpcodeTable                               InstructionsByOpcode = CreateOpcodeTable ();
+static constexpr InstructionNames                          InstructionsNames    = GetInstructionNames ();
+static constexpr PerfectHashTable <INSTRUCTIONS_HASH_SIZE> InstructionsByName   =
+                    CreatePerfectHash <INSTRUCTIONS_HASH_SIZE> (InstructionsNames.names, INSTRUCTIONS_COUNT);
+
+static_assert (InstructionsByName.seed != MAX_HASH_SEED, "Unable to build perfect hash of instruction names");
 
 const AssemblerInstruction *FindInstructionByName (char *name) {
     PushLog (4);
 
-    FindInstruction (strcmp (AvailableInstructions [instructionIndex].instructionName, name) == 0);
+    unsigned char instructionIndex = InstructionsByName.Find (name);
+
+    if (instructionIndex == NO_HASH_SLOT_VALUE || strcmp (AvailableInstructions [instructionIndex].instructionName, name) != 0) {
+        RETURN NULL;
+    }
+
+    RETURN AvailableInstructions + instructionIndex;
 }
 
 const AssemblerInstruction *FindInstructionByOpcode (int instruction) {
     PushLog (4);
 
-    FindInstruction ((int) AvailableInstructions [instructionIndex].commandCode.opcode == instruction);
+    if (instruction < 0 || instruction >= (int) OPCODES_COUNT) {
+        RETURN NULL;
+    }
+
+    unsigned char instructionIndex = InstructionsByOpcode.instructionIndexes [instruction];
+
+    if (instructionIndex == NO_HASH_SLOT_VALUE) {
+        RETURN NULL;
+    }
+
+    RETURN AvailableInstructions + instructionIndex;
 }
 
 bool CopyVariableValue (void *destination, void *source, size_t size) {
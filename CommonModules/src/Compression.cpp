@@ -0,0 +1,314 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "Compression.h"
+#include "CustomAssert.h"
+#include "Logger.h"
+
+// Every sequence is a token (literals length in the high half, match length - MIN_MATCH_LENGTH in the low one),
+// literals and a match given by its offset back from the current position. Half equal to 15 is continued
+// by bytes added to it until a byte is less than 255. The last sequence has literals only
+const size_t MIN_MATCH_LENGTH      = 4;
+const size_t MAX_MATCH_OFFSET      = 0xffff;
+const size_t TOKEN_LENGTH_MASK     = 0xf;
+const size_t HASH_TABLE_BITS       = 12;
+const size_t MAX_COMPRESSION_RATIO = 256;   // data bytes per compressed byte can not be greater
+
+static size_t GetCompressedSizeBound (size_t dataSize);
+
+static size_t CompressChunk (const unsigned char *data, size_t dataSize, unsigned char *compressed);
+static ProcessorErrorCode DecompressChunk (const unsigned char *compressed, size_t compressedSize, unsigned char *data, size_t dataSize);
+
+static unsigned char *WriteSequence (unsigned char *compressed, const unsigned char *literals, size_t literalsLength,
+                                        size_t matchOffset, size_t matchLength);
+static unsigned char *WriteLength   (unsigned char *compressed, size_t length);
+static bool           ReadLength    (const unsigned char **compressed, const unsigned char *compressedEnd, size_t *length);
+
+static uint32_t HashSequence (const unsigned char *sequence);
+
+ProcessorErrorCode CompressSection (const char *data, size_t dataSize, Buffer <char> *compressedSection) {
+    PushLog (2);
+
+    custom_assert (data || dataSize == 0, pointer_is_null, NO_BUFFER);
+    custom_assert (compressedSection,     pointer_is_null, NO_BUFFER);
+
+    CompressedSectionHeader header = {
+        .dataSize    = dataSize,
+        .chunkSize   = COMPRESSION_CHUNK_SIZE,
+        .chunksCount = (uint32_t) ((dataSize + COMPRESSION_CHUNK_SIZE - 1) / COMPRESSION_CHUNK_SIZE),
+    };
+
+    size_t chunksOffset = sizeof (header) + sizeof (uint32_t) * header.chunksCount;
+    size_t sectionBound = chunksOffset + header.chunksCount * GetCompressedSizeBound (COMPRESSION_CHUNK_SIZE);
+
+    ProgramErrorCheck (InitBuffer (compressedSection, sectionBound + 1), "Error occuried while allocating compressed section");
+
+    unsigned char *chunks    = (unsigned char *) compressedSection->data + chunksOffset;
+    uint32_t       chunksEnd = 0;
+
+    memcpy (compressedSection->data, &header, sizeof (header));
+
+    for (size_t chunkIndex = 0; chunkIndex < header.chunksCount; chunkIndex++) {
+        size_t chunkBegin = chunkIndex * COMPRESSION_CHUNK_SIZE;
+        size_t chunkSize  = dataSize - chunkBegin < COMPRESSION_CHUNK_SIZE ? dataSize - chunkBegin : COMPRESSION_CHUNK_SIZE;
+
+        chunksEnd += (uint32_t) CompressChunk ((const unsigned char *) data + chunkBegin, chunkSize, chunks + chunksEnd);
+
+        memcpy (compressedSection->data + sizeof (header) + sizeof (uint32_t) * chunkIndex, &chunksEnd, sizeof (chunksEnd));
+    }
+
+    compressedSection->currentIndex = chunksOffset + chunksEnd;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Chunks are decompressed one after another, each one is checked to fill exactly its part of the data
+ProcessorErrorCode DecompressSection (FileBuffer *compressedSection, Buffer <char> *data) {
+    PushLog (2);
+
+    custom_assert (compressedSection,         pointer_is_null, NO_BUFFER);
+    custom_assert (compressedSection->buffer, pointer_is_null, NO_BUFFER);
+    custom_assert (data,                      pointer_is_null, NO_BUFFER);
+
+    size_t sectionSize = (size_t) compressedSection->buffer_size;
+
+    CompressedSectionHeader header = {};
+
+    if (sectionSize < sizeof (header)) {
+        ProgramErrorCheck (BUFFER_ENDED, "Compressed section is too short");
+    }
+
+    memcpy (&header, compressedSection->buffer, sizeof (header));
+
+    size_t chunksOffset = sizeof (header) + sizeof (uint32_t) * header.chunksCount;
+
+    if (header.chunkSize == 0 || header.chunkSize > COMPRESSION_CHUNK_SIZE ||
+            header.chunksCount != (header.dataSize + header.chunkSize - 1) / header.chunkSize) {
+        ProgramErrorCheck (WRONG_HEADER, "Compressed section header is wrong");
+    }
+
+    if (chunksOffset > sectionSize || header.dataSize / MAX_COMPRESSION_RATIO > sectionSize) {
+        ProgramErrorCheck (BUFFER_ENDED, "Compressed section is too short");
+    }
+
+    Buffer <char> decompressed = {0, 0, NULL};
+    ProgramErrorCheck (InitBuffer (&decompressed, header.dataSize + 1), "Error occuried while allocating decompressed section");
+
+    const unsigned char *chunks      = (const unsigned char *) compressedSection->buffer + chunksOffset;
+    size_t               chunksSize  = sectionSize - chunksOffset;
+    uint32_t             chunkBegin  = 0;
+
+    for (size_t chunkIndex = 0; chunkIndex < header.chunksCount; chunkIndex++) {
+        uint32_t chunkEnd = 0;
+        memcpy (&chunkEnd, compressedSection->buffer + sizeof (header) + sizeof (uint32_t) * chunkIndex, sizeof (chunkEnd));
+
+        size_t dataBegin = chunkIndex * header.chunkSize;
+        size_t dataSize  = header.dataSize - dataBegin < header.chunkSize ? header.dataSize - dataBegin : header.chunkSize;
+
+        ProcessorErrorCode errorCode = chunkEnd < chunkBegin || chunkEnd > chunksSize ? BUFFER_ENDED :
+                                        DecompressChunk (chunks + chunkBegin, chunkEnd - chunkBegin,
+                                                            (unsigned char *) decompressed.data + dataBegin, dataSize);
+
+        if (errorCode != NO_PROCESSOR_ERRORS) {
+            DestroyBuffer (&decompressed);
+            ProgramErrorCheck (errorCode, "Compressed chunk is corrupted");
+        }
+
+        chunkBegin = chunkEnd;
+    }
+
+    decompressed.currentIndex = header.dataSize;
+    *data = decompressed;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Greedy parsing: a position is matched against the last position with the same hash of its first bytes
+static size_t CompressChunk (const unsigned char *data, size_t dataSize, unsigned char *compressed) {
+    PushLog (3);
+
+    custom_assert (data,       pointer_is_null, 0);
+    custom_assert (compressed, pointer_is_null, 0);
+
+    // positions are stored plus one, so zero is an empty entry
+    size_t hashTable [1 << HASH_TABLE_BITS] = {};
+
+    unsigned char *compressedEnd = compressed;
+    size_t         literalsBegin = 0;
+    size_t         position      = 0;
+
+    while (position + MIN_MATCH_LENGTH <= dataSize) {
+        uint32_t hash      = HashSequence (data + position);
+        size_t   candidate = hashTable [hash];
+
+        hashTable [hash] = position + 1;
+
+        if (candidate == 0 || position - (candidate - 1) > MAX_MATCH_OFFSET ||
+                memcmp (data + candidate - 1, data + position, MIN_MATCH_LENGTH) != 0) {
+            position++;
+            continue;
+        }
+
+        size_t matchBegin  = candidate - 1;
+        size_t matchLength = MIN_MATCH_LENGTH;
+
+        while (position + matchLength < dataSize && data [matchBegin + matchLength] == data [position + matchLength]) {
+            matchLength++;
+        }
+
+        compressedEnd = WriteSequence (compressedEnd, data + literalsBegin, position - literalsBegin, position - matchBegin, matchLength);
+
+        position     += matchLength;
+        literalsBegin = position;
+    }
+
+    compressedEnd = WriteSequence (compressedEnd, data + literalsBegin, dataSize - literalsBegin, 0, 0);
+
+    RETURN (size_t) (compressedEnd - compressed);
+}
+
+static ProcessorErrorCode DecompressChunk (const unsigned char *compressed, size_t compressedSize, unsigned char *data, size_t dataSize) {
+    PushLog (3);
+
+    custom_assert (compressed, pointer_is_null, NO_BUFFER);
+    custom_assert (data,       pointer_is_null, NO_BUFFER);
+
+    const unsigned char *compressedEnd = compressed + compressedSize;
+    unsigned char       *dataBegin     = data;
+    unsigned char       *dataEnd       = data + dataSize;
+
+    while (compressed < compressedEnd) {
+        unsigned char token          = *compressed++;
+        size_t        literalsLength = token >> 4;
+
+        if (literalsLength == TOKEN_LENGTH_MASK && !ReadLength (&compressed, compressedEnd, &literalsLength)) {
+            RETURN BUFFER_ENDED;
+        }
+
+        if (literalsLength > (size_t) (compressedEnd - compressed) || literalsLength > (size_t) (dataEnd - data)) {
+            RETURN BUFFER_ENDED;
+        }
+
+        memcpy (data, compressed, literalsLength);
+        data       += literalsLength;
+        compressed += literalsLength;
+
+        // literals-only sequence ends the chunk
+        if (compressed == compressedEnd) {
+            RETURN data == dataEnd ? NO_PROCESSOR_ERRORS : BUFFER_ENDED;
+        }
+
+        if (compressedEnd - compressed < 2) {
+            RETURN BUFFER_ENDED;
+        }
+
+        size_t matchOffset = (size_t) compressed [0] | (size_t) compressed [1] << 8;
+        size_t matchLength = token & TOKEN_LENGTH_MASK;
+        compressed += 2;
+
+        if (matchLength == TOKEN_LENGTH_MASK && !ReadLength (&compressed, compressedEnd, &matchLength)) {
+            RETURN BUFFER_ENDED;
+        }
+
+        matchLength += MIN_MATCH_LENGTH;
+
+        if (matchOffset == 0 || matchOffset > (size_t) (data - dataBegin) || matchLength > (size_t) (dataEnd - data)) {
+            RETURN WRONG_ADDRESS;
+        }
+
+        const unsigned char *match = data - matchOffset;
+
+        // overlapping match repeats the last matchOffset bytes, so it is copied byte by byte
+        if (matchOffset >= matchLength) {
+            memcpy (data, match, matchLength);
+            data += matchLength;
+        } else {
+            for (size_t byteIndex = 0; byteIndex < matchLength; byteIndex++) {
+                *data++ = match [byteIndex];
+            }
+        }
+    }
+
+    RETURN BUFFER_ENDED;
+}
+
+static unsigned char *WriteSequence (unsigned char *compressed, const unsigned char *literals, size_t literalsLength,
+                                        size_t matchOffset, size_t matchLength) {
+    PushLog (4);
+
+    size_t literalsHalf = literalsLength < TOKEN_LENGTH_MASK ? literalsLength : TOKEN_LENGTH_MASK;
+    size_t matchHalf    = 0;
+
+    if (matchLength > 0) {
+        matchHalf = matchLength - MIN_MATCH_LENGTH < TOKEN_LENGTH_MASK ? matchLength - MIN_MATCH_LENGTH : TOKEN_LENGTH_MASK;
+    }
+
+    *compressed++ = (unsigned char) (literalsHalf << 4 | matchHalf);
+
+    if (literalsHalf == TOKEN_LENGTH_MASK) {
+        compressed = WriteLength (compressed, literalsLength - TOKEN_LENGTH_MASK);
+    }
+
+    memcpy (compressed, literals, literalsLength);
+    compressed += literalsLength;
+
+    if (matchLength == 0) {
+        RETURN compressed;
+    }
+
+    *compressed++ = (unsigned char) (matchOffset & 0xff);
+    *compressed++ = (unsigned char) (matchOffset >> 8);
+
+    if (matchHalf == TOKEN_LENGTH_MASK) {
+        compressed = WriteLength (compressed, matchLength - MIN_MATCH_LENGTH - TOKEN_LENGTH_MASK);
+    }
+
+    RETURN compressed;
+}
+
+static unsigned char *WriteLength (unsigned char *compressed, size_t length) {
+    PushLog (4);
+
+    for (; length >= 0xff; length -= 0xff) {
+        *compressed++ = 0xff;
+    }
+
+    *compressed++ = (unsigned char) length;
+
+    RETURN compressed;
+}
+
+static bool ReadLength (const unsigned char **compressed, const unsigned char *compressedEnd, size_t *length) {
+    PushLog (4);
+
+    custom_assert (compressed, pointer_is_null, false);
+    custom_assert (length,     pointer_is_null, false);
+
+    unsigned char lengthByte = 0xff;
+
+    while (lengthByte == 0xff) {
+        if (*compressed >= compressedEnd) {
+            RETURN false;
+        }
+
+        lengthByte = *(*compressed)++;
+        *length   += lengthByte;
+    }
+
+    RETURN true;
+}
+
+// Fibonacci hashing of the first MIN_MATCH_LENGTH bytes
+static uint32_t HashSequence (const unsigned char *sequence) {
+    uint32_t word = 0;
+    memcpy (&word, sequence, sizeof (word));
+
+    return (word * 2654435761u) >> (32 - HASH_TABLE_BITS);
+}
+
+// Incompressible data grows by a length byte per 255 literals plus a token
+static size_t GetCompressedSizeBound (size_t dataSize) {
+    PushLog (4);
+
+    RETURN dataSize + dataSize / 0xff + 16;
+}
@@ -0,0 +1,60 @@
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MappedFile.h"
+#include "CustomAssert.h"
+#include "Logger.h"
+#include "TextTypes.h"
+
+bool MapFile (FileBuffer *fileBuffer, const char *filename) {
+    PushLog (2);
+
+    custom_assert (fileBuffer, pointer_is_null, false);
+    custom_assert (filename,   pointer_is_null, false);
+
+    int fileDescriptor = open (filename, O_RDONLY);
+
+    if (fileDescriptor < 0) {
+        RETURN false;
+    }
+
+    struct stat fileStat = {};
+
+    // empty file can not be mapped
+    if (fstat (fileDescriptor, &fileStat) != 0 || fileStat.st_size <= 0) {
+        close (fileDescriptor);
+        RETURN false;
+    }
+
+    void *mapping = mmap (NULL, (size_t) fileStat.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+
+    // mapping stays valid after the descriptor is closed
+    close (fileDescriptor);
+
+    if (mapping == MAP_FAILED) {
+        RETURN false;
+    }
+
+    fileBuffer->buffer      = (char *) mapping;
+    fileBuffer->buffer_size = fileStat.st_size;
+
+    RETURN true;
+}
+
+void UnmapFile (FileBuffer *fileBuffer) {
+    PushLog (2);
+
+    custom_assert (fileBuffer, pointer_is_null, (void) 0);
+
+    if (fileBuffer->buffer) {
+        munmap (fileBuffer->buffer, (size_t) fileBuffer->buffer_size);
+    }
+
+    fileBuffer->buffer      = NULL;
+    fileBuffer->buffer_size = 0;
+
+    RETURN;
+}
@@ -8,6 +8,7 @@
 #include "SecureStack/SecureStack.h"
 
 static char *GlobalPrefix = NULL;
+static bool  QuietMode    = false;
 
 static CONSOLE_COLOR GetMessageColor (MessageType type);
 
@@ -20,6 +21,10 @@ static void PrintAsmErrorLine  (FILE *stream, ProcessorMessage *message, CONSOLE
 ProcessorErrorCode PrintMessage (FILE *stream, ProcessorMessage message) {
     PushLog (4);
 
+    if (QuietMode && (message.type == INFO_MESSAGE || message.type == SUCCESS_MESSAGE)) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
     CONSOLE_COLOR messageColor = GetMessageColor (message.type);
 
     PrintPrefix      (stream, &message, messageColor);
@@ -46,6 +51,10 @@ void SetGlobalMessagePrefix (char *newPrefix) {
     GlobalPrefix = newPrefix;
 }
 
+void SetQuietMode (bool isQuiet) {
+    QuietMode = isQuiet;
+}
+
 static void PrintAsmErrorLine  (FILE *stream, ProcessorMessage *message, CONSOLE_COLOR color) {
     PushLog (4);
 
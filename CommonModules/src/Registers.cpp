@@ -2,10 +2,11 @@
 
 #include "Registers.h"
 #include "Logger.h"
+#include "PerfectHash.h"
 
 #define REGISTER(NAME, INDEX) {.name=#NAME, .index=INDEX}
 
-static const Register Registers [REGISTER_COUNT] = {
+static constexpr Register Registers [REGISTER_COUNT] = {
     REGISTER (rax, 0),
     REGISTER (rbx, 1),
     REGISTER (rcx, 2),
@@ -19,27 +20,57 @@ static const Register Registers [REGISTER_COUNT] = {
 
 #undef REGISTER
 
-#define FindRegister(predicate)                                                                     \
-            do {                                                                                    \
-                for (size_t registerIndex = 0; registerIndex < REGISTER_COUNT; registerIndex++) {   \
-                    if (predicate) {                                                                \
-                        RETURN Registers + registerIndex;                                           \
-                    }                                                                               \
-                }                                                                                   \
-                RETURN NULL;                                                                        \
-            }while (0)                                                                              \
+const size_t REGISTERS_HASH_SIZE = 32;
 
+struct RegisterNames {
+    const char *names [REGISTER_COUNT] = {};
+};
+
+static constexpr RegisterNames GetRegisterNames () {
+    RegisterNames registerNames = {};
+
+    for (size_t registerIndex = 0; registerIndex < REGISTER_COUNT; registerIndex++) {
+        registerNames.names [registerIndex] = Registers [registerIndex].name;
+    }
+
+    return registerNames;
+}
+
+static constexpr bool IsIndexedByPosition () {
+    for (size_t registerIndex = 0; registerIndex < REGISTER_COUNT; registerIndex++) {
+        if (Registers [registerIndex].index != registerIndex) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static constexpr RegisterNames                           RegistersNames   = GetRegisterNames ();
+static constexpr PerfectHashTable <REGISTERS_HASH_SIZE>  RegistersByName  =
+                    CreatePerfectHash <REGISTERS_HASH_SIZE> (RegistersNames.names, REGISTER_COUNT);
+
+static_assert (IsIndexedByPosition (),                "Register index has to be equal to its position in Registers array");
+static_assert (RegistersByName.seed != MAX_HASH_SEED, "Unable to build perfect hash of register names");
 
 const Register *FindRegisterByName  (char *name) {
     PushLog (4);
 
-    FindRegister (!strcmp (Registers [registerIndex].name, name));
+    unsigned char registerIndex = RegistersByName.Find (name);
+
+    if (registerIndex == NO_HASH_SLOT_VALUE || strcmp (Registers [registerIndex].name, name) != 0) {
+        RETURN NULL;
+    }
+
+    RETURN Registers + registerIndex;
 }
 
 const Register *FindRegisterByIndex (unsigned char index) {
     PushLog (4);
 
-    FindRegister (Registers [registerIndex].index == index);
-}
+    if (index >= REGISTER_COUNT) {
+        RETURN NULL;
+    }
 
-#undef FindRegister
+    RETURN Registers + index;
+}
@@ -4,29 +4,6 @@
 #include "StringProcessing.h"
 #include "CustomAssert.h"
 
-ssize_t CountWhitespaces (TextLine *line) {
-    PushLog (3);
-
-    custom_assert (line,          pointer_is_null, -1);
-    custom_assert (line->pointer, pointer_is_null, -1);
-
-    ssize_t lineBegin = FindActualStringBegin (line);
-    ssize_t lineEnd   = FindActualStringEnd   (line);
-
-    if (lineBegin < 0 || lineEnd < 0) {
-        RETURN -1;
-    }
-
-    ssize_t spaceCount = 0;
-
-    for (ssize_t charIndex = lineBegin; charIndex < lineEnd; charIndex++) {
-        if (isspace (line->pointer [charIndex]) || line->pointer [charIndex] == '+')
-            spaceCount++;
-    }
-
-    RETURN spaceCount;
-}
-
 #define DetectWhitespacePosition(FOR_PREDICATE)                 \
             custom_assert (line,          pointer_is_null, -1); \
             custom_assert (line->pointer, pointer_is_null, -1); \
@@ -58,15 +35,6 @@ ssize_t FindActualStringBegin (TextLine *line) {
 
 #undef DetectWhitespacePosition
 
-bool IsLabelLine (TextLine *line, char *labelName) {
-    PushLog (4);
-
-    custom_assert (line,            pointer_is_null, false);
-    custom_assert (line->pointer,   pointer_is_null, false);
-
-    RETURN line->pointer [FindActualStringEnd (line)] == ':' && sscanf (line->pointer, " %s", labelName) > 0;
-}
-
 ProcessorErrorCode DeleteExcessWhitespaces (TextBuffer *lines) {
     PushLog (3);
 
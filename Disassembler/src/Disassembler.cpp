@@ -18,15 +18,26 @@
 #include <string.h>
 #include <endian.h>
 
-static ProcessorErrorCode ReadInstruction (Buffer <char> *disassemblyBuffer, SPU *spu);
+const size_t DATA_VALUES_PER_LINE = 16;
+
+// Symbols section of the binary, labels are printed before instructions they point to
+struct DisassemblySymbols {
+    FileBuffer section     = {};
+    size_t     symbolIndex = 0;
+};
+
+static ProcessorErrorCode ReadInstruction (Buffer <char> *disassemblyBuffer, SPU *spu, DisassemblySymbols *symbols);
 static ProcessorErrorCode ReadArguments (const AssemblerInstruction *instruction, CommandCode *commandCode, SPU *spu, char *commandLine);
-static ProcessorErrorCode ReadHeader (Buffer <char> *headerBuffer, SPU *spu) ;
+static ProcessorErrorCode ReadHeader (Buffer <char> *headerBuffer, SPU *spu, DisassemblySymbols *symbols, FileBuffer *constants,
+                                        Buffer <char> *decompressedCode);
+static ProcessorErrorCode WriteLabels (Buffer <char> *disassemblyBuffer, SPU *spu, DisassemblySymbols *symbols);
+static ProcessorErrorCode WriteConstants (Buffer <char> *disassemblyBuffer, FileBuffer *constants);
 
 static ProcessorErrorCode WriteDisassemblyData (int outFileDescriptor, Buffer <char> *disassemblyBuffer, Buffer <char> *headerBuffer);
 static ProcessorErrorCode WriteHeaderData (int outFileDescriptor, Buffer <char> *headerBuffer);
 
 static ProcessorErrorCode CreateDisassemblyBuffers (Buffer <char> *disassemblyBuffer, Buffer <char> *headerBuffer, SPU *spu);
-static ProcessorErrorCode DestroyDisassemblyBuffers (Buffer <char> *disassemblyBuffer, Buffer <char> *headerBuffer);
+static ProcessorErrorCode DestroyDisassemblyBuffers (Buffer <char> *disassemblyBuffer, Buffer <char> *headerBuffer, Buffer <char> *decompressedCode);
 
 ProcessorErrorCode DisassembleFile (int outFileDescriptor, SPU *spu) {
     PushLog (1);
@@ -35,58 +46,86 @@ ProcessorErrorCode DisassembleFile (int outFileDescriptor, SPU *spu) {
 
     Buffer <char> disassemblyBuffer {};
     Buffer <char> headerBuffer      {};
+    DisassemblySymbols symbols      {};
+    FileBuffer constants            {};
+    Buffer <char> decompressedCode  {};
 
     CreateDisassemblyBuffers (&disassemblyBuffer, &headerBuffer, spu);
 
     PrintSuccessMessage ("Reading header...", NULL);
-    ProcessorErrorCode errorCode = ReadHeader (&headerBuffer, spu);
+    ProcessorErrorCode errorCode = ReadHeader (&headerBuffer, spu, &symbols, &constants, &decompressedCode);
 
     if (errorCode != NO_PROCESSOR_ERRORS) {
-        errorCode = (ProcessorErrorCode) (DestroyDisassemblyBuffers (&disassemblyBuffer, &headerBuffer) | errorCode);
+        errorCode = (ProcessorErrorCode) (DestroyDisassemblyBuffers (&disassemblyBuffer, &headerBuffer, &decompressedCode) | errorCode);
         ProgramErrorCheck (errorCode, "Invalid header readed");
     }
 
     PrintSuccessMessage ("Starting disassembly...", NULL);
 
-    while ((errorCode = ReadInstruction (&disassemblyBuffer, spu)) == NO_PROCESSOR_ERRORS);
+    if ((errorCode = WriteConstants (&disassemblyBuffer, &constants)) != NO_PROCESSOR_ERRORS) {
+        errorCode = (ProcessorErrorCode) (DestroyDisassemblyBuffers (&disassemblyBuffer, &headerBuffer, &decompressedCode) | errorCode);
+        ProgramErrorCheck (errorCode, "Error occuried while writing constants");
+    }
+
+    while ((errorCode = ReadInstruction (&disassemblyBuffer, spu, &symbols)) == NO_PROCESSOR_ERRORS);
 
     if (errorCode != BUFFER_ENDED) {
-        errorCode = (ProcessorErrorCode) (DestroyDisassemblyBuffers (&disassemblyBuffer, &headerBuffer) | errorCode);
+        errorCode = (ProcessorErrorCode) (DestroyDisassemblyBuffers (&disassemblyBuffer, &headerBuffer, &decompressedCode) | errorCode);
         ProgramErrorCheck (errorCode, "Disassembly error occuried");
     }
 
     if ((errorCode = WriteDisassemblyData (outFileDescriptor, &disassemblyBuffer, &headerBuffer)) != NO_PROCESSOR_ERRORS) {
-        errorCode = (ProcessorErrorCode) (DestroyDisassemblyBuffers (&disassemblyBuffer, &headerBuffer) | errorCode);
+        errorCode = (ProcessorErrorCode) (DestroyDisassemblyBuffers (&disassemblyBuffer, &headerBuffer, &decompressedCode) | errorCode);
         RETURN errorCode;
     }
 
-    ProgramErrorCheck (DestroyDisassemblyBuffers (&disassemblyBuffer, &headerBuffer), "Error occuried while destroying assembly buffers");
+    ProgramErrorCheck (DestroyDisassemblyBuffers (&disassemblyBuffer, &headerBuffer, &decompressedCode), "Error occuried while destroying assembly buffers");
 
     PrintSuccessMessage ("Disassembly finished successfully!", NULL);
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode ReadHeader (Buffer <char> *headerBuffer, SPU *spu) {
+static ProcessorErrorCode ReadHeader (Buffer <char> *headerBuffer, SPU *spu, DisassemblySymbols *symbols, FileBuffer *constants,
+                                        Buffer <char> *decompressedCode) {
 	PushLog (2);
 
-    custom_assert (headerBuffer, pointer_is_null, NO_BUFFER);
-    custom_assert (spu,          pointer_is_null, NO_PROCESSOR);
+    custom_assert (headerBuffer,     pointer_is_null, NO_BUFFER);
+    custom_assert (spu,              pointer_is_null, NO_PROCESSOR);
+    custom_assert (symbols,          pointer_is_null, NO_BUFFER);
+    custom_assert (constants,        pointer_is_null, NO_BUFFER);
+    custom_assert (decompressedCode, pointer_is_null, NO_BUFFER);
+
+    BinaryContainer container {};
+    ProgramErrorCheck (OpenContainer (&container, &spu->bytecode), "Header is corrupted");
 
-    Header readHeader {};
-    ReadData (spu, &readHeader, Header);
+    Header *header = &container.header;
 
-    ProgramErrorCheck (CheckHeader (&readHeader), "Header is corrupted");
+    WriteHeaderField (headerBuffer, header, signature, sizeof (uint16_t));
+    WriteHeaderField (headerBuffer, header, version,   sizeof (VERSION) - 1);
 
-    WriteHeaderField (headerBuffer, &readHeader, signature,     sizeof (unsigned short));
-    WriteHeaderField (headerBuffer, &readHeader, version,       sizeof (VERSION) - 1);
-    WriteHeaderField (headerBuffer, &readHeader, byteOrder,     sizeof (SYSTEM_BYTE_ORDER) - 1);
+    for (size_t sectionIndex = 0; sectionIndex < header->sectionsCount; sectionIndex++) {
+        SectionEntry *section = container.sections + sectionIndex;
 
-    ShrinkBytecodeBuffer (spu, sizeof (Header));
+        char sectionLine [MAX_INSTRUCTION_LENGTH] = "";
+        int  lineLength = snprintf (sectionLine, MAX_INSTRUCTION_LENGTH, "\tsection:  %s, offset %lu, size %lu%s\n",
+                                        GetSectionName (section->type), section->offset, section->size,
+                                        (section->flags & COMPRESSED_SECTION) ? ", compressed" : "");
 
-    if (readHeader.hasDebugInfo) {
-        ShrinkBytecodeBuffer (spu, sizeof (DebugInfoChunk) * readHeader.commandsCount);
+        WriteDataToBufferErrorCheck ("Error occuried while writing section to header buffer", headerBuffer, sectionLine, (size_t) lineLength);
     }
 
+    FileBuffer code = {};
+    ProgramErrorCheck (ReadSection (&container, CODE_SECTION, &code, decompressedCode), "Error occuried while reading code");
+    ProgramErrorCheck (GetSection  (&container, SYMBOLS_SECTION, &symbols->section),   "Error occuried while reading symbols");
+    ProgramErrorCheck (GetSection  (&container, CONSTANTS_SECTION, constants),         "Error occuried while reading constants");
+
+    if (!code.buffer) {
+        ProgramErrorCheck (WRONG_HEADER, "Binary has no code");
+    }
+
+    spu->bytecode = code;
+    spu->ip       = 0;
+
     WriteDataToBufferErrorCheck ("Error occuried while writing new line to header buffer", headerBuffer, "\n\n", 2);
 
 	RETURN NO_PROCESSOR_ERRORS;
@@ -106,17 +145,18 @@ static ProcessorErrorCode CreateDisassemblyBuffers (Buffer <char> *disassemblyBu
     ProgramErrorCheck (InitBuffer (disassemblyBuffer, (size_t) spu->bytecode.buffer_size * 10 + sizeof (Header)), "Unable to create disassembly buffer");
 
     // Creating header file
-    // size: header size + 100
-    ProgramErrorCheck (InitBuffer (headerBuffer, sizeof (Header) + 100), "Unable to create header buffer");
+    // size: header size + section table size + 100
+    ProgramErrorCheck (InitBuffer (headerBuffer, sizeof (Header) + sizeof (SectionEntry) * MAX_SECTIONS_COUNT + 100), "Unable to create header buffer");
 
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode DestroyDisassemblyBuffers (Buffer <char> *disassemblyBuffer, Buffer <char> *headerBuffer) {
+static ProcessorErrorCode DestroyDisassemblyBuffers (Buffer <char> *disassemblyBuffer, Buffer <char> *headerBuffer, Buffer <char> *decompressedCode) {
     PushLog (3);
 
     DestroyBuffer (disassemblyBuffer);
     DestroyBuffer (headerBuffer);
+    DestroyBuffer (decompressedCode);
 
     RETURN NO_PROCESSOR_ERRORS;
 }
@@ -155,11 +195,13 @@ static ProcessorErrorCode WriteDisassemblyData (int outFileDescriptor, Buffer <c
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode ReadInstruction (Buffer <char> *disassemblyBuffer, SPU *spu) {
+static ProcessorErrorCode ReadInstruction (Buffer <char> *disassemblyBuffer, SPU *spu, DisassemblySymbols *symbols) {
     PushLog (2);
 
     CheckBuffer (spu);
 
+    ProgramErrorCheck (WriteLabels (disassemblyBuffer, spu, symbols), "Error occuried while writing labels");
+
     CommandCode commandCode {0, 0};
     ReadData (spu, &commandCode, CommandCode);
 
@@ -175,7 +217,7 @@ static ProcessorErrorCode ReadInstruction (Buffer <char> *disassemblyBuffer, SPU
         PrintInfoMessage (message, NULL);
     )
 
-    if ((~instruction->commandCode.arguments) & commandCode.arguments) {
+    if (!IsPermittedArguments (instruction->commandCode.arguments, commandCode.arguments)) {
         ProgramErrorCheck (WRONG_INSTRUCTION, "Instruction does not takes this set of arguments");
     }
 
@@ -191,6 +233,72 @@ static ProcessorErrorCode ReadInstruction (Buffer <char> *disassemblyBuffer, SPU
     RETURN WriteDataToBuffer (disassemblyBuffer, commandLine, strlen (commandLine));
 }
 
+static ProcessorErrorCode WriteLabels (Buffer <char> *disassemblyBuffer, SPU *spu, DisassemblySymbols *symbols) {
+    PushLog (3);
+
+    custom_assert (symbols, pointer_is_null, NO_BUFFER);
+
+    size_t symbolsCount = (size_t) symbols->section.buffer_size / sizeof (SymbolEntry);
+
+    for (; symbols->symbolIndex < symbolsCount; symbols->symbolIndex++) {
+        SymbolEntry symbol = {};
+        memcpy (&symbol, symbols->section.buffer + symbols->symbolIndex * sizeof (SymbolEntry), sizeof (SymbolEntry));
+
+        if (symbol.address > spu->ip) {
+            break;
+        }
+
+        symbol.name [SYMBOL_NAME_LENGTH - 1] = '\0';
+
+        char labelLine [SYMBOL_NAME_LENGTH + 4] = "";
+        int  lineLength = snprintf (labelLine, sizeof (labelLine), "\t%s:\n", symbol.name);
+
+        WriteDataToBufferErrorCheck ("Error occuried while writing label to disassembly buffer", disassemblyBuffer, labelLine, (size_t) lineLength);
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Blocks are printed as data directives before the code, long blocks are split into lines. Values are printed exactly
+static ProcessorErrorCode WriteConstants (Buffer <char> *disassemblyBuffer, FileBuffer *constants) {
+    PushLog (3);
+
+    custom_assert (disassemblyBuffer, pointer_is_null, NO_BUFFER);
+    custom_assert (constants,         pointer_is_null, NO_BUFFER);
+
+    const size_t MaxValueLength = 32;
+
+    for (size_t offset = 0; offset < (size_t) constants->buffer_size;) {
+        ConstantsBlock block  = {};
+        const char    *values = NULL;
+
+        ProcessorErrorCode errorCode = ReadConstantsBlock (constants, &offset, &block, &values);
+        ProgramErrorCheck (errorCode, "Constants section is corrupted");
+
+        for (size_t valueIndex = 0; valueIndex < block.size; valueIndex++) {
+            char   valueString [MaxValueLength] = "";
+            elem_t value = 0;
+            int    valueLength = 0;
+
+            memcpy (&value, values + valueIndex * sizeof (elem_t), sizeof (elem_t));
+
+            if (valueIndex % DATA_VALUES_PER_LINE == 0) {
+                valueLength = snprintf (valueString, MaxValueLength, "\t%s [%lu]", ".data", block.address + valueIndex);
+                WriteDataToBufferErrorCheck ("Error occuried while writing data directive", disassemblyBuffer, valueString, (size_t) valueLength);
+            }
+
+            valueLength = snprintf (valueString, MaxValueLength, " %.17g", value);
+            WriteDataToBufferErrorCheck ("Error occuried while writing data value", disassemblyBuffer, valueString, (size_t) valueLength);
+
+            if (valueIndex % DATA_VALUES_PER_LINE == DATA_VALUES_PER_LINE - 1 || valueIndex + 1 == block.size) {
+                WriteDataToBufferErrorCheck ("Error occuried while writing new line", disassemblyBuffer, "\n", 1);
+            }
+        }
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
 static ProcessorErrorCode ReadArguments (const AssemblerInstruction *instruction, CommandCode *commandCode, SPU *spu, char *commandLine) {
     PushLog (3);
 
@@ -207,7 +315,7 @@ static ProcessorErrorCode ReadArguments (const AssemblerInstruction *instruction
 
     if (commandCode->arguments == (IMMED_ARGUMENT | REGISTER_ARGUMENT) || commandCode->arguments == (IMMED_ARGUMENT | REGISTER_ARGUMENT | MEMORY_ARGUMENT)) {
         ReadData (spu, &registerIndex, unsigned char);
-        ReadData (spu, &immedArgument, elem_t);
+        ReadImmediateData (spu, &immedArgument);
 
         const Register *foundRegister = FindRegisterByIndex (registerIndex);
 
@@ -218,7 +326,7 @@ static ProcessorErrorCode ReadArguments (const AssemblerInstruction *instruction
         sprintf (commandLine, "%s+%lf%n", foundRegister->name, immedArgument, &printedSymbols);
 
     }else if (commandCode->arguments & IMMED_ARGUMENT) {
-        ReadData (spu, &immedArgument, elem_t);
+        ReadImmediateData (spu, &immedArgument);
         sprintf (commandLine, "%lf%n", immedArgument, &printedSymbols);
 
     }else if (commandCode->arguments & REGISTER_ARGUMENT){
@@ -236,7 +344,7 @@ static ProcessorErrorCode ReadArguments (const AssemblerInstruction *instruction
 
     #undef REGISTER
 
-    #define INSTRUCTION(NAME, COMMAND_CODE, PROCESSOR_CALLBACK, DISASSEMBLER_CALLBACK)                      \
+    #define INSTRUCTION(NAME, COMMAND_CODE, FLOW, PROCESSOR_CALLBACK, DISASSEMBLER_CALLBACK)                \
     if (instruction->commandCode.opcode == ((CommandCode) COMMAND_CODE).opcode) {                           \
         DISASSEMBLER_CALLBACK                                                                               \
     }
@@ -256,7 +364,7 @@ static ProcessorErrorCode ReadArguments (const AssemblerInstruction *instruction
     RETURN NO_PROCESSOR_ERRORS;
 }
 
-#define INSTRUCTION(NAME, COMMAND_CODE, PROCESSOR_CALLBACK, DISASSEMBLER_CALLBACK)                      \
+#define INSTRUCTION(NAME, COMMAND_CODE, FLOW, PROCESSOR_CALLBACK, DISASSEMBLER_CALLBACK)                \
             INSTRUCTION_CALLBACK_FUNCTION (NAME) {                                                      \
                 return NO_PROCESSOR_ERRORS;                                                             \
             }
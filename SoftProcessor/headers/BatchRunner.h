@@ -0,0 +1,60 @@
+#ifndef BATCH_RUNNER_H_
+#define BATCH_RUNNER_H_
+
+#include <SFML/System/Mutex.hpp>
+#include <stddef.h>
+
+#include "CommonModules.h"
+#include "ProgramIO.h"
+#include "SoftProcessor.h"
+
+const size_t MAX_BATCH_THREADS = 256;
+
+// Binary shared by all programs of the batch with the same path. It is loaded by the first worker which needs it
+struct BatchImage {
+    char        *binaryPath           = NULL;
+    FileBuffer   binary               = {};
+    ProgramImage image                = {};
+
+    sf::Mutex          mutex          = {};
+    bool               isLoaded       = false;
+    ProcessorErrorCode loadStatus     = NO_PROCESSOR_ERRORS;
+};
+
+// One line of the batch list: binary path followed by values for in instruction
+struct BatchProgram {
+    char       *binaryPath         = NULL;
+    BatchImage *image              = NULL;
+    ProgramIO   io                 = {};
+
+    size_t executedInstructions    = 0;
+    bool   instructionsCounted     = false;    // JIT engine does not count instructions
+    double wallTime                = 0;        // milliseconds
+};
+
+// Programs [begin, end) of the batch. Owner takes them from the front, other workers steal from the back
+struct WorkQueue {
+    sf::Mutex mutex = {};
+
+    size_t begin    = 0;
+    size_t end      = 0;
+};
+
+struct BatchRunner {
+    BatchProgram *programs      = NULL;
+    size_t        programsCount = 0;
+
+    BatchImage   *images        = NULL;
+    size_t        imagesCount   = 0;
+
+    WorkQueue    *queues        = NULL;        // one for each worker
+    size_t        workersCount  = 0;
+
+    ExecutionOptions options    = {};
+};
+
+// Runs every program of the list on its own SPU using workersCount threads (0 - one for each core)
+// and writes results to reportFilename in JSON
+ProcessorErrorCode RunBatch (const char *listFilename, const char *reportFilename, size_t workersCount, ExecutionOptions *options);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef BYTECODE_VERIFIER_H_
+#define BYTECODE_VERIFIER_H_
+
+#include "CommonModules.h"
+#include "InstructionDecoder.h"
+
+// Checks register index, immediate memory address and jump target range of a single instruction.
+// Jump targets and memory addresses of verified instructions are known before execution and valid,
+// so unchecked engine skips runtime checks for them. That jump target is the beginning of an instruction
+// is checked by the decoder, when the block at the target is decoded
+bool VerifyInstruction (DecodedInstruction *instruction, size_t bytecodeSize);
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef INSTRUCTION_DECODER_H_
+#define INSTRUCTION_DECODER_H_
+
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "Buffer.h"
+#include "CommonModules.h"
+#include "SPU.h"
+
+struct DecodedInstruction;
+
+typedef ProcessorErrorCode (*fusedHandler_t) (SPU *spu, DecodedInstruction *instructions);
+
+struct DecodedInstruction {
+    const AssemblerInstruction *instruction = NULL;             // NULL marks the end of a block
+    CommandCode commandCode                 = {0, 0};
+
+    unsigned char registerIndex             = REGISTER_COUNT;
+    elem_t immedArgument                    = NAN;
+
+    size_t address                          = 0;                // original bytecode address
+
+    const void *threadedLabel               = NULL;             // dispatch target of the threaded engine
+
+    fusedHandler_t fusedHandler             = NULL;             // superinstruction replacing this and following instructions
+    size_t fusedLength                      = 1;                // number of instructions covered by superinstruction
+
+    bool verified                           = false;            // static operands are proven valid by the verifier
+    DecodedInstruction *jumpTarget          = NULL;             // verified jump destination, found at the first jump
+
+    const void *nativeEntry                 = NULL;             // native code of JIT engine, set once it is compiled
+    const void *jumpEntry                   = NULL;             // native code at static jump target, set at the first jump
+};
+
+// command code, register index, immediate format and the widest immediate
+const size_t MAX_ENCODED_INSTRUCTION_SIZE = sizeof (CommandCode) + 2 * sizeof (unsigned char) + sizeof (elem_t);
+const size_t DECODED_BLOCK_LENGTH         = 256;         // instructions
+const size_t MIN_INSTRUCTION_SLOTS        = 1 << 10;
+const size_t FUSION_PATTERNS_COUNT        = 9;           // patterns of InstructionFusion.cpp
+
+// Called for every decoded block under the decoding lock, sentinel after the block is passed to it too
+typedef ProcessorErrorCode (*labelsBinder_t) (DecodedInstruction *instructions, size_t instructionsCount);
+
+// Done with every block after it is decoded, so there are no passes over the whole program
+struct DecodingOptions {
+    bool verify               = false;      // mark instructions the unchecked engine runs without runtime checks
+    bool fuse                 = false;      // replace common instruction sequences with superinstructions
+    labelsBinder_t bindLabels = NULL;       // dispatch targets of threaded engines
+};
+
+// Instructions are found by their addresses with open addressing and linear probing, as labels in the assembler.
+// Slots are only added, so they are read without locks. Bigger table replaces this one when it is half full,
+// old ones are kept until the program is destroyed, as other processors may still look into them
+struct InstructionSlots {
+    DecodedInstruction **slots      = NULL;     // NULL is an empty slot
+    size_t               slotsCount = 0;        // power of two
+
+    InstructionSlots    *previous   = NULL;
+};
+
+// Bytecode is decoded by blocks, when execution enters them for the first time, so loading does not depend
+// on the program size. Block ends with control flow instruction and is followed by a sentinel instruction
+// keeping the address after it. Blocks are never moved or freed before the program is destroyed
+struct DecodedProgram {
+    FileBuffer bytecode                      = {};
+    size_t bytecodeSize                      = 0;
+
+    DecodingOptions options                  = {};
+
+    InstructionSlots *slots                  = NULL;
+    size_t instructionsCount                 = 0;               // instructions in slots
+
+    Buffer <DecodedInstruction *> blocks     = {0, 0, NULL};
+    DecodedInstruction programEnd            = {};              // sentinel found at the end of the bytecode
+
+    size_t fusedCounts [FUSION_PATTERNS_COUNT] = {};            // superinstructions of every pattern in decoded blocks
+    size_t verifiedCount                     = 0;
+
+    // Blocks start only at instruction beginnings, which are found by decoding the bytecode from the start.
+    // It is done up to the highest block start, when such block is decoded
+    unsigned char *instructionStarts         = NULL;            // bit per address below startsEnd
+    size_t startsCapacity                    = 0;               // bytes
+    size_t startsEnd                         = 0;
+
+    pthread_mutex_t mutex                    = PTHREAD_MUTEX_INITIALIZER;   // held while a block is decoded
+};
+
+// Bytecode has to live until the program is destroyed
+ProcessorErrorCode InitDecodedProgram    (DecodedProgram *program, FileBuffer *bytecode, DecodingOptions *options);
+ProcessorErrorCode DestroyDecodedProgram (DecodedProgram *program);
+
+// Reports what has been done with the decoded blocks so far
+void               PrintDecodingStatistics (DecodedProgram *program);
+
+// Decodes the block starting at address. Fails if address is in the middle of an instruction
+ProcessorErrorCode DecodeBlock           (DecodedProgram *program, size_t address, DecodedInstruction **instruction);
+
+// Decodes instruction at spu->ip and moves ip to the next one
+ProcessorErrorCode DecodeInstruction     (SPU *spu, DecodedInstruction *decodedInstruction);
+
+// Neighbouring addresses are spread over the table, so runs of short instructions do not make long probe chains
+inline size_t GetAddressSlot (size_t address, size_t slotsCount) {
+    size_t hash = address * 0x9e3779b97f4a7c15;
+
+    return (hash ^ (hash >> 32)) & (slotsCount - 1);
+}
+
+// Returns NULL if no decoded instruction starts at this address
+inline DecodedInstruction *FindDecodedInstruction (DecodedProgram *program, size_t address) {
+    InstructionSlots *slots = __atomic_load_n (&program->slots, __ATOMIC_ACQUIRE);
+    size_t slotMask         = slots->slotsCount - 1;
+
+    for (size_t slot = GetAddressSlot (address, slots->slotsCount); ; slot = (slot + 1) & slotMask) {
+        DecodedInstruction *instruction = __atomic_load_n (slots->slots + slot, __ATOMIC_ACQUIRE);
+
+        if (!instruction || instruction->address == address) {
+            return instruction;
+        }
+    }
+}
+
+// Same, but block is decoded if execution enters it for the first time
+inline ProcessorErrorCode GetDecodedInstruction (DecodedProgram *program, size_t address, DecodedInstruction **instruction) {
+    *instruction = FindDecodedInstruction (program, address);
+
+    if (*instruction) {
+        return NO_PROCESSOR_ERRORS;
+    }
+
+    return DecodeBlock (program, address, instruction);
+}
+
+// Returns NULL if instruction has no arguments or memory address is out of range
+inline elem_t *ResolveDecodedArgument (SPU *spu, DecodedInstruction *instruction) {
+    unsigned char arguments = instruction->commandCode.arguments;
+    elem_t *argumentPointer = NULL;
+
+    if ((arguments & (IMMED_ARGUMENT | REGISTER_ARGUMENT)) == (IMMED_ARGUMENT | REGISTER_ARGUMENT)) {
+        spu->tmpArgument = spu->registerValues [instruction->registerIndex] + instruction->immedArgument;
+        argumentPointer  = &spu->tmpArgument;
+
+    } else if (arguments & REGISTER_ARGUMENT) {
+        argumentPointer  = spu->registerValues + instruction->registerIndex;
+
+    } else if (arguments & IMMED_ARGUMENT) {
+        // immediate is copied, so pop can not overwrite decoded program
+        spu->tmpArgument = instruction->immedArgument;
+        argumentPointer  = &spu->tmpArgument;
+    }
+
+    if (arguments & MEMORY_ARGUMENT) {
+        if (spu->frequencySleep > 0) {
+            usleep (spu->frequencySleep);
+        }
+
+        ssize_t address = (ssize_t) *argumentPointer;
+
+        if (address < 0 || address >= (ssize_t) (RAM_SIZE + VRAM_SIZE)) {
+            return NULL;
+        }
+
+        argumentPointer = spu->ram + address;
+    }
+
+    return argumentPointer;
+}
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef INSTRUCTION_FUSION_H_
+#define INSTRUCTION_FUSION_H_
+
+#include "CommonModules.h"
+#include "InstructionDecoder.h"
+
+// Replaces common instruction sequences of straight-line code with superinstructions. Returns their number,
+// fusedCounts [FUSION_PATTERNS_COUNT] is atomically increased for every applied pattern.
+// Instructions inside a sequence are left as they are, so jumps to them still work
+size_t FuseBlock             (DecodedInstruction *instructions, size_t instructionsCount, size_t *fusedCounts);
+
+void   PrintFusionStatistics (const size_t *fusedCounts);
+
+#endif
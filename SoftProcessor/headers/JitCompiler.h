@@ -0,0 +1,81 @@
+#ifndef JIT_COMPILER_H_
+#define JIT_COMPILER_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include "Buffer.h"
+#include "CommonModules.h"
+#include "InstructionDecoder.h"
+#include "SPU.h"
+
+#if defined (__x86_64__) && defined (__linux__)
+    #define JIT_SUPPORTED 1
+#else
+    #define JIT_SUPPORTED 0
+#endif
+
+// Native stacks are doubled by the interpreter when native code finds them full
+const size_t JIT_MIN_STACK_CAPACITY = 1 << 10;
+const size_t JIT_CHUNK_SIZE         = 1 << 24;      // mapped at once, pages are used as units are compiled
+
+struct JitProgram;
+
+// State shared by native code and interpreter. While native code runs, rbx holds context address,
+// r12 - stack, r13 - registers, r14 - ram and r15 - stackSize (it is written back on exit)
+struct JitContext {
+    elem_t *stack             = NULL;
+    size_t  stackSize         = 0;
+    size_t  stackCapacity     = 0;
+
+    elem_t *registers         = NULL;
+    elem_t *ram               = NULL;
+
+    size_t *callStack         = NULL;           // return addresses
+    size_t  callStackSize     = 0;
+    size_t  callStackCapacity = 0;
+
+    DecodedProgram *decodedProgram = NULL;
+    JitProgram     *jitProgram     = NULL;
+
+    size_t ip                 = 0;              // address where native code has stopped
+    ProcessorErrorCode status = NO_PROCESSOR_ERRORS;    // NO_PROCESSOR_ERRORS means instruction at ip has to be interpreted
+
+    SPU *spu                  = NULL;
+
+    useconds_t frequencySleep = 0;              // copied from spu, as native code is shared by all processors
+    bool graphicsEnabled      = false;
+};
+
+typedef void (*jitFunction_t) (JitContext *context, const void *entry);
+
+// Units are written to fresh pages, which are made executable before the unit is published,
+// so code that may be running is never writable. Every chunk starts with its own exits
+struct JitChunk {
+    unsigned char *code              = NULL;
+    size_t         codeSize          = 0;       // size of mapped region
+    size_t         usedSize          = 0;       // executable pages at the beginning
+
+    size_t         epilogueOffset    = 0;
+    size_t         stackErrorOffset  = 0;
+    size_t         memoryErrorOffset = 0;
+    size_t         jumpErrorOffset   = 0;
+    size_t         helperErrorOffset = 0;
+};
+
+// Native code is compiled by units, when execution enters an instruction that has no code yet: unit goes from it
+// to the end of its decoded block. Code does not depend on a processor, so all cores and runs of the image share it
+struct JitProgram {
+    Buffer <JitChunk> chunks   = {0, 0, NULL};
+    jitFunction_t     function = NULL;          // prologue of the first chunk
+
+    pthread_mutex_t   mutex    = PTHREAD_MUTEX_INITIALIZER;     // held while a unit is compiled
+};
+
+ProcessorErrorCode InitJitProgram    (JitProgram *jitProgram);
+ProcessorErrorCode DestroyJitProgram (JitProgram *jitProgram);
+
+ProcessorErrorCode ExecuteJit (SPU *spu, DecodedProgram *decodedProgram, JitProgram *jitProgram);
+
+#endif
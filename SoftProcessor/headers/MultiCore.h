@@ -0,0 +1,55 @@
+#ifndef MULTI_CORE_H_
+#define MULTI_CORE_H_
+
+#include <SFML/System/Thread.hpp>
+#include <pthread.h>
+#include <stddef.h>
+
+#include "CommonModules.h"
+#include "SoftProcessor.h"
+#include "SPU.h"
+
+const size_t MAX_CORES_COUNT = 64;
+
+struct ProcessorCore {
+    SPU        *spu       = NULL;
+    sf::Thread *thread    = NULL;                 // NULL for core 0, which runs on the caller thread
+
+    bool isRunning        = false;
+    ProcessorErrorCode status = NO_PROCESSOR_ERRORS;  // error code the last run has stopped with
+};
+
+// Cores run one program image against the ram of core 0. Core 0 is the processor started by LaunchProgram,
+// others are idle until spawn instruction starts them on their own host threads.
+// State below the mutex is changed only while it is locked
+struct MultiCore {
+    ProcessorCore *cores        = NULL;
+    size_t         coresCount   = 0;
+
+    ProgramImage  *image        = NULL;
+
+    pthread_mutex_t mutex       = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t  stateChange = PTHREAD_COND_INITIALIZER;    // some core has stopped or barrier was passed
+
+    size_t runningCount         = 0;
+    size_t barrierArrived       = 0;
+    size_t barrierGeneration    = 0;
+};
+
+// spu becomes core 0 of the machine. Its ram and bytecode have to be ready
+ProcessorErrorCode InitMultiCore    (MultiCore *machine, SPU *spu, ProgramImage *image, size_t coresCount);
+// Marks core 0 as stopped and waits for all other cores
+ProcessorErrorCode StopMultiCore    (MultiCore *machine);
+ProcessorErrorCode DestroyMultiCore (MultiCore *machine);
+
+// Instructions helpers. Processor without a machine works as the only core
+ProcessorErrorCode SpawnCore   (SPU *spu, elem_t address, elem_t *coreId);
+ProcessorErrorCode JoinCore    (SPU *spu, elem_t coreId);
+ProcessorErrorCode WaitBarrier (SPU *spu);
+size_t             GetCoresCount (SPU *spu);
+
+// Both return the value memory cell had before the operation
+elem_t AtomicAdd             (elem_t *destination, elem_t value);
+elem_t AtomicCompareExchange (elem_t *destination, elem_t expected, elem_t desired);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef PROGRAM_IO_H_
+#define PROGRAM_IO_H_
+
+#include "Buffer.h"
+#include "CommonModules.h"
+#include "SPU.h"
+
+// Console replacement for headless runs: in takes values from input, out appends them to output.
+// status is the error code execution has stopped with
+struct ProgramIO {
+    Buffer <elem_t> input     = {};
+    size_t          inputIndex = 0;
+
+    Buffer <elem_t> output    = {};
+
+    ProcessorErrorCode status = NO_PROCESSOR_ERRORS;
+};
+
+ProcessorErrorCode WriteProgramOutput (SPU *spu, elem_t value);
+ProcessorErrorCode ReadProgramInput   (SPU *spu, elem_t *value);
+
+#endif
@@ -1,10 +1,57 @@
 #ifndef SOFT_PROCESSOR_H_
 #define SOFT_PROCESSOR_H_
 
+#include "AssemblyHeader.h"
+#include "Buffer.h"
 #include "CommonModules.h"
+#include "InstructionDecoder.h"
+#include "JitCompiler.h"
+#include "SPU.h"
 #include "TextTypes.h"
 #include <SFML/System/Mutex.hpp>
 
-ProcessorErrorCode LaunchProgram (SPU *spu, char *sourceFilename, char *binaryFilename, sf::Mutex *workMutex);
+enum ExecutionEngine {
+    CALLBACK_ENGINE    = 0,     // decoded instructions dispatched through callback functions
+    THREADED_ENGINE    = 1,     // direct-threaded interpreter generated from Instructions.def
+    SPECIALIZED_ENGINE = 2,     // handlers specialized for each arguments mode, indexed by raw command code
+    JIT_ENGINE         = 3,     // x86-64 native code, in, out, sleep and multi-core instructions are interpreted
+    UNCHECKED_ENGINE   = 4,     // specialized engine without runtime checks of operands proven by the verifier
+    CACHED_ENGINE      = 5,     // threaded engine keeping operand stack top out of the stack library
+    TIERED_ENGINE      = 6,     // bytecode interpreter, hot blocks are translated to specialized handlers
+};
+
+struct ExecutionOptions {
+    ExecutionEngine engine = CALLBACK_ENGINE;
+    bool fuseInstructions  = true;      // replace common instruction sequences with superinstructions
+    size_t coresCount      = 1;         // cores sharing ram, see MultiCore.h
+    bool verifyChecksums   = false;     // checksum takes the whole code, so it is not computed at load by default
+};
+
+// Loaded program. Many processors can run one image at the same time, each with its own ip, stacks, registers and ram.
+// Execution only adds decoded blocks and their native code to it under their locks. Binary itself is owned by the caller
+struct ProgramImage {
+    Buffer <DebugInfoChunk> debugInfo = {0, 0, NULL};       // read in debug mode only
+    bool hasDebugInfo                 = false;
+    bool isDebugInfoOwned             = false;              // debug info is read in place from the binary unless it is misaligned
+
+    FileBuffer code                   = {};                 // code section of the binary
+    Buffer <char> decompressedCode    = {0, 0, NULL};       // storage of the code if it is compressed in the binary
+    DecodedProgram decodedProgram     = {};                 // blocks prepared for the engine, empty in debug mode and for tiered engine
+    JitProgram jitProgram             = {};                 // native code of decoded blocks for JIT engine
+    FileBuffer constants              = {};                 // constants section of the binary, copied to ram before every run
+
+    ExecutionEngine engine            = CALLBACK_ENGINE;
+};
+
+ProcessorErrorCode LoadProgramImage    (ProgramImage *image, FileBuffer *binary, ExecutionOptions *options);
+ProcessorErrorCode DestroyProgramImage (ProgramImage *image);
+
+// Headless run of the image on spu: no debugger, spu stacks and ram are allocated for this run
+ProcessorErrorCode RunProgramImage (SPU *spu, ProgramImage *image);
+
+// Runs the image with the engine it was loaded for, starting from spu->ip with current spu stacks and ram
+ProcessorErrorCode ExecuteProgramImage (SPU *spu, ProgramImage *image);
+
+ProcessorErrorCode LaunchProgram (SPU *spu, char *sourceFilename, char *binaryFilename, sf::Mutex *workMutex, ExecutionOptions *options);
 
 #endif
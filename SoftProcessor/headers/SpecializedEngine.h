@@ -0,0 +1,20 @@
+#ifndef SPECIALIZED_ENGINE_H_
+#define SPECIALIZED_ENGINE_H_
+
+#include "CommonModules.h"
+#include "InstructionDecoder.h"
+#include "SPU.h"
+
+const size_t HANDLERS_TABLE_SIZE = OPCODES_COUNT * ARGUMENTS_MODES_COUNT;
+
+typedef ProcessorErrorCode (*specializedHandler_t) (SPU *spu, DecodedInstruction *instruction);
+
+ProcessorErrorCode ExecuteSpecialized (SPU *spu, DecodedProgram *decodedProgram);
+
+// Same as specialized engine, but instructions marked by VerifyInstruction run without checks of static operands
+ProcessorErrorCode ExecuteUnchecked   (SPU *spu, DecodedProgram *decodedProgram);
+
+// Handler of the instruction with given arguments mode. Verified handler skips checks of static operands
+specializedHandler_t GetSpecializedHandler (CommandCode commandCode, bool verified);
+
+#endif
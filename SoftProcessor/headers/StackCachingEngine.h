@@ -0,0 +1,24 @@
+#ifndef STACK_CACHING_ENGINE_H_
+#define STACK_CACHING_ENGINE_H_
+
+#include "CommonModules.h"
+#include "InstructionDecoder.h"
+#include "SPU.h"
+
+const size_t STACK_CACHE_MIN_CAPACITY = 1 << 10;
+
+// Operand stack of the stack caching engine. Top value is kept apart from the rest, so it can stay in a register
+struct StackCache {
+    elem_t  topValue = NAN;
+    elem_t *values   = NULL;        // values under the top one and a slot for the top, doubled when it is full
+    size_t  capacity = 0;
+    size_t  size     = 0;           // number of values including the top one
+};
+
+// Threaded interpreter working on StackCache instead of spu->processorStack.
+// Stack is moved back to spu->processorStack when execution stops.
+// Labels are bound to every decoded block, as in threaded engine
+ProcessorErrorCode BindStackCachingLabels (DecodedInstruction *instructions, size_t instructionsCount);
+ProcessorErrorCode ExecuteStackCaching    (SPU *spu, DecodedProgram *decodedProgram);
+
+#endif
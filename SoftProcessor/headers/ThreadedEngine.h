@@ -0,0 +1,13 @@
+#ifndef THREADED_ENGINE_H_
+#define THREADED_ENGINE_H_
+
+#include "CommonModules.h"
+#include "InstructionDecoder.h"
+#include "SPU.h"
+
+// Labels are bound to every block when it is decoded, see DecodingOptions. Program can be executed
+// by many processors at the same time
+ProcessorErrorCode BindThreadedLabels (DecodedInstruction *instructions, size_t instructionsCount);
+ProcessorErrorCode ExecuteThreaded    (SPU *spu, DecodedProgram *decodedProgram);
+
+#endif
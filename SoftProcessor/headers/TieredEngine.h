@@ -0,0 +1,65 @@
+#ifndef TIERED_ENGINE_H_
+#define TIERED_ENGINE_H_
+
+#include <stddef.h>
+
+#include "CommonModules.h"
+#include "InstructionDecoder.h"
+#include "SpecializedEngine.h"
+#include "SPU.h"
+
+const size_t TIER_UP_THRESHOLD  = 50;           // block is translated after this number of entries
+const size_t MAX_BLOCK_LENGTH   = 256;          // instructions
+const size_t MIN_TIERED_ENTRIES = 1 << 10;
+
+typedef ProcessorErrorCode (*interpreterStep_t) (SPU *spu);
+
+struct BlockOperation {
+    specializedHandler_t handler     = NULL;    // superinstruction or specialized handler
+    DecodedInstruction  *instruction = NULL;
+    size_t               nextAddress = 0;
+};
+
+// Straight-line code ending with control flow instruction
+struct TranslatedBlock {
+    DecodedInstruction *instructions    = NULL;
+    BlockOperation     *operations      = NULL;
+    size_t              operationsCount = 0;
+};
+
+struct TieredStatistics {
+    size_t tierUps          = 0;                // blocks that reached TIER_UP_THRESHOLD
+    size_t blocksTranslated = 0;
+    size_t cacheHits        = 0;                // translated block executions
+
+    size_t fusedCounts [FUSION_PATTERNS_COUNT] = {};    // superinstructions of translated blocks
+};
+
+// Block that has been entered at least once
+struct TieredEntry {
+    size_t           address      = 0;
+    size_t           entriesCount = 0;
+    TranslatedBlock *block        = NULL;
+
+    bool             isUsed       = false;
+};
+
+struct TieredCache {
+    TieredEntry *entries         = NULL;        // open addressing table, keyed by block start address
+    size_t       entriesCapacity = 0;
+    size_t       entriesCount    = 0;
+
+    size_t bytecodeSize          = 0;
+
+    TieredStatistics statistics  = {};
+};
+
+ProcessorErrorCode InitTieredCache    (TieredCache *cache, size_t bytecodeSize);
+ProcessorErrorCode DestroyTieredCache (TieredCache *cache);
+
+// Cold code is executed by interpretInstruction, hot blocks are translated and run from the cache
+ProcessorErrorCode ExecuteTiered      (SPU *spu, TieredCache *cache, interpreterStep_t interpretInstruction);
+
+void PrintTieredStatistics (TieredCache *cache);
+
+#endif
@@ -5,11 +5,13 @@
 #include <SFML/Window/WindowStyle.hpp>
 #include <cstddef>
 #include <stdio.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include "AssemblyHeader.h"
+#include "BatchRunner.h"
 #include "CommonModules.h"
 #include "CustomAssert.h"
 #include "FileIO.h"
@@ -19,12 +21,19 @@
 #include "SoftProcessor.h"
 #include "TextTypes.h"
 #include "GraphicsProvider.h"
+#include "MappedFile.h"
+#include "MultiCore.h"
 #include "Stack/Stack.h"
 
 static char      *BinaryFile           = NULL;
 static char      *SourceFile           = NULL;
 static useconds_t FrequencyTime        = 0;
 static bool       IsGraphicsEnabled    = false;
+static ExecutionOptions Options        = {};
+
+static char      *BatchList            = NULL;
+static const char *BatchReport          = "batch_report.json";
+static size_t     BatchThreads         = 0;     // one for each core
 
 static sf::Mutex  WorkMutex            = {};
 
@@ -33,6 +42,14 @@ void AddSource       (char **arguments);
 void SetFrequency    (char **arguments);
 void EnableDebugMode (char **arguments);
 void EnableGraphics  (char **arguments);
+void SetEngine       (char **arguments);
+void DisableFusion   (char **arguments);
+void EnableJit       (char **arguments);
+void SetBatchList    (char **arguments);
+void SetBatchReport  (char **arguments);
+void SetBatchThreads (char **arguments);
+void SetCoresCount   (char **arguments);
+void EnableChecksums (char **arguments);
 
 static bool PrepareForExecuting (FileBuffer *fileBuffer);
 void LaunchThread (SPU *spu);
@@ -49,8 +66,32 @@ int main (int argc, char **argv){
     register_flag ("-f", "--frequency", SetFrequency,    1);
     register_flag ("-d", "--debug",     EnableDebugMode, 0);
     register_flag ("-g", "--graphics",  EnableGraphics,  0);
+    register_flag ("-e", "--engine",    SetEngine,       1);
+    register_flag ("-n", "--no-fusion", DisableFusion,   0);
+    register_flag ("-j", "--jit",       EnableJit,       0);
+    register_flag ("-B", "--batch",     SetBatchList,    1);
+    register_flag ("-r", "--report",    SetBatchReport,  1);
+    register_flag ("-t", "--threads",   SetBatchThreads, 1);
+    register_flag ("-c", "--cores",     SetCoresCount,   1);
+    register_flag ("-v", "--verify",    EnableChecksums, 0);
     parse_flags   (argc, argv);
 
+    // Headless mode: no graphics, debugger and console io
+    if (BatchList) {
+        if (IsDebugMode () || IsGraphicsEnabled) {
+            PrintWarningMessage (NO_PROCESSOR_ERRORS, "Debug mode and graphics are not available in batch mode", NULL, NULL, -1);
+            SetDebugMode (false);
+        }
+
+        if (Options.coresCount > 1) {
+            PrintWarningMessage (NO_PROCESSOR_ERRORS, "Batch mode runs every program on one core", NULL, NULL, -1);
+        }
+
+        RunBatch (BatchList, BatchReport, BatchThreads, &Options);
+
+        RETURN 0;
+    }
+
     //Read binary file
     FileBuffer fileBuffer = {};
 
@@ -79,13 +120,13 @@ int main (int argc, char **argv){
     }
 
     processorThread.wait ();
-    DestroyFileBuffer (&fileBuffer);
+    UnmapFile (&fileBuffer);
 
     RETURN 0;
 }
 
 void LaunchThread (SPU *spu) {
-    LaunchProgram (spu, SourceFile, BinaryFile, &WorkMutex);
+    LaunchProgram (spu, SourceFile, BinaryFile, &WorkMutex, &Options);
 }
 
 static bool PrepareForExecuting (FileBuffer *fileBuffer) {
@@ -95,13 +136,9 @@ static bool PrepareForExecuting (FileBuffer *fileBuffer) {
         RETURN false;
     }
 
-    if (!CreateFileBuffer (fileBuffer, BinaryFile)) {
-        PrintErrorMessage (INPUT_FILE_ERROR, "Error occuried while creating binary file buffer", NULL, NULL, -1);
-        RETURN false;
-    }
-
-    if (!ReadFile (BinaryFile, fileBuffer)) {
-        PrintErrorMessage (INPUT_FILE_ERROR, "Error occuried while reading binary", NULL, NULL, -1);
+    // binary is executed right from the mapping
+    if (!MapFile (fileBuffer, BinaryFile)) {
+        PrintErrorMessage (INPUT_FILE_ERROR, "Error occuried while mapping binary", NULL, NULL, -1);
         RETURN false;
     }
 
@@ -175,3 +212,127 @@ void EnableGraphics  (char **arguments) {
 
     RETURN;
 }
+
+void SetEngine (char **arguments) {
+    PushLog (3);
+
+    custom_assert (arguments,     pointer_is_null, (void)0);
+    custom_assert (arguments [0], pointer_is_null, (void)0);
+
+    struct EngineName {
+        const char     *name;
+        ExecutionEngine engine;
+    };
+
+    const EngineName EngineNames [] = {
+        {"callback",    CALLBACK_ENGINE},
+        {"threaded",    THREADED_ENGINE},
+        {"specialized", SPECIALIZED_ENGINE},
+        {"jit",         JIT_ENGINE},
+        {"unchecked",   UNCHECKED_ENGINE},
+        {"cached",      CACHED_ENGINE},
+        {"tiered",      TIERED_ENGINE},
+    };
+
+    for (size_t engineIndex = 0; engineIndex < sizeof (EngineNames) / sizeof (EngineName); engineIndex++) {
+        if (!strcmp (arguments [0], EngineNames [engineIndex].name)) {
+            Options.engine = EngineNames [engineIndex].engine;
+            RETURN;
+        }
+    }
+
+    PrintWarningMessage (NO_PROCESSOR_ERRORS, "Unknown execution engine. Using callback engine.", NULL, NULL, -1);
+
+    Options.engine = CALLBACK_ENGINE;
+
+    RETURN;
+}
+
+void DisableFusion (char **arguments) {
+    PushLog (3);
+
+    Options.fuseInstructions = false;
+
+    RETURN;
+}
+
+void EnableChecksums (char **arguments) {
+    PushLog (3);
+
+    Options.verifyChecksums = true;
+
+    RETURN;
+}
+
+void EnableJit (char **arguments) {
+    PushLog (3);
+
+    Options.engine = JIT_ENGINE;
+
+    RETURN;
+}
+
+void SetBatchList (char **arguments) {
+    PushLog (3);
+
+    custom_assert (arguments,     pointer_is_null, (void)0);
+    custom_assert (arguments [0], pointer_is_null, (void)0);
+
+    if (!IsRegularFile (arguments [0])){
+        PrintErrorMessage (INPUT_FILE_ERROR, "Error occuried while adding batch list - not a regular file", NULL, NULL, -1);
+        RETURN;
+    }
+
+    BatchList = arguments [0];
+
+    RETURN;
+}
+
+void SetBatchReport (char **arguments) {
+    PushLog (3);
+
+    custom_assert (arguments,     pointer_is_null, (void)0);
+    custom_assert (arguments [0], pointer_is_null, (void)0);
+
+    BatchReport = arguments [0];
+
+    RETURN;
+}
+
+void SetBatchThreads (char **arguments) {
+    PushLog (3);
+
+    custom_assert (arguments,     pointer_is_null, (void)0);
+    custom_assert (arguments [0], pointer_is_null, (void)0);
+
+    long threadsCount = atol (arguments [0]);
+
+    if (threadsCount <= 0 || threadsCount > (long) MAX_BATCH_THREADS) {
+        PrintWarningMessage (NO_PROCESSOR_ERRORS, "Bad threads count. Using one thread for each core.", NULL, NULL, -1);
+
+        threadsCount = 0;
+    }
+
+    BatchThreads = (size_t) threadsCount;
+
+    RETURN;
+}
+
+void SetCoresCount (char **arguments) {
+    PushLog (3);
+
+    custom_assert (arguments,     pointer_is_null, (void)0);
+    custom_assert (arguments [0], pointer_is_null, (void)0);
+
+    long coresCount = atol (arguments [0]);
+
+    if (coresCount <= 0 || coresCount > (long) MAX_CORES_COUNT) {
+        PrintWarningMessage (NO_PROCESSOR_ERRORS, "Bad cores count. Using one core.", NULL, NULL, -1);
+
+        coresCount = 1;
+    }
+
+    Options.coresCount = (size_t) coresCount;
+
+    RETURN;
+}
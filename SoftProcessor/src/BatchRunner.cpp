@@ -0,0 +1,461 @@
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Mutex.hpp>
+#include <SFML/System/Thread.hpp>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "BatchRunner.h"
+#include "Buffer.h"
+#include "CommonModules.h"
+#include "CustomAssert.h"
+#include "Debugger.h"
+#include "FileIO.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "MessageHandler.h"
+#include "ProgramIO.h"
+#include "SoftProcessor.h"
+#include "SPU.h"
+#include "TextTypes.h"
+
+struct BatchWorker {
+    BatchRunner *runner = NULL;
+    size_t       index  = 0;
+};
+
+static ProcessorErrorCode ReadBatchList    (BatchRunner *runner, TextBuffer *listText);
+static ProcessorErrorCode WriteBatchReport (BatchRunner *runner, const char *reportFilename, double wallTime);
+static void               DestroyBatch     (BatchRunner *runner);
+
+static void BatchWorkerThread  (BatchWorker *worker);
+static bool TakeProgram        (WorkQueue *queue, size_t *programIndex);
+static bool StealPrograms      (BatchRunner *runner, size_t thiefIndex, size_t *programIndex);
+static void RunBatchProgram    (BatchProgram *program, ExecutionOptions *options);
+
+static BatchImage        *FindBatchImage (BatchRunner *runner, char *binaryPath);
+static ProcessorErrorCode LoadBatchImage (BatchImage *image, ExecutionOptions *options);
+
+static const char *GetStatusName     (ProcessorErrorCode status);
+static void        WriteReportString (FILE *report, const char *string);
+static void        WriteReportValue  (FILE *report, elem_t value);
+
+ProcessorErrorCode RunBatch (const char *listFilename, const char *reportFilename, size_t workersCount, ExecutionOptions *options) {
+    PushLog (1);
+
+    custom_assert (listFilename,   pointer_is_null, INPUT_FILE_ERROR);
+    custom_assert (reportFilename, pointer_is_null, OUTPUT_FILE_ERROR);
+    custom_assert (options,        pointer_is_null, NO_BUFFER);
+
+    BatchRunner runner  = {};
+    FileBuffer listData = {};
+    TextBuffer listText = {};
+
+    runner.options = *options;
+
+    ProgramErrorCheck (ReadSourceFile (&listData, &listText, listFilename), "Error occuried while reading batch list");
+
+    ProcessorErrorCode errorCode = ReadBatchList (&runner, &listText);
+
+    if (errorCode != NO_PROCESSOR_ERRORS || runner.programsCount == 0) {
+        DestroyBatch (&runner);
+        free (listText.lines);
+        DestroyFileBuffer (&listData);
+
+        ProgramErrorCheck (errorCode, "Error occuried while parsing batch list");
+        ProgramErrorCheck (INPUT_FILE_ERROR, "Batch list has no programs");
+    }
+
+    if (workersCount == 0) {
+        workersCount = (size_t) sysconf (_SC_NPROCESSORS_ONLN);
+    }
+
+    if (workersCount > MAX_BATCH_THREADS) {
+        workersCount = MAX_BATCH_THREADS;
+    }
+
+    if (workersCount > runner.programsCount) {
+        workersCount = runner.programsCount;
+    }
+
+    // programs are split evenly, workers which finish earlier steal the rest
+    runner.workersCount = workersCount;
+    runner.queues       = new WorkQueue [workersCount];
+
+    for (size_t workerIndex = 0; workerIndex < workersCount; workerIndex++) {
+        runner.queues [workerIndex].begin = runner.programsCount *  workerIndex      / workersCount;
+        runner.queues [workerIndex].end   = runner.programsCount * (workerIndex + 1) / workersCount;
+    }
+
+    BatchWorker workers [MAX_BATCH_THREADS]  = {};
+    sf::Thread *threads [MAX_BATCH_THREADS] = {};
+
+    SetQuietMode (true);
+
+    sf::Clock batchClock;
+
+    for (size_t workerIndex = 0; workerIndex < workersCount; workerIndex++) {
+        workers [workerIndex] = {&runner, workerIndex};
+        threads [workerIndex] = new sf::Thread (&BatchWorkerThread, workers + workerIndex);
+
+        threads [workerIndex]->launch ();
+    }
+
+    for (size_t workerIndex = 0; workerIndex < workersCount; workerIndex++) {
+        threads [workerIndex]->wait ();
+
+        delete threads [workerIndex];
+    }
+
+    double wallTime = (double) batchClock.getElapsedTime ().asMicroseconds () / 1000;
+
+    SetQuietMode (false);
+
+    errorCode = WriteBatchReport (&runner, reportFilename, wallTime);
+
+    if (errorCode == NO_PROCESSOR_ERRORS) {
+        size_t failedCount = 0;
+
+        for (size_t programIndex = 0; programIndex < runner.programsCount; programIndex++) {
+            ProcessorErrorCode status = runner.programs [programIndex].io.status;
+
+            if (status != PROCESSOR_HALT && status != BUFFER_ENDED) {
+                failedCount++;
+            }
+        }
+
+        char message [MAX_MESSAGE_LENGTH] = "";
+
+        snprintf (message, MAX_MESSAGE_LENGTH, "Batch finished: %lu programs (%lu failed) on %lu threads in %.1lf ms",
+                    runner.programsCount, failedCount, workersCount, wallTime);
+        PrintSuccessMessage (message, NULL);
+    }
+
+    DestroyBatch (&runner);
+    free (listText.lines);
+    DestroyFileBuffer (&listData);
+
+    ProgramErrorCheck (errorCode, "Error occuried while writing batch report");
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Line format: binary path and input values separated by spaces. Empty lines and lines starting with # are skipped
+static ProcessorErrorCode ReadBatchList (BatchRunner *runner, TextBuffer *listText) {
+    PushLog (2);
+
+    custom_assert (runner,   pointer_is_null, NO_BUFFER);
+    custom_assert (listText, pointer_is_null, NO_BUFFER);
+
+    runner->programs = (BatchProgram *) calloc (listText->line_count, sizeof (BatchProgram));
+
+    if (!runner->programs) {
+        ProgramErrorCheck (NO_BUFFER, "Error occuried while allocating batch programs");
+    }
+
+    runner->images = new BatchImage [listText->line_count];
+
+    const char *separators = " \t\r";
+
+    for (size_t lineIndex = 0; lineIndex < listText->line_count; lineIndex++) {
+        char *savePointer = NULL;
+        char *token       = strtok_r (listText->lines [lineIndex].pointer, separators, &savePointer);
+
+        if (!token || *token == '#') {
+            continue;
+        }
+
+        BatchProgram *program = runner->programs + runner->programsCount++;
+        program->binaryPath   = token;
+        program->image        = FindBatchImage (runner, token);
+
+        while ((token = strtok_r (NULL, separators, &savePointer))) {
+            char  *valueEnd = NULL;
+            elem_t value    = strtod (token, &valueEnd);
+
+            if (*valueEnd != '\0') {
+                char message [MAX_MESSAGE_LENGTH] = "";
+
+                snprintf (message, MAX_MESSAGE_LENGTH, "Wrong input value \"%s\" at line %lu of batch list", token, lineIndex + 1);
+                ProgramErrorCheck (INPUT_FILE_ERROR, message);
+            }
+
+            ProgramErrorCheck (WriteDataToBuffer (&program->io.input, &value, 1), "Error occuried while writing program input");
+        }
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static void BatchWorkerThread (BatchWorker *worker) {
+    PushLog (2);
+
+    custom_assert (worker,         pointer_is_null, (void) 0);
+    custom_assert (worker->runner, pointer_is_null, (void) 0);
+
+    BatchRunner *runner       = worker->runner;
+    size_t       programIndex = 0;
+
+    while (TakeProgram (runner->queues + worker->index, &programIndex) || StealPrograms (runner, worker->index, &programIndex)) {
+        RunBatchProgram (runner->programs + programIndex, &runner->options);
+    }
+
+    RETURN;
+}
+
+static bool TakeProgram (WorkQueue *queue, size_t *programIndex) {
+    PushLog (3);
+
+    bool hasProgram = false;
+
+    queue->mutex.lock ();
+
+    if (queue->begin < queue->end) {
+        *programIndex = queue->begin++;
+        hasProgram    = true;
+    }
+
+    queue->mutex.unlock ();
+
+    RETURN hasProgram;
+}
+
+// Takes the back half of the first non-empty queue. Thief's own queue is empty at this point.
+// Only one queue is locked at a time, so workers can not deadlock
+static bool StealPrograms (BatchRunner *runner, size_t thiefIndex, size_t *programIndex) {
+    PushLog (3);
+
+    for (size_t victimOffset = 1; victimOffset < runner->workersCount; victimOffset++) {
+        WorkQueue *victim = runner->queues + (thiefIndex + victimOffset) % runner->workersCount;
+
+        victim->mutex.lock ();
+
+        size_t stolenBegin = victim->begin + (victim->end - victim->begin) / 2;
+        size_t stolenEnd   = victim->end;
+
+        victim->end = stolenBegin;
+
+        victim->mutex.unlock ();
+
+        if (stolenBegin == stolenEnd) {
+            continue;
+        }
+
+        WorkQueue *thief = runner->queues + thiefIndex;
+
+        thief->mutex.lock ();
+        thief->begin = stolenBegin + 1;
+        thief->end   = stolenEnd;
+        thief->mutex.unlock ();
+
+        *programIndex = stolenBegin;
+
+        RETURN true;
+    }
+
+    RETURN false;
+}
+
+static void RunBatchProgram (BatchProgram *program, ExecutionOptions *options) {
+    PushLog (2);
+
+    custom_assert (program,        pointer_is_null, (void) 0);
+    custom_assert (program->image, pointer_is_null, (void) 0);
+    custom_assert (options,        pointer_is_null, (void) 0);
+
+    sf::Clock programClock;
+
+    BatchImage        *image     = program->image;
+    ProcessorErrorCode errorCode = LoadBatchImage (image, options);
+
+    if (errorCode == NO_PROCESSOR_ERRORS) {
+        SPU spu = {
+            .io = &program->io,
+        };
+
+        errorCode = RunProgramImage (&spu, &image->image);
+
+        program->executedInstructions = spu.executedInstructions;
+        program->instructionsCounted  = image->image.engine != JIT_ENGINE;
+    }
+
+    // program has not been started
+    if (errorCode != NO_PROCESSOR_ERRORS) {
+        program->io.status = errorCode;
+    }
+
+    program->wallTime = (double) programClock.getElapsedTime ().asMicroseconds () / 1000;
+
+    RETURN;
+}
+
+// Programs of the batch usually share a few binaries run with different inputs
+static BatchImage *FindBatchImage (BatchRunner *runner, char *binaryPath) {
+    PushLog (3);
+
+    for (size_t imageIndex = 0; imageIndex < runner->imagesCount; imageIndex++) {
+        if (!strcmp (runner->images [imageIndex].binaryPath, binaryPath)) {
+            RETURN runner->images + imageIndex;
+        }
+    }
+
+    BatchImage *image = runner->images + runner->imagesCount++;
+    image->binaryPath = binaryPath;
+
+    RETURN image;
+}
+
+// First worker loads the image, the others wait for it. Failed load is reported once
+static ProcessorErrorCode LoadBatchImage (BatchImage *image, ExecutionOptions *options) {
+    PushLog (3);
+
+    image->mutex.lock ();
+
+    if (!image->isLoaded) {
+        image->isLoaded = true;
+
+        if (!MapFile (&image->binary, image->binaryPath)) {
+            PrintErrorMessage (INPUT_FILE_ERROR, "Error occuried while mapping binary", image->binaryPath, NULL, -1);
+
+            image->loadStatus = INPUT_FILE_ERROR;
+        } else {
+            image->loadStatus = LoadProgramImage (&image->image, &image->binary, options);
+        }
+    }
+
+    ProcessorErrorCode loadStatus = image->loadStatus;
+
+    image->mutex.unlock ();
+
+    RETURN loadStatus;
+}
+
+static ProcessorErrorCode WriteBatchReport (BatchRunner *runner, const char *reportFilename, double wallTime) {
+    PushLog (2);
+
+    custom_assert (runner,         pointer_is_null, NO_BUFFER);
+    custom_assert (reportFilename, pointer_is_null, OUTPUT_FILE_ERROR);
+
+    FILE *report = fopen (reportFilename, "w");
+
+    if (!report) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while opening report file");
+    }
+
+    fprintf (report, "{\n    \"threads\": %lu,\n    \"images\": %lu,\n    \"wallTimeMs\": %.3lf,\n    \"programs\": [\n",
+                runner->workersCount, runner->imagesCount, wallTime);
+
+    for (size_t programIndex = 0; programIndex < runner->programsCount; programIndex++) {
+        BatchProgram      *program = runner->programs + programIndex;
+        ProcessorErrorCode status  = program->io.status;
+        bool               isError = status != PROCESSOR_HALT && status != BUFFER_ENDED;
+
+        fprintf (report, "        {\"binary\": ");
+        WriteReportString (report, program->binaryPath);
+
+        fprintf (report, ", \"status\": \"%s\", \"exitCode\": %d, ", GetStatusName (status), isError ? (int) status : 0);
+
+        if (program->instructionsCounted) {
+            fprintf (report, "\"instructions\": %lu, ", program->executedInstructions);
+        } else {
+            fprintf (report, "\"instructions\": null, ");
+        }
+
+        fprintf (report, "\"wallTimeMs\": %.3lf, \"output\": [", program->wallTime);
+
+        for (size_t valueIndex = 0; valueIndex < program->io.output.currentIndex; valueIndex++) {
+            if (valueIndex > 0) {
+                fprintf (report, ", ");
+            }
+
+            WriteReportValue (report, program->io.output.data [valueIndex]);
+        }
+
+        fprintf (report, "]}%s\n", programIndex + 1 < runner->programsCount ? "," : "");
+    }
+
+    fprintf (report, "    ]\n}\n");
+
+    if (fclose (report) != 0) {
+        ProgramErrorCheck (OUTPUT_FILE_ERROR, "Error occuried while writing report file");
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static void DestroyBatch (BatchRunner *runner) {
+    PushLog (3);
+
+    custom_assert (runner, pointer_is_null, (void) 0);
+
+    if (runner->programs) {
+        for (size_t programIndex = 0; programIndex < runner->programsCount; programIndex++) {
+            DestroyBuffer (&runner->programs [programIndex].io.input);
+            DestroyBuffer (&runner->programs [programIndex].io.output);
+        }
+    }
+
+    if (runner->images) {
+        for (size_t imageIndex = 0; imageIndex < runner->imagesCount; imageIndex++) {
+            DestroyProgramImage (&runner->images [imageIndex].image);
+            UnmapFile           (&runner->images [imageIndex].binary);
+        }
+    }
+
+    free (runner->programs);
+    delete [] runner->images;
+    delete [] runner->queues;
+
+    runner->programs = NULL;
+    runner->images   = NULL;
+    runner->queues   = NULL;
+
+    RETURN;
+}
+
+// Program stops with hlt or at the end of the bytecode. Everything else is an error
+static const char *GetStatusName (ProcessorErrorCode status) {
+    if (status == PROCESSOR_HALT) {
+        return "halt";
+    } else if (status == BUFFER_ENDED) {
+        return "end";
+    }
+
+    return "error";
+}
+
+static void WriteReportString (FILE *report, const char *string) {
+    PushLog (4);
+
+    fputc ('"', report);
+
+    for (const char *symbol = string; *symbol; symbol++) {
+        if (*symbol == '"' || *symbol == '\\') {
+            fprintf (report, "\\%c", *symbol);
+        } else if ((unsigned char) *symbol < ' ') {
+            fprintf (report, "\\u%04x", (unsigned char) *symbol);
+        } else {
+            fputc (*symbol, report);
+        }
+    }
+
+    fputc ('"', report);
+
+    RETURN;
+}
+
+// JSON has no infinities and NaN
+static void WriteReportValue (FILE *report, elem_t value) {
+    PushLog (4);
+
+    if (isfinite (value)) {
+        fprintf (report, "%.17lg", value);
+    } else {
+        fprintf (report, "null");
+    }
+
+    RETURN;
+}
@@ -0,0 +1,53 @@
+#include <stddef.h>
+
+#include "BytecodeVerifier.h"
+#include "CommonModules.h"
+#include "CustomAssert.h"
+#include "InstructionDecoder.h"
+#include "Logger.h"
+#include "MessageHandler.h"
+#include "SPU.h"
+
+static bool VerifyMemory (DecodedInstruction *instruction);
+
+bool VerifyInstruction (DecodedInstruction *instruction, size_t bytecodeSize) {
+    PushLog (3);
+
+    custom_assert (instruction, pointer_is_null, false);
+
+    unsigned char arguments = instruction->commandCode.arguments;
+
+    if ((arguments & REGISTER_ARGUMENT) && instruction->registerIndex >= REGISTER_COUNT) {
+        RETURN false;
+    }
+
+    switch (instruction->instruction->flow) {
+        case JUMP_FLOW:
+        case CONDITIONAL_JUMP_FLOW:
+        case CALL_FLOW:
+        case SPAWN_FLOW:
+            RETURN arguments == IMMED_ARGUMENT && instruction->immedArgument >= 0 &&
+                        instruction->immedArgument < (elem_t) bytecodeSize;
+
+        // return address is known only at runtime
+        case RETURN_FLOW:
+            RETURN false;
+
+        case LINEAR_FLOW:
+        case HALT_FLOW:
+        default:
+            RETURN !(arguments & MEMORY_ARGUMENT) || VerifyMemory (instruction);
+    }
+}
+
+static bool VerifyMemory (DecodedInstruction *instruction) {
+    PushLog (3);
+
+    if (instruction->commandCode.arguments != (IMMED_ARGUMENT | MEMORY_ARGUMENT)) {
+        RETURN false;
+    }
+
+    elem_t address = instruction->immedArgument;
+
+    RETURN address >= 0 && address < (elem_t) (RAM_SIZE + VRAM_SIZE);
+}
@@ -18,6 +18,7 @@
 static sf::RectangleShape *memoryCells = NULL;
 
 static sf::Mutex updateMutex = {};
+static sf::Mutex coresMutex  = {};     // cell color is read from three ram cells, which other cores may write at the same time
 
 ProcessorErrorCode RenderLoop (sf::RenderWindow* window, SPU *spu, sf::Mutex *workMutex) {
     PushLog (2);
@@ -109,6 +110,10 @@ ProcessorErrorCode UpdateGraphics (SPU *spu, size_t ramAddress) {
 
     size_t cellIndex = ramAddress / COLOR_CHANNELS;
 
+    if (spu->machine) {
+        coresMutex.lock ();
+    }
+
     sf::Color color ((sf::Uint8) spu->ram [cellIndex * COLOR_CHANNELS], (sf::Uint8) spu->ram [cellIndex * COLOR_CHANNELS + 1],
                          (sf::Uint8) spu->ram [cellIndex * COLOR_CHANNELS + 2]);
 
@@ -116,5 +121,9 @@ ProcessorErrorCode UpdateGraphics (SPU *spu, size_t ramAddress) {
     memoryCells [cellIndex].setFillColor (color);
     //updateMutex.unlock ();
 
+    if (spu->machine) {
+        coresMutex.unlock ();
+    }
+
     RETURN NO_PROCESSOR_ERRORS;
 }
@@ -0,0 +1,427 @@
+#include <limits.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include "InstructionDecoder.h"
+#include "Buffer.h"
+#include "BytecodeVerifier.h"
+#include "CommonModules.h"
+#include "CustomAssert.h"
+#include "InstructionFusion.h"
+#include "Logger.h"
+#include "MessageHandler.h"
+#include "SPU.h"
+#include "DSLFunctions.h"
+
+static ProcessorErrorCode DecodeBlockLocked   (DecodedProgram *program, size_t address, DecodedInstruction **instruction);
+static ProcessorErrorCode PrepareBlock        (DecodedProgram *program, DecodedInstruction *instructions, size_t instructionsCount, bool verify);
+static ProcessorErrorCode AddInstructionSlots (DecodedProgram *program, DecodedInstruction *instructions, size_t instructionsCount);
+static void               InsertInstruction   (InstructionSlots *slots, DecodedInstruction *instruction);
+static bool               IsInsideInstruction (DecodedProgram *program, size_t address);
+static bool               ScanInstructionStarts (DecodedProgram *program, size_t address);
+
+ProcessorErrorCode InitDecodedProgram (DecodedProgram *program, FileBuffer *bytecode, DecodingOptions *options) {
+    PushLog (2);
+
+    custom_assert (program,          pointer_is_null, NO_BUFFER);
+    custom_assert (bytecode,         pointer_is_null, NO_BUFFER);
+    custom_assert (bytecode->buffer, pointer_is_null, NO_BUFFER);
+    custom_assert (options,          pointer_is_null, NO_BUFFER);
+
+    program->bytecode          = *bytecode;
+    program->bytecodeSize      = (size_t) bytecode->buffer_size;
+    program->options           = *options;
+    program->instructionsCount = 0;
+    program->blocks            = {0, 0, NULL};
+
+    // Sentinel instruction lets execution loops detect the end of the bytecode without bounds checks
+    program->programEnd         = {};
+    program->programEnd.address = program->bytecodeSize;
+
+    if (options->bindLabels) {
+        ProcessorErrorCode errorCode = options->bindLabels (&program->programEnd, 0);
+        ProgramErrorCheck (errorCode, "Error occuried while binding labels to the program end");
+    }
+
+    program->slots = (InstructionSlots *) calloc (1, sizeof (InstructionSlots));
+
+    if (program->slots) {
+        program->slots->slots      = (DecodedInstruction **) calloc (MIN_INSTRUCTION_SLOTS, sizeof (DecodedInstruction *));
+        program->slots->slotsCount = MIN_INSTRUCTION_SLOTS;
+    }
+
+    if (!program->slots || !program->slots->slots) {
+        free (program->slots);
+        program->slots = NULL;
+
+        ProgramErrorCheck (NO_BUFFER, "Error occuried while allocating instruction slots");
+    }
+
+    pthread_mutex_init (&program->mutex, NULL);
+
+    InsertInstruction (program->slots, &program->programEnd);
+    program->instructionsCount = 1;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode DestroyDecodedProgram (DecodedProgram *program) {
+    PushLog (3);
+
+    custom_assert (program, pointer_is_null, NO_BUFFER);
+
+    // program has not been initialized
+    if (!program->slots) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    for (size_t blockIndex = 0; blockIndex < program->blocks.currentIndex; blockIndex++) {
+        free (program->blocks.data [blockIndex]);
+    }
+
+    for (InstructionSlots *slots = program->slots; slots;) {
+        InstructionSlots *previous = slots->previous;
+
+        free (slots->slots);
+        free (slots);
+
+        slots = previous;
+    }
+
+    DestroyBuffer (&program->blocks);
+    free (program->instructionStarts);
+    pthread_mutex_destroy (&program->mutex);
+
+    program->bytecode          = {};
+    program->bytecodeSize      = 0;
+    program->slots             = NULL;
+    program->instructionsCount = 0;
+    program->blocks            = {0, 0, NULL};
+    program->instructionStarts = NULL;
+    program->startsCapacity    = 0;
+    program->startsEnd         = 0;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+void PrintDecodingStatistics (DecodedProgram *program) {
+    PushLog (2);
+
+    custom_assert (program, pointer_is_null, (void) 0);
+
+    // engine does not decode the program
+    if (!program->slots) {
+        RETURN;
+    }
+
+    char message [MAX_MESSAGE_LENGTH] = "";
+
+    if (program->options.verify) {
+        // sentinel of the program end is not counted
+        snprintf (message, MAX_MESSAGE_LENGTH, "Instructions verified: %lu of %lu",
+                    program->verifiedCount, program->instructionsCount - 1);
+        PrintInfoMessage (message, NULL);
+    }
+
+    if (program->options.fuse) {
+        PrintFusionStatistics (program->fusedCounts);
+    }
+
+    RETURN;
+}
+
+ProcessorErrorCode DecodeBlock (DecodedProgram *program, size_t address, DecodedInstruction **instruction) {
+    PushLog (3);
+
+    custom_assert (program,        pointer_is_null, NO_BUFFER);
+    custom_assert (program->slots, pointer_is_null, NO_BUFFER);
+    custom_assert (instruction,    pointer_is_null, NO_BUFFER);
+
+    pthread_mutex_lock (&program->mutex);
+
+    ProcessorErrorCode errorCode = DecodeBlockLocked (program, address, instruction);
+
+    pthread_mutex_unlock (&program->mutex);
+
+    RETURN errorCode;
+}
+
+// Block ends with control flow instruction, before decoded code or before instruction that can not be decoded.
+// Such instruction is reported only when execution reaches it
+static ProcessorErrorCode DecodeBlockLocked (DecodedProgram *program, size_t address, DecodedInstruction **instruction) {
+    PushLog (3);
+
+    // another processor may have decoded it while this one was waiting for the lock
+    *instruction = FindDecodedInstruction (program, address);
+
+    if (*instruction) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    if (address > program->bytecodeSize) {
+        ProgramErrorCheck (WRONG_ADDRESS, "Address is out of the bytecode");
+    }
+
+    if (IsInsideInstruction (program, address)) {
+        ProgramErrorCheck (WRONG_ADDRESS, "Jump to the middle of an instruction");
+    }
+
+    // If the bytecode before the block can not be decoded, its start is unknown and the block is left unverified
+    bool isStartKnown = address < program->bytecodeSize && ScanInstructionStarts (program, address);
+
+    if (isStartKnown && !(program->instructionStarts [address / CHAR_BIT] & (1 << (address % CHAR_BIT)))) {
+        ProgramErrorCheck (WRONG_ADDRESS, "Jump to the middle of an instruction");
+    }
+
+    bool verify = program->options.verify && isStartKnown;
+
+    DecodedInstruction decodedInstructions [DECODED_BLOCK_LENGTH] = {};
+    size_t instructionsCount = 0;
+    size_t blockEnd          = address;
+
+    SPU decoder = {
+        .bytecode = program->bytecode,
+        .ip       = address,
+    };
+
+    while (instructionsCount < DECODED_BLOCK_LENGTH) {
+        DecodedInstruction *decodedInstruction = decodedInstructions + instructionsCount;
+        ProcessorErrorCode  errorCode          = DecodeInstruction (&decoder, decodedInstruction);
+
+        if (errorCode != NO_PROCESSOR_ERRORS && instructionsCount == 0) {
+            ProgramErrorCheck (errorCode, "Error occuried while decoding bytecode");
+        }
+
+        if (errorCode != NO_PROCESSOR_ERRORS) {
+            break;
+        }
+
+        instructionsCount++;
+        blockEnd = decoder.ip;
+
+        if (decodedInstruction->instruction->flow != LINEAR_FLOW || FindDecodedInstruction (program, blockEnd)) {
+            break;
+        }
+    }
+
+    // one more instruction is the sentinel
+    DecodedInstruction *block = (DecodedInstruction *) calloc (instructionsCount + 1, sizeof (DecodedInstruction));
+
+    if (!block || WriteDataToBuffer (&program->blocks, &block, 1) != NO_PROCESSOR_ERRORS) {
+        free (block);
+        ProgramErrorCheck (NO_BUFFER, "Error occuried while allocating decoded block");
+    }
+
+    for (size_t instructionIndex = 0; instructionIndex < instructionsCount; instructionIndex++) {
+        block [instructionIndex] = decodedInstructions [instructionIndex];
+    }
+
+    block [instructionsCount]         = {};
+    block [instructionsCount].address = blockEnd;
+
+    ProcessorErrorCode errorCode = PrepareBlock (program, block, instructionsCount, verify);
+
+    if (errorCode == NO_PROCESSOR_ERRORS) {
+        errorCode = AddInstructionSlots (program, block, instructionsCount);
+    }
+
+    // block stays in the list and is freed with the program
+    ProgramErrorCheck (errorCode, "Error occuried while preparing decoded block");
+
+    *instruction = block;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode PrepareBlock (DecodedProgram *program, DecodedInstruction *instructions, size_t instructionsCount, bool verify) {
+    PushLog (3);
+
+    for (size_t instructionIndex = 0; verify && instructionIndex < instructionsCount; instructionIndex++) {
+        instructions [instructionIndex].verified = VerifyInstruction (instructions + instructionIndex, program->bytecodeSize);
+
+        if (instructions [instructionIndex].verified) {
+            program->verifiedCount++;
+        }
+    }
+
+    if (program->options.fuse) {
+        FuseBlock (instructions, instructionsCount, program->fusedCounts);
+    }
+
+    if (program->options.bindLabels) {
+        RETURN program->options.bindLabels (instructions, instructionsCount);
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Instructions are published after they are prepared, so processors never see a half-prepared block
+static ProcessorErrorCode AddInstructionSlots (DecodedProgram *program, DecodedInstruction *instructions, size_t instructionsCount) {
+    PushLog (3);
+
+    InstructionSlots *slots = program->slots;
+    size_t newCount         = program->instructionsCount + instructionsCount;
+
+    if (newCount * 2 > slots->slotsCount) {
+        InstructionSlots *newSlots = (InstructionSlots *) calloc (1, sizeof (InstructionSlots));
+        size_t slotsCount          = slots->slotsCount;
+
+        while (newCount * 2 > slotsCount) {
+            slotsCount *= 2;
+        }
+
+        if (newSlots) {
+            newSlots->slots      = (DecodedInstruction **) calloc (slotsCount, sizeof (DecodedInstruction *));
+            newSlots->slotsCount = slotsCount;
+            newSlots->previous   = slots;
+        }
+
+        if (!newSlots || !newSlots->slots) {
+            free (newSlots);
+            RETURN NO_BUFFER;
+        }
+
+        for (size_t slot = 0; slot < slots->slotsCount; slot++) {
+            if (slots->slots [slot]) {
+                InsertInstruction (newSlots, slots->slots [slot]);
+            }
+        }
+
+        __atomic_store_n (&program->slots, newSlots, __ATOMIC_RELEASE);
+        slots = newSlots;
+    }
+
+    for (size_t instructionIndex = 0; instructionIndex < instructionsCount; instructionIndex++) {
+        InsertInstruction (slots, instructions + instructionIndex);
+    }
+
+    program->instructionsCount = newCount;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static void InsertInstruction (InstructionSlots *slots, DecodedInstruction *instruction) {
+    PushLog (4);
+
+    size_t slot = GetAddressSlot (instruction->address, slots->slotsCount);
+
+    while (slots->slots [slot]) {
+        slot = (slot + 1) & (slots->slotsCount - 1);
+    }
+
+    __atomic_store_n (slots->slots + slot, instruction, __ATOMIC_RELEASE);
+
+    RETURN;
+}
+
+// Decodes the bytecode from startsEnd up to address, marking instruction beginnings. Every instruction is
+// decoded here once, so the work depends on the highest block start, not on the number of blocks.
+// Returns false if address can not be reached, as the bytecode before it can not be decoded
+static bool ScanInstructionStarts (DecodedProgram *program, size_t address) {
+    PushLog (3);
+
+    SPU decoder = {
+        .bytecode = program->bytecode,
+        .ip       = program->startsEnd,
+    };
+
+    while (decoder.ip <= address) {
+        size_t requiredCapacity = decoder.ip / CHAR_BIT + 1;
+
+        if (requiredCapacity > program->startsCapacity) {
+            size_t startsCapacity = program->startsCapacity > 0 ? program->startsCapacity * 2 : MIN_INSTRUCTION_SLOTS;
+
+            while (startsCapacity < requiredCapacity) {
+                startsCapacity *= 2;
+            }
+
+            unsigned char *instructionStarts = (unsigned char *) realloc (program->instructionStarts, startsCapacity);
+
+            if (!instructionStarts) {
+                RETURN false;
+            }
+
+            for (size_t byteIndex = program->startsCapacity; byteIndex < startsCapacity; byteIndex++) {
+                instructionStarts [byteIndex] = 0;
+            }
+
+            program->instructionStarts = instructionStarts;
+            program->startsCapacity    = startsCapacity;
+        }
+
+        size_t             instructionStart   = decoder.ip;
+        DecodedInstruction decodedInstruction = {};
+
+        if (DecodeInstruction (&decoder, &decodedInstruction) != NO_PROCESSOR_ERRORS) {
+            RETURN false;
+        }
+
+        program->instructionStarts [instructionStart / CHAR_BIT] |= (unsigned char) (1 << (instructionStart % CHAR_BIT));
+        program->startsEnd = decoder.ip;
+    }
+
+    RETURN true;
+}
+
+// Used when instruction starts are unknown: only decoded instructions are checked
+static bool IsInsideInstruction (DecodedProgram *program, size_t address) {
+    PushLog (4);
+
+    for (size_t distance = 1; distance < MAX_ENCODED_INSTRUCTION_SIZE && distance <= address; distance++) {
+        DecodedInstruction *instruction = FindDecodedInstruction (program, address - distance);
+
+        // instruction is followed by the next one or by the sentinel, both keep its end
+        if (instruction && (instruction + 1)->address > address) {
+            RETURN true;
+        }
+    }
+
+    RETURN false;
+}
+
+ProcessorErrorCode DecodeInstruction (SPU *spu, DecodedInstruction *decodedInstruction) {
+    PushLog (3);
+
+    custom_assert (spu,                pointer_is_null, NO_PROCESSOR);
+    custom_assert (decodedInstruction, pointer_is_null, NO_BUFFER);
+
+    decodedInstruction->address = spu->ip;
+
+    ReadData (spu, &decodedInstruction->commandCode, CommandCode);
+
+    decodedInstruction->instruction = FindInstructionByOpcode (decodedInstruction->commandCode.opcode);
+
+    if (!decodedInstruction->instruction) {
+        ProgramErrorCheck (WRONG_INSTRUCTION, "Wrong instruction readed");
+    }
+
+    unsigned char arguments = decodedInstruction->commandCode.arguments;
+
+    if (!IsPermittedArguments (decodedInstruction->instruction->commandCode.arguments, arguments)) {
+        ProgramErrorCheck (WRONG_INSTRUCTION, "Instruction does not takes this set of arguments");
+    }
+
+    if ((arguments & REGISTER_ARGUMENT) && spu->ip + sizeof (unsigned char) > (size_t) spu->bytecode.buffer_size) {
+        ProgramErrorCheck (BUFFER_ENDED, "Instruction arguments are out of the bytecode");
+    }
+
+    if (arguments & REGISTER_ARGUMENT) {
+        ReadData (spu, &decodedInstruction->registerIndex, unsigned char);
+
+        if (decodedInstruction->registerIndex >= REGISTER_COUNT) {
+            ProgramErrorCheck (WRONG_INSTRUCTION, "Wrong register index");
+        }
+    }
+
+    if (arguments & IMMED_ARGUMENT) {
+        ProcessorErrorCode errorCode = ReadImmediate (spu, &decodedInstruction->immedArgument);
+
+        if (errorCode != NO_PROCESSOR_ERRORS) {
+            ProgramErrorCheck (errorCode, "Wrong immediate argument");
+        }
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
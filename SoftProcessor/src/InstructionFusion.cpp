@@ -0,0 +1,203 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "InstructionFusion.h"
+#include "CommonModules.h"
+#include "CustomAssert.h"
+#include "GraphicsProvider.h"
+#include "InstructionDecoder.h"
+#include "Logger.h"
+#include "MessageHandler.h"
+#include "SecureStack/SecureStack.h"
+#include "SPU.h"
+#include "Stack/Stack.h"
+#include "Stack/StackPrintf.h"
+#include "DSLFunctions.h"
+
+const size_t        MAX_PATTERN_LENGTH = 3;
+const unsigned char ANY_ARGUMENTS_MODE = 0xff;  // bitmask of accepted arguments modes, bit n stands for mode n
+
+struct PatternElement {
+    const char   *instructionName;
+    unsigned char argumentsModes;
+};
+
+struct FusionPattern {
+    const char    *name;
+    size_t         length;
+    PatternElement elements [MAX_PATTERN_LENGTH];
+    fusedHandler_t handler;
+};
+
+static bool MatchPattern (DecodedInstruction *instructions, size_t instructionsCount, size_t instructionIndex,
+                            const FusionPattern *pattern);
+
+static ProcessorErrorCode PushPopHandler (SPU *spu, DecodedInstruction *instructions);
+
+#define ResolveFusedArgument(spu, instruction, argument)                                            \
+            do {                                                                                    \
+                argument = ResolveDecodedArgument (spu, instruction);                               \
+                if (!argument) {                                                                    \
+                    ProgramErrorCheck (TOO_FEW_ARGUMENTS, "Wrong memory address access attempt");   \
+                }                                                                                   \
+            } while (0)
+
+// push a; push b; op  -> a op b
+// push b; op          -> stack top op b
+#define ARITHMETIC_HANDLERS_(NAME, OPERATOR)                                                        \
+            static ProcessorErrorCode PushPush##NAME##Handler (SPU *spu, DecodedInstruction *instructions) { \
+                PushLog (3);                                                                        \
+                elem_t *argument = NULL;                                                            \
+                ResolveFusedArgument (spu, instructions, argument);                                 \
+                elem_t value1 = *argument;                                                          \
+                ResolveFusedArgument (spu, instructions + 1, argument);                             \
+                elem_t value2 = *argument;                                                          \
+                PushValue (spu, value1 OPERATOR value2);                                            \
+                RETURN NO_PROCESSOR_ERRORS;                                                         \
+            }                                                                                       \
+                                                                                                    \
+            static ProcessorErrorCode Push##NAME##Handler (SPU *spu, DecodedInstruction *instructions) { \
+                PushLog (3);                                                                        \
+                elem_t *argument = NULL;                                                            \
+                ResolveFusedArgument (spu, instructions, argument);                                 \
+                elem_t value2 = *argument;                                                          \
+                elem_t value1 = NAN;                                                                \
+                PopValue  (spu, &value1);                                                           \
+                PushValue (spu, value1 OPERATOR value2);                                            \
+                RETURN NO_PROCESSOR_ERRORS;                                                         \
+            }
+
+ARITHMETIC_HANDLERS_ (Add, +)
+ARITHMETIC_HANDLERS_ (Sub, -)
+ARITHMETIC_HANDLERS_ (Mul, *)
+ARITHMETIC_HANDLERS_ (Div, /)
+
+#undef ARITHMETIC_HANDLERS_
+
+// Longer patterns go first, as the first matching pattern is applied
+static const FusionPattern FusionPatterns [] = {
+    {"push, push, add", 3, {{"push", ANY_ARGUMENTS_MODE}, {"push", ANY_ARGUMENTS_MODE}, {"add", ANY_ARGUMENTS_MODE}}, PushPushAddHandler},
+    {"push, push, sub", 3, {{"push", ANY_ARGUMENTS_MODE}, {"push", ANY_ARGUMENTS_MODE}, {"sub", ANY_ARGUMENTS_MODE}}, PushPushSubHandler},
+    {"push, push, mul", 3, {{"push", ANY_ARGUMENTS_MODE}, {"push", ANY_ARGUMENTS_MODE}, {"mul", ANY_ARGUMENTS_MODE}}, PushPushMulHandler},
+    {"push, push, div", 3, {{"push", ANY_ARGUMENTS_MODE}, {"push", ANY_ARGUMENTS_MODE}, {"div", ANY_ARGUMENTS_MODE}}, PushPushDivHandler},
+    {"push, pop",       2, {{"push", ANY_ARGUMENTS_MODE}, {"pop",  ANY_ARGUMENTS_MODE}},                             PushPopHandler},
+    {"push, add",       2, {{"push", ANY_ARGUMENTS_MODE}, {"add",  ANY_ARGUMENTS_MODE}},                             PushAddHandler},
+    {"push, sub",       2, {{"push", ANY_ARGUMENTS_MODE}, {"sub",  ANY_ARGUMENTS_MODE}},                             PushSubHandler},
+    {"push, mul",       2, {{"push", ANY_ARGUMENTS_MODE}, {"mul",  ANY_ARGUMENTS_MODE}},                             PushMulHandler},
+    {"push, div",       2, {{"push", ANY_ARGUMENTS_MODE}, {"div",  ANY_ARGUMENTS_MODE}},                             PushDivHandler},
+};
+
+static_assert (sizeof (FusionPatterns) / sizeof (FusionPattern) == FUSION_PATTERNS_COUNT, "FUSION_PATTERNS_COUNT has to match the patterns table");
+
+// First matching pattern is applied, then search continues after the fused sequence
+size_t FuseBlock (DecodedInstruction *instructions, size_t instructionsCount, size_t *fusedCounts) {
+    PushLog (2);
+
+    custom_assert (instructions, pointer_is_null, 0);
+    custom_assert (fusedCounts,  pointer_is_null, 0);
+
+    size_t totalCount = 0;
+
+    for (size_t instructionIndex = 0; instructionIndex < instructionsCount;) {
+        size_t fusedLength = 1;
+
+        for (size_t patternIndex = 0; patternIndex < FUSION_PATTERNS_COUNT; patternIndex++) {
+            const FusionPattern *pattern = FusionPatterns + patternIndex;
+
+            if (!MatchPattern (instructions, instructionsCount, instructionIndex, pattern)) {
+                continue;
+            }
+
+            instructions [instructionIndex].fusedHandler = pattern->handler;
+            instructions [instructionIndex].fusedLength  = pattern->length;
+
+            fusedLength = pattern->length;
+            totalCount++;
+
+            // blocks of a shared program are decoded by several processors
+            __atomic_add_fetch (fusedCounts + patternIndex, 1, __ATOMIC_RELAXED);
+
+            break;
+        }
+
+        instructionIndex += fusedLength;
+    }
+
+    RETURN totalCount;
+}
+
+void PrintFusionStatistics (const size_t *fusedCounts) {
+    PushLog (2);
+
+    custom_assert (fusedCounts, pointer_is_null, (void) 0);
+
+    size_t totalCount = 0;
+
+    for (size_t patternIndex = 0; patternIndex < FUSION_PATTERNS_COUNT; patternIndex++) {
+        totalCount += __atomic_load_n (fusedCounts + patternIndex, __ATOMIC_RELAXED);
+    }
+
+    char message [MAX_MESSAGE_LENGTH] = "";
+
+    snprintf (message, MAX_MESSAGE_LENGTH, "Instructions fused: %lu", totalCount);
+    PrintInfoMessage (message, NULL);
+
+    for (size_t patternIndex = 0; patternIndex < FUSION_PATTERNS_COUNT; patternIndex++) {
+        size_t fusedCount = __atomic_load_n (fusedCounts + patternIndex, __ATOMIC_RELAXED);
+
+        if (fusedCount == 0) {
+            continue;
+        }
+
+        snprintf (message, MAX_MESSAGE_LENGTH, "    %-16s %lu", FusionPatterns [patternIndex].name, fusedCount);
+        PrintInfoMessage (message, NULL);
+    }
+
+    RETURN;
+}
+
+static bool MatchPattern (DecodedInstruction *instructions, size_t instructionsCount, size_t instructionIndex,
+                            const FusionPattern *pattern) {
+    PushLog (4);
+
+    if (instructionIndex + pattern->length > instructionsCount) {
+        RETURN false;
+    }
+
+    for (size_t elementIndex = 0; elementIndex < pattern->length; elementIndex++) {
+        DecodedInstruction   *instruction = instructions + instructionIndex + elementIndex;
+        const PatternElement *element     = pattern->elements + elementIndex;
+
+        if (strcmp (instruction->instruction->instructionName, element->instructionName) != 0) {
+            RETURN false;
+        }
+
+        if (!(element->argumentsModes & (1 << instruction->commandCode.arguments))) {
+            RETURN false;
+        }
+    }
+
+    RETURN true;
+}
+
+// push a; pop b -> b = a
+static ProcessorErrorCode PushPopHandler (SPU *spu, DecodedInstruction *instructions) {
+    PushLog (3);
+
+    elem_t *argument = NULL;
+
+    ResolveFusedArgument (spu, instructions, argument);
+    elem_t value = *argument;
+
+    ResolveFusedArgument (spu, instructions + 1, argument);
+    *argument = value;
+
+    if (instructions [1].commandCode.arguments & MEMORY_ARGUMENT) {
+        ProgramErrorCheck (UpdateGraphics (spu, (size_t) (argument - spu->ram)), "Error occuried while updating graphics");
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
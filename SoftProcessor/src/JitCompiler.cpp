@@ -0,0 +1,1266 @@
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "JitCompiler.h"
+#include "Buffer.h"
+#include "CommonModules.h"
+#include "CustomAssert.h"
+#include "GraphicsProvider.h"
+#include "InstructionDecoder.h"
+#include "Logger.h"
+#include "MessageHandler.h"
+#include "SecureStack/SecureStack.h"
+#include "SPU.h"
+#include "Stack/Stack.h"
+#include "DSLFunctions.h"
+
+#if JIT_SUPPORTED
+
+struct JitFixup {
+    size_t              position;       // offset of rel32 field
+    DecodedInstruction *target;         // instruction of the unit it points to
+};
+
+// Address of the failed instruction is stored by code emitted after the unit, then error stub stores the status
+struct JitErrorExit {
+    uint32_t position;                  // offset of rel32 field of the jump to the exit
+    uint32_t address;
+    uint32_t stubOffset;
+};
+
+const size_t MAX_ERROR_EXITS = (DECODED_BLOCK_LENGTH + 1) * 8;
+const size_t ERROR_EXIT_SIZE = 13;      // mov qword [rbx + ip], address; jmp stub
+
+struct JitCompiler {
+    DecodedProgram *program;
+
+    unsigned char  *code;               // chunk the unit is written to
+    size_t          codeSize;
+    size_t          codeCapacity;
+
+    DecodedInstruction *unitStart;
+    size_t              unitLength;     // instructions before the unit end, which is a sentinel or compiled instruction
+    size_t              nativeOffsets [DECODED_BLOCK_LENGTH + 1];   // unit instruction -> offset of its native code
+    Buffer <JitFixup>   fixups;
+    JitErrorExit        errorExits [MAX_ERROR_EXITS];
+    size_t              errorExitsCount;
+
+    size_t          epilogueOffset;
+    size_t          stackErrorOffset;
+    size_t          memoryErrorOffset;
+    size_t          jumpErrorOffset;
+    size_t          helperErrorOffset;
+
+    DecodedInstruction *currentInstruction;
+};
+
+struct JitTranslation;
+
+typedef ProcessorErrorCode (*jitTranslator_t) (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation);
+
+struct JitTranslation {
+    const char     *instructionName;
+    jitTranslator_t translator;
+
+    unsigned char   sseOpcode;                  // arithmetic instructions
+    double        (*mathFunction) (double);     // instructions computed by libm
+    int             comparison;                 // conditional jumps
+};
+
+const size_t MAX_INSTRUCTION_CODE_SIZE = 512;   // bigger than the longest translation or unit end
+const size_t STUBS_CODE_SIZE           = 256;   // prologue, epilogue and error exits
+
+static_assert (sizeof (ProcessorErrorCode) == sizeof (uint32_t), "Native code stores status as 32-bit value");
+static_assert (sizeof (JitContext) <= INT8_MAX,                  "Native code addresses context fields with 8-bit displacements");
+
+#define CONTEXT_FIELD_(field) ((unsigned char) offsetof (JitContext, field))
+
+static void               EmitStubs          (JitCompiler *compiler);
+static ProcessorErrorCode AddJitChunk        (JitProgram *jitProgram);
+static ProcessorErrorCode CompileJitUnit     (JitProgram *jitProgram, DecodedProgram *decodedProgram, DecodedInstruction *unitStart);
+
+static ProcessorErrorCode InterpretInstruction (SPU *spu, DecodedProgram *decodedProgram, JitContext *context);
+static ProcessorErrorCode GetNativeEntry       (DecodedProgram *decodedProgram, JitProgram *jitProgram, size_t address, const void **entry);
+static const void        *FindNativeEntry      (JitContext *context, size_t address);
+static const void        *LinkNativeEntry      (JitContext *context, size_t address, const void **jumpEntry);
+static ProcessorErrorCode SpillJitContext      (SPU *spu, JitContext *context);
+static ProcessorErrorCode FillJitContext       (SPU *spu, JitContext *context);
+
+template <typename T>
+static ProcessorErrorCode ReserveJitStack (T **stack, size_t *capacity, size_t size);
+
+static ProcessorErrorCode TranslateFallback          (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation);
+static ProcessorErrorCode TranslateHalt              (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation);
+static ProcessorErrorCode TranslatePush              (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation);
+static ProcessorErrorCode TranslatePop               (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation);
+static ProcessorErrorCode TranslateArithmetic        (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation);
+static ProcessorErrorCode TranslateMathFunction      (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation);
+static ProcessorErrorCode TranslateSqrt              (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation);
+static ProcessorErrorCode TranslateFloor             (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation);
+static ProcessorErrorCode TranslateJump              (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation);
+static ProcessorErrorCode TranslateConditionalJump   (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation);
+static ProcessorErrorCode TranslateCall              (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation);
+static ProcessorErrorCode TranslateReturn            (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation);
+
+// Instructions missing here (in, out, sleep) are executed by the interpreter
+static const JitTranslation Translations [] = {
+    {"hlt",   TranslateHalt,            0,    NULL, 0},
+    {"push",  TranslatePush,            0,    NULL, 0},
+    {"pop",   TranslatePop,             0,    NULL, 0},
+    {"add",   TranslateArithmetic,      0x58, NULL, 0},
+    {"sub",   TranslateArithmetic,      0x5c, NULL, 0},
+    {"mul",   TranslateArithmetic,      0x59, NULL, 0},
+    {"div",   TranslateArithmetic,      0x5e, NULL, 0},
+    {"sin",   TranslateMathFunction,    0,    sin,  0},
+    {"cos",   TranslateMathFunction,    0,    cos,  0},
+    {"sqrt",  TranslateSqrt,            0,    NULL, 0},
+    {"floor", TranslateFloor,           0,    NULL, 0},
+    {"jmp",   TranslateJump,            0,    NULL, 0},
+    {"ja",    TranslateConditionalJump, 0,    NULL, GREATER},
+    {"jae",   TranslateConditionalJump, 0,    NULL, GREATER | EQUAL},
+    {"jb",    TranslateConditionalJump, 0,    NULL, LESS},
+    {"jbe",   TranslateConditionalJump, 0,    NULL, LESS | EQUAL},
+    {"je",    TranslateConditionalJump, 0,    NULL, EQUAL},
+    {"jne",   TranslateConditionalJump, 0,    NULL, LESS | GREATER},
+    {"call",  TranslateCall,            0,    NULL, 0},
+    {"ret",   TranslateReturn,          0,    NULL, 0},
+};
+
+static const JitTranslation FallbackTranslation = {"", TranslateFallback, 0, NULL, 0};
+
+struct JitTranslationsTable {
+    const JitTranslation *translations [OPCODES_COUNT] = {};
+};
+
+static JitTranslationsTable CreateTranslationsTable ();
+
+ProcessorErrorCode ExecuteJit (SPU *spu, DecodedProgram *decodedProgram, JitProgram *jitProgram) {
+    PushLog (1);
+
+    custom_assert (spu,                   pointer_is_null, NO_PROCESSOR);
+    custom_assert (decodedProgram,        pointer_is_null, NO_BUFFER);
+    custom_assert (decodedProgram->slots, pointer_is_null, NO_BUFFER);
+    custom_assert (jitProgram,            pointer_is_null, NO_BUFFER);
+    custom_assert (jitProgram->function,  pointer_is_null, NO_BUFFER);
+
+    // stacks are allocated by the first fill
+    JitContext context = {
+        .registers = spu->registerValues,
+        .ram       = spu->ram,
+
+        .decodedProgram = decodedProgram,
+        .jitProgram     = jitProgram,
+
+        .spu             = spu,
+        .frequencySleep  = spu->frequencySleep,
+        .graphicsEnabled = spu->graphicsEnabled,
+    };
+
+    #define FreeDataAndReturn(errorCode)            \
+                do {                                \
+                    free (context.stack);           \
+                    free (context.callStack);       \
+                    RETURN errorCode;               \
+                } while (0)
+
+    ProcessorErrorCode errorCode = FillJitContext (spu, &context);
+
+    if (errorCode != NO_PROCESSOR_ERRORS) {
+        PrintErrorMessage (errorCode, "Error occuried while allocating native code stacks", NULL, NULL, -1);
+        FreeDataAndReturn (errorCode);
+    }
+
+    while (errorCode == NO_PROCESSOR_ERRORS) {
+        const void *entry = NULL;
+
+        // unit is compiled here if native code has stopped before an instruction without code
+        errorCode = GetNativeEntry (decodedProgram, jitProgram, spu->ip, &entry);
+
+        if (errorCode != NO_PROCESSOR_ERRORS) {
+            break;
+        }
+
+        jitProgram->function (&context, entry);
+
+        errorCode = context.status;
+
+        if (errorCode == NO_PROCESSOR_ERRORS) {
+            errorCode = InterpretInstruction (spu, decodedProgram, &context);
+            continue;
+        }
+
+        spu->ip = context.ip;
+
+        // Messages for interpreted instructions are printed by their callbacks
+        if (errorCode == STACK_ERROR) {
+            PrintErrorMessage (errorCode, "Stack error occuried in native code", NULL, NULL, -1);
+        } else if (errorCode == TOO_FEW_ARGUMENTS) {
+            PrintErrorMessage (errorCode, "Wrong memory address access attempt", NULL, NULL, -1);
+        } else if (errorCode == WRONG_ADDRESS) {
+            PrintErrorMessage (errorCode, "Wrong jump address", NULL, NULL, -1);
+        }
+    }
+
+    SpillJitContext (spu, &context);
+
+    FreeDataAndReturn (errorCode);
+
+    #undef FreeDataAndReturn
+}
+
+// Executes instruction at context->ip with its callback, operand and call stacks are moved to spu for that time
+static ProcessorErrorCode InterpretInstruction (SPU *spu, DecodedProgram *decodedProgram, JitContext *context) {
+    PushLog (2);
+
+    custom_assert (spu,            pointer_is_null, NO_PROCESSOR);
+    custom_assert (decodedProgram, pointer_is_null, NO_BUFFER);
+    custom_assert (context,        pointer_is_null, NO_BUFFER);
+
+    DecodedInstruction *instruction = NULL;
+
+    ProcessorErrorCode decodeErrorCode = GetDecodedInstruction (decodedProgram, context->ip, &instruction);
+    ProgramErrorCheck (decodeErrorCode, "Error occuried while decoding interpreted instruction");
+
+    if (!instruction->instruction) {
+        ProgramErrorCheck (WRONG_ADDRESS, "Native code has stopped outside of the program");
+    }
+
+    ProgramErrorCheck (SpillJitContext (spu, context), "Error occuried while moving stacks to processor");
+
+    spu->ip = (instruction + 1)->address;
+
+    elem_t *argument = NULL;
+
+    if (instruction->commandCode.arguments != NO_ARGUMENTS) {
+        argument = ResolveDecodedArgument (spu, instruction);
+
+        if (!argument) {
+            ProgramErrorCheck (TOO_FEW_ARGUMENTS, "Wrong memory address access attempt");
+        }
+    }
+
+    ProcessorErrorCode errorCode = instruction->instruction->callbackFunction (spu, &instruction->commandCode, argument);
+
+    if (errorCode == NO_PROCESSOR_ERRORS && (instruction->commandCode.arguments & MEMORY_ARGUMENT)) {
+        errorCode = UpdateGraphics (spu, (size_t) (argument - spu->ram));
+    }
+
+    ProcessorErrorCode fillErrorCode = FillJitContext (spu, context);
+
+    if (errorCode != NO_PROCESSOR_ERRORS) {
+        RETURN errorCode;
+    }
+
+    ProgramErrorCheck (fillErrorCode, "Error occuried while moving stacks to native code");
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Decodes and compiles code at address if it has not been done yet
+static ProcessorErrorCode GetNativeEntry (DecodedProgram *decodedProgram, JitProgram *jitProgram, size_t address, const void **entry) {
+    PushLog (3);
+
+    DecodedInstruction *instruction = NULL;
+
+    ProcessorErrorCode errorCode = GetDecodedInstruction (decodedProgram, address, &instruction);
+    ProgramErrorCheck (errorCode, "Error occuried while decoding native code entry");
+
+    *entry = __atomic_load_n (&instruction->nativeEntry, __ATOMIC_ACQUIRE);
+
+    if (*entry) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    pthread_mutex_lock (&jitProgram->mutex);
+
+    // another processor may have compiled it while this one was waiting for the lock
+    if (!instruction->nativeEntry) {
+        errorCode = CompileJitUnit (jitProgram, decodedProgram, instruction);
+    }
+
+    *entry = instruction->nativeEntry;
+
+    pthread_mutex_unlock (&jitProgram->mutex);
+
+    ProgramErrorCheck (errorCode, "Error occuried while compiling native code");
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Called by native code for addresses known only at runtime or not compiled yet.
+// Returns NULL and stores the error in context if code can not be found there
+static const void *FindNativeEntry (JitContext *context, size_t address) {
+    PushLog (4);
+
+    const void *entry = NULL;
+
+    ProcessorErrorCode errorCode = GetNativeEntry (context->decodedProgram, context->jitProgram, address, &entry);
+
+    if (errorCode != NO_PROCESSOR_ERRORS) {
+        context->ip     = address;
+        context->status = errorCode;
+
+        RETURN NULL;
+    }
+
+    RETURN entry;
+}
+
+// Static jump remembers the code it has found, so next time it goes there without a call
+static const void *LinkNativeEntry (JitContext *context, size_t address, const void **jumpEntry) {
+    PushLog (4);
+
+    const void *entry = FindNativeEntry (context, address);
+
+    if (entry) {
+        __atomic_store_n (jumpEntry, entry, __ATOMIC_RELEASE);
+    }
+
+    RETURN entry;
+}
+
+static ProcessorErrorCode SpillJitContext (SPU *spu, JitContext *context) {
+    PushLog (3);
+
+    for (size_t stackIndex = 0; stackIndex < context->stackSize; stackIndex++) {
+        if (StackPush_ (&spu->processorStack, context->stack [stackIndex]) != NO_ERRORS) {
+            RETURN STACK_ERROR;
+        }
+    }
+
+    for (size_t stackIndex = 0; stackIndex < context->callStackSize; stackIndex++) {
+        if (StackPush_ (&spu->callStack, (elem_t) context->callStack [stackIndex]) != NO_ERRORS) {
+            RETURN STACK_ERROR;
+        }
+    }
+
+    context->stackSize     = 0;
+    context->callStackSize = 0;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode FillJitContext (SPU *spu, JitContext *context) {
+    PushLog (3);
+
+    size_t stackSize     = (size_t) spu->processorStack.size;
+    size_t callStackSize = (size_t) spu->callStack.size;
+
+    if (ReserveJitStack (&context->stack,     &context->stackCapacity,     stackSize)     != NO_PROCESSOR_ERRORS ||
+        ReserveJitStack (&context->callStack, &context->callStackCapacity, callStackSize) != NO_PROCESSOR_ERRORS) {
+        RETURN NO_BUFFER;
+    }
+
+    for (size_t stackIndex = stackSize; stackIndex > 0; stackIndex--) {
+        if (StackPop_ (&spu->processorStack, context->stack + stackIndex - 1) != NO_ERRORS) {
+            RETURN STACK_ERROR;
+        }
+    }
+
+    for (size_t stackIndex = callStackSize; stackIndex > 0; stackIndex--) {
+        elem_t returnAddress = NAN;
+
+        if (StackPop_ (&spu->callStack, &returnAddress) != NO_ERRORS) {
+            RETURN STACK_ERROR;
+        }
+
+        context->callStack [stackIndex - 1] = (size_t) returnAddress;
+    }
+
+    context->stackSize     = stackSize;
+    context->callStackSize = callStackSize;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Leaves a place for one more value, so native code does not stop at the first push after the fill
+template <typename T>
+static ProcessorErrorCode ReserveJitStack (T **stack, size_t *capacity, size_t size) {
+    PushLog (4);
+
+    size_t newCapacity = *capacity > 0 ? *capacity : JIT_MIN_STACK_CAPACITY;
+
+    while (newCapacity <= size) {
+        newCapacity *= 2;
+    }
+
+    if (newCapacity == *capacity) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    T *newStack = (T *) realloc (*stack, newCapacity * sizeof (T));
+
+    if (!newStack) {
+        RETURN NO_BUFFER;
+    }
+
+    *stack    = newStack;
+    *capacity = newCapacity;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+//-----------------------------------------------------------------------------------------------------------------
+// Code emission
+
+inline void EmitByte (JitCompiler *compiler, unsigned char byte) {
+    compiler->code [compiler->codeSize++] = byte;
+}
+
+// Expands into EmitByte calls, so no temporary array is made for every encoding
+template <typename... Bytes>
+inline void EmitBytes (JitCompiler *compiler, Bytes... bytes) {
+    (EmitByte (compiler, (unsigned char) bytes), ...);
+}
+
+inline void EmitDword (JitCompiler *compiler, uint32_t value) {
+    memcpy (compiler->code + compiler->codeSize, &value, sizeof (value));
+    compiler->codeSize += sizeof (value);
+}
+
+inline void EmitQword (JitCompiler *compiler, uint64_t value) {
+    memcpy (compiler->code + compiler->codeSize, &value, sizeof (value));
+    compiler->codeSize += sizeof (value);
+}
+
+// rel32 field pointing to already emitted code
+inline void EmitRel32 (JitCompiler *compiler, size_t targetOffset) {
+    EmitDword (compiler, (uint32_t) ((int64_t) targetOffset - (int64_t) (compiler->codeSize + sizeof (uint32_t))));
+}
+
+// rel32 field pointing to instruction of the unit, patched after whole unit is emitted
+static ProcessorErrorCode EmitInstructionRel32 (JitCompiler *compiler, DecodedInstruction *target) {
+    PushLog (4);
+
+    JitFixup fixup = {compiler->codeSize, target};
+
+    ProgramErrorCheck (WriteDataToBuffer (&compiler->fixups, &fixup, 1), "Error occuried while adding jump fixup");
+
+    EmitDword (compiler, 0);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// jcc rel32 to already emitted code, condition 0 stands for jmp
+inline void EmitJumpTo (JitCompiler *compiler, unsigned char condition, size_t targetOffset) {
+    if (condition) {
+        EmitBytes (compiler, 0x0f, condition);
+    } else {
+        EmitBytes (compiler, 0xe9);
+    }
+
+    EmitRel32 (compiler, targetOffset);
+}
+
+const unsigned char JB_CONDITION  = 0x82;
+const unsigned char JAE_CONDITION = 0x83;
+const unsigned char JZ_CONDITION  = 0x84;
+const unsigned char JNZ_CONDITION = 0x85;
+
+inline void EmitLoadImmediate (JitCompiler *compiler, unsigned char xmm, elem_t value) {
+    uint64_t bits = 0;
+    memcpy (&bits, &value, sizeof (bits));
+
+    EmitBytes (compiler, 0x48, 0xb8);                                               // mov rax, imm64
+    EmitQword (compiler, bits);
+    EmitBytes (compiler, 0x66, 0x48, 0x0f, 0x6e, (unsigned char) (0xc0 | xmm << 3));    // movq xmm, rax
+}
+
+inline void EmitRegisterAccess (JitCompiler *compiler, unsigned char sseOpcode, unsigned char xmm, unsigned char registerIndex) {
+    EmitBytes (compiler, 0xf2, 0x41, 0x0f, sseOpcode, (unsigned char) (0x85 | xmm << 3));   // op xmm, [r13 + disp32]
+    EmitDword (compiler, (uint32_t) (registerIndex * sizeof (elem_t)));
+}
+
+inline void EmitRamAccess (JitCompiler *compiler, unsigned char sseOpcode, unsigned char xmm) {
+    EmitBytes (compiler, 0xf2, 0x41, 0x0f, sseOpcode, (unsigned char) (0x04 | xmm << 3), 0xc6);   // op xmm, [r14 + rax * 8]
+}
+
+inline void EmitStackAccess (JitCompiler *compiler, unsigned char sseOpcode, unsigned char xmm, int8_t displacement) {
+    EmitBytes (compiler, 0xf2, 0x43, 0x0f, sseOpcode, (unsigned char) (0x44 | xmm << 3), 0xfc, (unsigned char) displacement);   // op xmm, [r12 + r15 * 8 + disp8]
+}
+
+const unsigned char MOVSD_LOAD  = 0x10;
+const unsigned char MOVSD_STORE = 0x11;
+
+const int8_t TOP_VALUE    = -1 * (int8_t) sizeof (elem_t);    // stack displacements relative to stack size
+const int8_t SECOND_VALUE = -2 * (int8_t) sizeof (elem_t);
+
+inline void EmitHelperCall (JitCompiler *compiler, uintptr_t function) {
+    EmitBytes (compiler, 0x48, 0xb8);                               // mov rax, function
+    EmitQword (compiler, function);
+    EmitBytes (compiler, 0xff, 0xd0);                               // call rax
+}
+
+inline void EmitIpStore (JitCompiler *compiler, size_t address) {
+    EmitBytes  (compiler, 0x48, 0xc7, 0x43, CONTEXT_FIELD_ (ip));       // mov qword [rbx + ip], address
+    EmitDword  (compiler, (uint32_t) address);
+}
+
+inline void EmitExit (JitCompiler *compiler, ProcessorErrorCode status, size_t address) {
+    EmitIpStore (compiler, address);
+    EmitBytes  (compiler, 0xc7, 0x43, CONTEXT_FIELD_ (status));         // mov dword [rbx + status], status
+    EmitDword  (compiler, (uint32_t) status);
+    EmitJumpTo (compiler, 0, compiler->epilogueOffset);
+}
+
+// jcc to error stub through an exit storing the address of the current instruction, so the usual path has only the jcc
+inline void EmitErrorJump (JitCompiler *compiler, unsigned char condition, size_t stubOffset) {
+    // mov does not change flags, so the address can be stored before the jcc too
+    if (compiler->errorExitsCount == MAX_ERROR_EXITS) {
+        EmitIpStore (compiler, compiler->currentInstruction->address);
+        EmitJumpTo  (compiler, condition, stubOffset);
+        return;
+    }
+
+    if (condition) {
+        EmitBytes (compiler, 0x0f, condition);
+    } else {
+        EmitBytes (compiler, 0xe9);
+    }
+
+    compiler->errorExits [compiler->errorExitsCount++] = {(uint32_t) compiler->codeSize,
+                                                          (uint32_t) compiler->currentInstruction->address, (uint32_t) stubOffset};
+    EmitDword (compiler, 0);
+}
+
+// Native code of other units may be too far for rel32
+inline void EmitAbsoluteJump (JitCompiler *compiler, const void *entry) {
+    EmitBytes (compiler, 0x48, 0xb8);                               // mov rax, entry
+    EmitQword (compiler, (uintptr_t) entry);
+    EmitBytes (compiler, 0xff, 0xe0);                               // jmp rax
+}
+
+// jcc rel8 forward, returns the end of the jump. Target is set by PatchShortJump when code is emitted there
+inline size_t EmitShortJump (JitCompiler *compiler, unsigned char condition) {
+    EmitBytes (compiler, (unsigned char) (condition - 0x10), 0x00);
+
+    return compiler->codeSize;
+}
+
+inline void PatchShortJump (JitCompiler *compiler, size_t jumpEnd) {
+    compiler->code [jumpEnd - 1] = (unsigned char) (compiler->codeSize - jumpEnd);
+}
+
+// Native code stops before the current instruction unless condition holds, then the interpreter executes it.
+// Instruction must not change anything before this exit
+inline void EmitInterpreterExit (JitCompiler *compiler, unsigned char condition) {
+    size_t jumpEnd = EmitShortJump (compiler, condition);
+
+    EmitExit (compiler, NO_PROCESSOR_ERRORS, compiler->currentInstruction->address);
+
+    PatchShortJump (compiler, jumpEnd);
+}
+
+// Full stack is grown by the interpreter: it pushes to spu stack and the next fill makes native stack bigger
+inline void EmitPush (JitCompiler *compiler) {
+    EmitBytes  (compiler, 0x4c, 0x3b, 0x7b, CONTEXT_FIELD_ (stackCapacity));    // cmp r15, [rbx + stackCapacity]
+    EmitInterpreterExit (compiler, JB_CONDITION);
+    EmitStackAccess (compiler, MOVSD_STORE, 0, 0);
+    EmitBytes  (compiler, 0x49, 0xff, 0xc7);                        // inc r15
+}
+
+inline void EmitPop (JitCompiler *compiler, unsigned char xmm) {
+    EmitBytes  (compiler, 0x4d, 0x85, 0xff);                        // test r15, r15
+    EmitErrorJump (compiler, JZ_CONDITION, compiler->stackErrorOffset);
+    EmitBytes  (compiler, 0x49, 0xff, 0xcf);                        // dec r15
+    EmitStackAccess (compiler, MOVSD_LOAD, xmm, 0);
+}
+
+inline void EmitStackCheck (JitCompiler *compiler, unsigned char valuesCount) {
+    EmitBytes  (compiler, 0x49, 0x83, 0xff, valuesCount);           // cmp r15, valuesCount
+    EmitErrorJump (compiler, JB_CONDITION, compiler->stackErrorOffset);
+}
+
+// xmm0 = immediate, register or their sum
+static void EmitArgumentValue (JitCompiler *compiler, DecodedInstruction *instruction) {
+    PushLog (4);
+
+    unsigned char arguments = instruction->commandCode.arguments;
+
+    if (arguments & REGISTER_ARGUMENT) {
+        EmitRegisterAccess (compiler, MOVSD_LOAD, 0, instruction->registerIndex);
+
+        if (arguments & IMMED_ARGUMENT) {
+            EmitLoadImmediate (compiler, 1, instruction->immedArgument);
+            EmitBytes (compiler, 0xf2, 0x0f, 0x58, 0xc1);                   // addsd xmm0, xmm1
+        }
+    } else {
+        EmitLoadImmediate (compiler, 0, instruction->immedArgument);
+    }
+
+    RETURN;
+}
+
+// rax = checked ram index of memory argument
+static void EmitMemoryIndex (JitCompiler *compiler, DecodedInstruction *instruction) {
+    PushLog (4);
+
+    EmitBytes (compiler, 0x8b, 0x7b, CONTEXT_FIELD_ (frequencySleep));     // mov edi, [rbx + frequencySleep]
+    EmitBytes (compiler, 0x85, 0xff);                                       // test edi, edi
+
+    size_t skipSleep = EmitShortJump (compiler, JZ_CONDITION);
+    EmitHelperCall (compiler, (uintptr_t) usleep);
+    PatchShortJump (compiler, skipSleep);
+
+    if ((instruction->commandCode.arguments & ~MEMORY_ARGUMENT) == IMMED_ARGUMENT) {
+        elem_t address = instruction->immedArgument;
+
+        if (address > -1 && address < (elem_t) (RAM_SIZE + VRAM_SIZE)) {
+            EmitBytes (compiler, 0xb8);                                     // mov eax, address
+            EmitDword (compiler, (uint32_t) (ssize_t) address);
+        } else {
+            EmitErrorJump (compiler, 0, compiler->memoryErrorOffset);
+        }
+
+        RETURN;
+    }
+
+    EmitArgumentValue (compiler, instruction);
+
+    EmitBytes  (compiler, 0xf2, 0x48, 0x0f, 0x2c, 0xc0);                    // cvttsd2si rax, xmm0
+    EmitBytes  (compiler, 0x48, 0x3d);                                      // cmp rax, RAM_SIZE + VRAM_SIZE
+    EmitDword  (compiler, (uint32_t) (RAM_SIZE + VRAM_SIZE));
+    EmitErrorJump (compiler, JAE_CONDITION, compiler->memoryErrorOffset);
+
+    RETURN;
+}
+
+// xmm0 = jump target of dynamic jump
+static void EmitJumpTargetValue (JitCompiler *compiler, DecodedInstruction *instruction) {
+    PushLog (4);
+
+    if (instruction->commandCode.arguments & MEMORY_ARGUMENT) {
+        EmitMemoryIndex (compiler, instruction);
+        EmitRamAccess   (compiler, MOVSD_LOAD, 0);
+    } else {
+        EmitArgumentValue (compiler, instruction);
+    }
+
+    RETURN;
+}
+
+// Jumps to native code of bytecode address in rax, helper stores the error if there is no code
+static void EmitEntryJump (JitCompiler *compiler) {
+    PushLog (4);
+
+    EmitBytes  (compiler, 0x48, 0x3d);                                      // cmp rax, bytecodeSize
+    EmitDword  (compiler, (uint32_t) compiler->program->bytecodeSize);
+    EmitErrorJump (compiler, JAE_CONDITION, compiler->jumpErrorOffset);
+    EmitBytes  (compiler, 0x48, 0x89, 0xc6);                                // mov rsi, rax
+    EmitBytes  (compiler, 0x48, 0x89, 0xdf);                                // mov rdi, rbx
+    EmitHelperCall (compiler, (uintptr_t) FindNativeEntry);
+    EmitBytes  (compiler, 0x48, 0x85, 0xc0);                                // test rax, rax
+    EmitJumpTo (compiler, JZ_CONDITION, compiler->epilogueOffset);
+    EmitBytes  (compiler, 0xff, 0xe0);                                      // jmp rax
+
+    RETURN;
+}
+
+// Jumps to address in xmm0
+static void EmitDynamicJump (JitCompiler *compiler) {
+    PushLog (4);
+
+    EmitBytes  (compiler, 0x66, 0x0f, 0x57, 0xc9);                          // xorpd xmm1, xmm1
+    EmitBytes  (compiler, 0x66, 0x0f, 0x2f, 0xc1);                          // comisd xmm0, xmm1
+    EmitErrorJump (compiler, JB_CONDITION, compiler->jumpErrorOffset);
+    EmitBytes  (compiler, 0xf2, 0x48, 0x0f, 0x2c, 0xc0);                    // cvttsd2si rax, xmm0
+
+    EmitEntryJump (compiler);
+
+    RETURN;
+}
+
+// Target in the same unit is reached with rel32 jump, compiled one with absolute jump. Others are reached
+// through jumpEntry, which is empty until the first jump finds their code
+static ProcessorErrorCode EmitStaticJump (JitCompiler *compiler, elem_t address, unsigned char condition, const void **jumpEntry) {
+    PushLog (4);
+
+    if (!(address >= 0 && address < (elem_t) compiler->program->bytecodeSize)) {
+        EmitErrorJump (compiler, condition, compiler->jumpErrorOffset);
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    DecodedInstruction *target   = FindDecodedInstruction (compiler->program, (size_t) address);
+    uintptr_t           unitEnd  = (uintptr_t) (compiler->unitStart + compiler->unitLength);
+
+    if (target && (uintptr_t) target >= (uintptr_t) compiler->unitStart && (uintptr_t) target <= unitEnd) {
+        if (condition) {
+            EmitBytes (compiler, 0x0f, condition);
+        } else {
+            EmitBytes (compiler, 0xe9);
+        }
+
+        RETURN EmitInstructionRel32 (compiler, target);
+    }
+
+    size_t skipJump = 0;
+
+    // x86 conditions go in pairs, lowest bit inverts the condition
+    if (condition) {
+        skipJump = EmitShortJump (compiler, (unsigned char) (condition ^ 1));
+    }
+
+    const void *entry = target ? __atomic_load_n (&target->nativeEntry, __ATOMIC_ACQUIRE) : NULL;
+
+    if (entry) {
+        EmitAbsoluteJump (compiler, entry);
+    } else {
+        EmitBytes  (compiler, 0x48, 0xba);                                  // mov rdx, jumpEntry
+        EmitQword  (compiler, (uintptr_t) jumpEntry);
+        EmitBytes  (compiler, 0x48, 0x8b, 0x02);                            // mov rax, [rdx]
+        EmitBytes  (compiler, 0x48, 0x85, 0xc0);                            // test rax, rax
+        EmitBytes  (compiler, 0x74, 0x02);                                  // jz +2
+        EmitBytes  (compiler, 0xff, 0xe0);                                  // jmp rax
+        EmitBytes  (compiler, 0xbe);                                        // mov esi, address
+        EmitDword  (compiler, (uint32_t) address);
+        EmitBytes  (compiler, 0x48, 0x89, 0xdf);                            // mov rdi, rbx
+        EmitHelperCall (compiler, (uintptr_t) LinkNativeEntry);
+        EmitBytes  (compiler, 0x48, 0x85, 0xc0);                            // test rax, rax
+        EmitJumpTo (compiler, JZ_CONDITION, compiler->epilogueOffset);
+        EmitBytes  (compiler, 0xff, 0xe0);                                  // jmp rax
+    }
+
+    if (condition) {
+        PatchShortJump (compiler, skipJump);
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+//-----------------------------------------------------------------------------------------------------------------
+// Translators
+
+static ProcessorErrorCode TranslateFallback (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation) {
+    PushLog (3);
+
+    EmitExit (compiler, NO_PROCESSOR_ERRORS, instruction->address);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode TranslateHalt (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation) {
+    PushLog (3);
+
+    EmitExit (compiler, PROCESSOR_HALT, instruction->address);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode TranslatePush (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation) {
+    PushLog (3);
+
+    if (instruction->commandCode.arguments & MEMORY_ARGUMENT) {
+        EmitMemoryIndex (compiler, instruction);
+        EmitRamAccess   (compiler, MOVSD_LOAD, 0);
+    } else {
+        EmitArgumentValue (compiler, instruction);
+    }
+
+    EmitPush (compiler);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode TranslatePop (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation) {
+    PushLog (3);
+
+    unsigned char arguments = instruction->commandCode.arguments;
+
+    if (arguments & MEMORY_ARGUMENT) {
+        EmitMemoryIndex (compiler, instruction);
+        EmitPop         (compiler, 0);
+        EmitRamAccess   (compiler, MOVSD_STORE, 0);
+
+        EmitBytes      (compiler, 0x80, 0x7b, CONTEXT_FIELD_ (graphicsEnabled), 0x00);    // cmp byte [rbx + graphicsEnabled], 0
+
+        size_t skipGraphics = EmitShortJump (compiler, JZ_CONDITION);
+        EmitBytes      (compiler, 0x48, 0x89, 0xc6);                        // mov rsi, rax
+        EmitBytes      (compiler, 0x48, 0x8b, 0x7b, CONTEXT_FIELD_ (spu));    // mov rdi, [rbx + spu]
+        EmitHelperCall (compiler, (uintptr_t) UpdateGraphics);
+        EmitBytes      (compiler, 0x85, 0xc0);                              // test eax, eax
+        EmitErrorJump  (compiler, JNZ_CONDITION, compiler->helperErrorOffset);
+        PatchShortJump (compiler, skipGraphics);
+
+    } else {
+        EmitPop (compiler, 0);
+
+        // value popped into immediate argument is lost, as it is in interpreter
+        if (arguments == REGISTER_ARGUMENT) {
+            EmitRegisterAccess (compiler, MOVSD_STORE, 0, instruction->registerIndex);
+        }
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode TranslateArithmetic (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation) {
+    PushLog (3);
+
+    EmitStackCheck  (compiler, 2);
+    EmitStackAccess (compiler, MOVSD_LOAD,             0, SECOND_VALUE);
+    EmitStackAccess (compiler, translation->sseOpcode, 0, TOP_VALUE);
+    EmitStackAccess (compiler, MOVSD_STORE,            0, SECOND_VALUE);
+    EmitBytes       (compiler, 0x49, 0xff, 0xcf);                           // dec r15
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode TranslateMathFunction (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation) {
+    PushLog (3);
+
+    EmitStackCheck  (compiler, 1);
+    EmitStackAccess (compiler, MOVSD_LOAD,  0, TOP_VALUE);
+    EmitHelperCall  (compiler, (uintptr_t) translation->mathFunction);
+    EmitStackAccess (compiler, MOVSD_STORE, 0, TOP_VALUE);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode TranslateSqrt (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation) {
+    PushLog (3);
+
+    EmitStackCheck  (compiler, 1);
+    EmitStackAccess (compiler, MOVSD_LOAD,  0, TOP_VALUE);
+    EmitBytes       (compiler, 0xf2, 0x0f, 0x51, 0xc0);                     // sqrtsd xmm0, xmm0
+    EmitStackAccess (compiler, MOVSD_STORE, 0, TOP_VALUE);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// floor is a truncation to integer in Instructions.def
+static ProcessorErrorCode TranslateFloor (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation) {
+    PushLog (3);
+
+    EmitStackCheck  (compiler, 1);
+    EmitStackAccess (compiler, MOVSD_LOAD,  0, TOP_VALUE);
+    EmitBytes       (compiler, 0xf2, 0x48, 0x0f, 0x2c, 0xc0);               // cvttsd2si rax, xmm0
+    EmitBytes       (compiler, 0xf2, 0x48, 0x0f, 0x2a, 0xc0);               // cvtsi2sd  xmm0, rax
+    EmitStackAccess (compiler, MOVSD_STORE, 0, TOP_VALUE);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode TranslateJump (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation) {
+    PushLog (3);
+
+    if (instruction->commandCode.arguments == IMMED_ARGUMENT) {
+        RETURN EmitStaticJump (compiler, instruction->immedArgument, 0, &instruction->jumpEntry);
+    }
+
+    EmitJumpTargetValue (compiler, instruction);
+    EmitDynamicJump     (compiler);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Compares values the same way CompareValues does: edx = GREATER, LESS or EQUAL
+static ProcessorErrorCode TranslateConditionalJump (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation) {
+    PushLog (3);
+
+    bool isStaticJump = instruction->commandCode.arguments == IMMED_ARGUMENT;
+
+    if (!isStaticJump) {
+        EmitJumpTargetValue (compiler, instruction);
+        EmitBytes (compiler, 0x66, 0x0f, 0x28, 0xd0);                       // movapd xmm2, xmm0
+    }
+
+    EmitStackCheck  (compiler, 2);
+    EmitBytes       (compiler, 0x49, 0x83, 0xef, 0x02);                     // sub r15, 2
+    EmitStackAccess (compiler, MOVSD_LOAD, 0, 0);
+    EmitStackAccess (compiler, MOVSD_LOAD, 1, (int8_t) sizeof (elem_t));
+    EmitBytes       (compiler, 0xf2, 0x0f, 0x5c, 0xc1);                     // subsd xmm0, xmm1
+
+    elem_t epsilon         =  EPS;
+    elem_t negativeEpsilon = -EPS;
+    uint64_t epsilonBits         = 0;
+    uint64_t negativeEpsilonBits = 0;
+
+    memcpy (&epsilonBits,         &epsilon,         sizeof (epsilonBits));
+    memcpy (&negativeEpsilonBits, &negativeEpsilon, sizeof (negativeEpsilonBits));
+
+    EmitBytes (compiler, 0xba);                                             // mov edx, EQUAL
+    EmitDword (compiler, EQUAL);
+    EmitBytes (compiler, 0xb8);                                             // mov eax, LESS
+    EmitDword (compiler, LESS);
+    EmitBytes (compiler, 0x48, 0xb9);                                       // mov rcx, -EPS
+    EmitQword (compiler, negativeEpsilonBits);
+    EmitBytes (compiler, 0x66, 0x48, 0x0f, 0x6e, 0xc9);                     // movq xmm1, rcx
+    EmitBytes (compiler, 0x66, 0x0f, 0x2f, 0xc8);                           // comisd xmm1, xmm0
+    EmitBytes (compiler, 0x0f, 0x47, 0xd0);                                 // cmova edx, eax
+    EmitBytes (compiler, 0xb8);                                             // mov eax, GREATER
+    EmitDword (compiler, GREATER);
+    EmitBytes (compiler, 0x48, 0xb9);                                       // mov rcx, EPS
+    EmitQword (compiler, epsilonBits);
+    EmitBytes (compiler, 0x66, 0x48, 0x0f, 0x6e, 0xc9);                     // movq xmm1, rcx
+    EmitBytes (compiler, 0x66, 0x0f, 0x2f, 0xc1);                           // comisd xmm0, xmm1
+    EmitBytes (compiler, 0x0f, 0x47, 0xd0);                                 // cmova edx, eax
+    EmitBytes (compiler, 0xf7, 0xc2);                                       // test edx, comparison
+    EmitDword (compiler, (uint32_t) translation->comparison);
+
+    if (isStaticJump) {
+        RETURN EmitStaticJump (compiler, instruction->immedArgument, JNZ_CONDITION, &instruction->jumpEntry);
+    }
+
+    EmitBytes (compiler, 0x0f, JZ_CONDITION);
+    ProgramErrorCheck (EmitInstructionRel32 (compiler, instruction + 1), "Error occuried while emitting jump");
+
+    EmitBytes       (compiler, 0x66, 0x0f, 0x28, 0xc2);                     // movapd xmm0, xmm2
+    EmitDynamicJump (compiler);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode TranslateCall (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation) {
+    PushLog (3);
+
+    bool isStaticJump = instruction->commandCode.arguments == IMMED_ARGUMENT;
+
+    if (!isStaticJump) {
+        EmitJumpTargetValue (compiler, instruction);
+    }
+
+    EmitBytes  (compiler, 0x48, 0x8b, 0x43, CONTEXT_FIELD_ (callStackSize));    // mov rax, [rbx + callStackSize]
+    EmitBytes  (compiler, 0x48, 0x3b, 0x43, CONTEXT_FIELD_ (callStackCapacity));    // cmp rax, [rbx + callStackCapacity]
+    EmitInterpreterExit (compiler, JB_CONDITION);
+    EmitBytes  (compiler, 0x48, 0x8b, 0x53, CONTEXT_FIELD_ (callStack));        // mov rdx, [rbx + callStack]
+    EmitBytes  (compiler, 0xb9);                                                // mov ecx, return address
+    EmitDword  (compiler, (uint32_t) (instruction + 1)->address);
+    EmitBytes  (compiler, 0x48, 0x89, 0x0c, 0xc2);                              // mov [rdx + rax * 8], rcx
+    EmitBytes  (compiler, 0x48, 0xff, 0xc0);                                    // inc rax
+    EmitBytes  (compiler, 0x48, 0x89, 0x43, CONTEXT_FIELD_ (callStackSize));    // mov [rbx + callStackSize], rax
+
+    if (isStaticJump) {
+        RETURN EmitStaticJump (compiler, instruction->immedArgument, 0, &instruction->jumpEntry);
+    }
+
+    EmitDynamicJump (compiler);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode TranslateReturn (JitCompiler *compiler, DecodedInstruction *instruction, const JitTranslation *translation) {
+    PushLog (3);
+
+    EmitBytes  (compiler, 0x48, 0x8b, 0x43, CONTEXT_FIELD_ (callStackSize));    // mov rax, [rbx + callStackSize]
+    EmitBytes  (compiler, 0x48, 0x85, 0xc0);                                    // test rax, rax
+    EmitErrorJump (compiler, JZ_CONDITION, compiler->stackErrorOffset);
+    EmitBytes  (compiler, 0x48, 0xff, 0xc8);                                    // dec rax
+    EmitBytes  (compiler, 0x48, 0x89, 0x43, CONTEXT_FIELD_ (callStackSize));    // mov [rbx + callStackSize], rax
+    EmitBytes  (compiler, 0x48, 0x8b, 0x53, CONTEXT_FIELD_ (callStack));        // mov rdx, [rbx + callStack]
+    EmitBytes  (compiler, 0x48, 0x8b, 0x04, 0xc2);                              // mov rax, [rdx + rax * 8]
+
+    EmitEntryJump (compiler);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+//-----------------------------------------------------------------------------------------------------------------
+// Compilation
+
+// Native function saves callee-saved registers, loads context into them and jumps to entry
+static void EmitStubs (JitCompiler *compiler) {
+    PushLog (3);
+
+    EmitBytes (compiler, 0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57);     // push rbx, rbp, r12 - r15
+    EmitBytes (compiler, 0x48, 0x83, 0xec, 0x08);                                       // sub rsp, 8 (stack alignment)
+    EmitBytes (compiler, 0x48, 0x89, 0xfb);                                             // mov rbx, rdi
+    EmitBytes (compiler, 0x4c, 0x8b, 0x63, CONTEXT_FIELD_ (stack));                     // mov r12, [rbx + stack]
+    EmitBytes (compiler, 0x4c, 0x8b, 0x6b, CONTEXT_FIELD_ (registers));                 // mov r13, [rbx + registers]
+    EmitBytes (compiler, 0x4c, 0x8b, 0x73, CONTEXT_FIELD_ (ram));                       // mov r14, [rbx + ram]
+    EmitBytes (compiler, 0x4c, 0x8b, 0x7b, CONTEXT_FIELD_ (stackSize));                 // mov r15, [rbx + stackSize]
+    EmitBytes (compiler, 0xff, 0xe6);                                                   // jmp rsi
+
+    compiler->epilogueOffset = compiler->codeSize;
+
+    EmitBytes (compiler, 0x4c, 0x89, 0x7b, CONTEXT_FIELD_ (stackSize));                 // mov [rbx + stackSize], r15
+    EmitBytes (compiler, 0x48, 0x83, 0xc4, 0x08);                                       // add rsp, 8
+    EmitBytes (compiler, 0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5d, 0x5b);   // pop r15 - r12, rbp, rbx
+    EmitBytes (compiler, 0xc3);                                                         // ret
+
+    #define ERROR_STUB_(offset, errorCode)                                                              \
+                do {                                                                                    \
+                    compiler->offset = compiler->codeSize;                                              \
+                    EmitBytes  (compiler, 0xc7, 0x43, CONTEXT_FIELD_ (status));                         \
+                    EmitDword  (compiler, (uint32_t) errorCode);                                        \
+                    EmitJumpTo (compiler, 0, compiler->epilogueOffset);                                 \
+                } while (0)
+
+    ERROR_STUB_ (stackErrorOffset,  STACK_ERROR);
+    ERROR_STUB_ (memoryErrorOffset, TOO_FEW_ARGUMENTS);
+    ERROR_STUB_ (jumpErrorOffset,   WRONG_ADDRESS);
+
+    #undef ERROR_STUB_
+
+    compiler->helperErrorOffset = compiler->codeSize;
+
+    EmitBytes  (compiler, 0x89, 0x43, CONTEXT_FIELD_ (status));                         // mov [rbx + status], eax
+    EmitJumpTo (compiler, 0, compiler->epilogueOffset);
+
+    RETURN;
+}
+
+ProcessorErrorCode InitJitProgram (JitProgram *jitProgram) {
+    PushLog (2);
+
+    custom_assert (jitProgram, pointer_is_null, NO_BUFFER);
+
+    jitProgram->chunks = {0, 0, NULL};
+    pthread_mutex_init (&jitProgram->mutex, NULL);
+
+    ProcessorErrorCode errorCode = AddJitChunk (jitProgram);
+
+    if (errorCode != NO_PROCESSOR_ERRORS) {
+        DestroyJitProgram (jitProgram);
+        ProgramErrorCheck (errorCode, "Error occuried while allocating native code");
+    }
+
+    jitProgram->function = (jitFunction_t) (uintptr_t) jitProgram->chunks.data [0].code;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static JitTranslationsTable CreateTranslationsTable () {
+    PushLog (3);
+
+    JitTranslationsTable table = {};
+
+    for (size_t opcode = 0; opcode < OPCODES_COUNT; opcode++) {
+        const AssemblerInstruction *instruction = FindInstructionByOpcode ((int) opcode);
+        table.translations [opcode] = &FallbackTranslation;
+
+        for (size_t translationIndex = 0; instruction && translationIndex < sizeof (Translations) / sizeof (JitTranslation); translationIndex++) {
+            if (strcmp (instruction->instructionName, Translations [translationIndex].instructionName) == 0) {
+                table.translations [opcode] = Translations + translationIndex;
+                break;
+            }
+        }
+    }
+
+    RETURN table;
+}
+
+// Maps a new chunk and makes its exits executable
+static ProcessorErrorCode AddJitChunk (JitProgram *jitProgram) {
+    PushLog (3);
+
+    size_t pageSize = (size_t) sysconf (_SC_PAGESIZE);
+
+    JitChunk chunk = {
+        .code     = (unsigned char *) mmap (NULL, JIT_CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0),
+        .codeSize = JIT_CHUNK_SIZE,
+    };
+
+    if (chunk.code == MAP_FAILED) {
+        RETURN NO_BUFFER;
+    }
+
+    JitCompiler compiler = {
+        .code         = chunk.code,
+        .codeCapacity = chunk.codeSize,
+    };
+
+    EmitStubs (&compiler);
+
+    chunk.usedSize          = (compiler.codeSize + pageSize - 1) / pageSize * pageSize;
+    chunk.epilogueOffset    = compiler.epilogueOffset;
+    chunk.stackErrorOffset  = compiler.stackErrorOffset;
+    chunk.memoryErrorOffset = compiler.memoryErrorOffset;
+    chunk.jumpErrorOffset   = compiler.jumpErrorOffset;
+    chunk.helperErrorOffset = compiler.helperErrorOffset;
+
+    if (mprotect (chunk.code, chunk.usedSize, PROT_READ | PROT_EXEC) != 0 ||
+            WriteDataToBuffer (&jitProgram->chunks, &chunk, 1) != NO_PROCESSOR_ERRORS) {
+        munmap (chunk.code, chunk.codeSize);
+        RETURN NO_BUFFER;
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Unit goes from unitStart to the end of its block or to code compiled before. Called under jitProgram->mutex
+static ProcessorErrorCode CompileJitUnit (JitProgram *jitProgram, DecodedProgram *decodedProgram, DecodedInstruction *unitStart) {
+    PushLog (2);
+
+    custom_assert (jitProgram,     pointer_is_null, NO_BUFFER);
+    custom_assert (decodedProgram, pointer_is_null, NO_BUFFER);
+    custom_assert (unitStart,      pointer_is_null, NO_BUFFER);
+
+    if (decodedProgram->bytecodeSize > INT32_MAX) {
+        ProgramErrorCheck (BUFFER_ENDED, "Program is too big for native code");
+    }
+
+    static const JitTranslationsTable TranslationsTable = CreateTranslationsTable ();
+
+    size_t unitLength = 0;
+
+    while (unitStart [unitLength].instruction && !unitStart [unitLength].nativeEntry) {
+        unitLength++;
+    }
+
+    size_t    pageSize = (size_t) sysconf (_SC_PAGESIZE);
+    JitChunk *chunk    = jitProgram->chunks.data + jitProgram->chunks.currentIndex - 1;
+
+    if (chunk->usedSize + (unitLength + 1) * MAX_INSTRUCTION_CODE_SIZE + MAX_ERROR_EXITS * ERROR_EXIT_SIZE > chunk->codeSize) {
+        ProgramErrorCheck (AddJitChunk (jitProgram), "Error occuried while allocating native code");
+
+        chunk = jitProgram->chunks.data + jitProgram->chunks.currentIndex - 1;
+    }
+
+    JitCompiler compiler = {
+        .program      = decodedProgram,
+        .code         = chunk->code,
+        .codeSize     = chunk->usedSize,
+        .codeCapacity = chunk->codeSize,
+
+        .unitStart     = unitStart,
+        .unitLength    = unitLength,
+        .nativeOffsets = {},
+        .fixups        = {0, 0, NULL},
+
+        .errorExits      = {},
+        .errorExitsCount = 0,
+
+        .epilogueOffset    = chunk->epilogueOffset,
+        .stackErrorOffset  = chunk->stackErrorOffset,
+        .memoryErrorOffset = chunk->memoryErrorOffset,
+        .jumpErrorOffset   = chunk->jumpErrorOffset,
+        .helperErrorOffset = chunk->helperErrorOffset,
+
+        .currentInstruction = unitStart,
+    };
+
+    #define FreeDataAndReturnIfErrors(message, ...)                 \
+                do {                                                \
+                    ProcessorErrorCode errorCode_ = __VA_ARGS__;    \
+                    if (errorCode_ != NO_PROCESSOR_ERRORS) {        \
+                        DestroyBuffer (&compiler.fixups);           \
+                        ProgramErrorCheck (errorCode_, message);    \
+                    }                                               \
+                } while (0)
+
+    for (size_t instructionIndex = 0; instructionIndex < unitLength; instructionIndex++) {
+        DecodedInstruction   *instruction = unitStart + instructionIndex;
+        const JitTranslation *translation = TranslationsTable.translations [instruction->commandCode.opcode];
+
+        compiler.currentInstruction              = instruction;
+        compiler.nativeOffsets [instructionIndex] = compiler.codeSize;
+
+        FreeDataAndReturnIfErrors ("Error occuried while translating instruction",
+                                    translation->translator (&compiler, instruction, translation));
+
+        if (compiler.codeSize - compiler.nativeOffsets [instructionIndex] > MAX_INSTRUCTION_CODE_SIZE) {
+            FreeDataAndReturnIfErrors ("Native code buffer overflow", BUFFER_ENDED);
+        }
+    }
+
+    // unit end continues to compiled code, to the next block or stops at the end of the program
+    DecodedInstruction *unitEnd = unitStart + unitLength;
+
+    compiler.currentInstruction        = unitEnd;
+    compiler.nativeOffsets [unitLength] = compiler.codeSize;
+
+    if (unitEnd->instruction) {
+        EmitAbsoluteJump (&compiler, unitEnd->nativeEntry);
+    } else if (unitEnd->address >= decodedProgram->bytecodeSize) {
+        EmitExit (&compiler, BUFFER_ENDED, unitEnd->address);
+    } else {
+        FreeDataAndReturnIfErrors ("Error occuried while translating block end",
+                                    EmitStaticJump (&compiler, (elem_t) unitEnd->address, 0, &unitEnd->jumpEntry));
+    }
+
+    for (size_t exitIndex = 0; exitIndex < compiler.errorExitsCount; exitIndex++) {
+        JitErrorExit *errorExit = compiler.errorExits + exitIndex;
+
+        int32_t relative = (int32_t) ((int64_t) compiler.codeSize - (int64_t) (errorExit->position + sizeof (int32_t)));
+        memcpy (compiler.code + errorExit->position, &relative, sizeof (relative));
+
+        EmitIpStore (&compiler, errorExit->address);
+        EmitJumpTo  (&compiler, 0, errorExit->stubOffset);
+    }
+
+    for (size_t fixupIndex = 0; fixupIndex < compiler.fixups.currentIndex; fixupIndex++) {
+        JitFixup *fixup = compiler.fixups.data + fixupIndex;
+
+        int32_t relative = (int32_t) ((int64_t) compiler.nativeOffsets [fixup->target - unitStart] -
+                                        (int64_t) (fixup->position + sizeof (int32_t)));
+
+        memcpy (compiler.code + fixup->position, &relative, sizeof (relative));
+    }
+
+    DestroyBuffer (&compiler.fixups);
+
+    #undef FreeDataAndReturnIfErrors
+
+    size_t unitSize = (compiler.codeSize - chunk->usedSize + pageSize - 1) / pageSize * pageSize;
+
+    if (mprotect (chunk->code + chunk->usedSize, unitSize, PROT_READ | PROT_EXEC) != 0) {
+        ProgramErrorCheck (NO_BUFFER, "Error occuried while making native code executable");
+    }
+
+    // unit at the end of the program has only the sentinel
+    for (size_t instructionIndex = 0; instructionIndex < unitLength || instructionIndex == 0; instructionIndex++) {
+        __atomic_store_n (&unitStart [instructionIndex].nativeEntry, chunk->code + compiler.nativeOffsets [instructionIndex], __ATOMIC_RELEASE);
+    }
+
+    chunk->usedSize += unitSize;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode DestroyJitProgram (JitProgram *jitProgram) {
+    PushLog (3);
+
+    custom_assert (jitProgram, pointer_is_null, NO_BUFFER);
+
+    // program has not been initialized
+    if (!jitProgram->chunks.data) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    for (size_t chunkIndex = 0; chunkIndex < jitProgram->chunks.currentIndex; chunkIndex++) {
+        munmap (jitProgram->chunks.data [chunkIndex].code, jitProgram->chunks.data [chunkIndex].codeSize);
+    }
+
+    DestroyBuffer (&jitProgram->chunks);
+    pthread_mutex_destroy (&jitProgram->mutex);
+
+    jitProgram->chunks   = {0, 0, NULL};
+    jitProgram->function = NULL;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+#undef CONTEXT_FIELD_
+
+#else
+
+ProcessorErrorCode InitJitProgram (JitProgram *jitProgram) {
+    PushLog (2);
+
+    ProgramErrorCheck (WRONG_INSTRUCTION, "JIT is not supported on this platform");
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode DestroyJitProgram (JitProgram *jitProgram) {
+    PushLog (3);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode ExecuteJit (SPU *spu, DecodedProgram *decodedProgram, JitProgram *jitProgram) {
+    PushLog (1);
+
+    ProgramErrorCheck (WRONG_INSTRUCTION, "JIT is not supported on this platform");
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+#endif
@@ -0,0 +1,318 @@
+#include <SFML/System/Thread.hpp>
+#include <pthread.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "MultiCore.h"
+#include "CommonModules.h"
+#include "CustomAssert.h"
+#include "Logger.h"
+#include "MessageHandler.h"
+#include "SoftProcessor.h"
+#include "SPU.h"
+#include "Stack/Stack.h"
+
+static void RunCore  (ProcessorCore *core);
+static void StopCore (MultiCore *machine, ProcessorCore *core, ProcessorErrorCode status);
+
+static void ReleaseBarrierIfPassed (MultiCore *machine);
+
+ProcessorErrorCode InitMultiCore (MultiCore *machine, SPU *spu, ProgramImage *image, size_t coresCount) {
+    PushLog (2);
+
+    custom_assert (machine,  pointer_is_null, NO_BUFFER);
+    custom_assert (spu,      pointer_is_null, NO_PROCESSOR);
+    custom_assert (spu->ram, pointer_is_null, NO_BUFFER);
+    custom_assert (image,    pointer_is_null, NO_BUFFER);
+
+    if (coresCount > MAX_CORES_COUNT) {
+        PrintWarningMessage (NO_PROCESSOR_ERRORS, "Too many cores. Using maximal count.", NULL, NULL, -1);
+
+        coresCount = MAX_CORES_COUNT;
+    }
+
+    machine->cores        = new ProcessorCore [coresCount];
+    machine->coresCount   = coresCount;
+    machine->image        = image;
+    machine->runningCount = 1;
+
+    machine->cores [0].spu       = spu;
+    machine->cores [0].isRunning = true;
+
+    spu->machine = machine;
+    spu->coreId  = 0;
+
+    for (size_t coreIndex = 1; coreIndex < coresCount; coreIndex++) {
+        ProcessorCore *core = machine->cores + coreIndex;
+
+        core->spu    = new SPU {
+            .bytecode        = spu->bytecode,
+            .ram             = spu->ram,
+            .frequencySleep  = spu->frequencySleep,
+            .graphicsEnabled = spu->graphicsEnabled,
+            .isWorking       = true,
+            .machine         = machine,
+            .coreId          = coreIndex,
+        };
+
+        StackInitDefault_ (&core->spu->processorStack);
+        StackInitDefault_ (&core->spu->callStack);
+
+        core->thread = new sf::Thread (&RunCore, core);
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode StopMultiCore (MultiCore *machine) {
+    PushLog (2);
+
+    custom_assert (machine,        pointer_is_null, NO_BUFFER);
+    custom_assert (machine->cores, pointer_is_null, NO_BUFFER);
+
+    StopCore (machine, machine->cores, NO_PROCESSOR_ERRORS);
+
+    for (size_t coreIndex = 1; coreIndex < machine->coresCount; coreIndex++) {
+        machine->cores [coreIndex].thread->wait ();
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode DestroyMultiCore (MultiCore *machine) {
+    PushLog (2);
+
+    custom_assert (machine, pointer_is_null, NO_BUFFER);
+
+    if (!machine->cores) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    for (size_t coreIndex = 1; coreIndex < machine->coresCount; coreIndex++) {
+        ProcessorCore *core = machine->cores + coreIndex;
+
+        // waits for the core if it is still running
+        delete core->thread;
+
+        StackDestruct_ (&core->spu->processorStack);
+        StackDestruct_ (&core->spu->callStack);
+
+        delete core->spu;
+    }
+
+    machine->cores [0].spu->machine = NULL;
+
+    delete [] machine->cores;
+
+    machine->cores      = NULL;
+    machine->coresCount = 0;
+
+    pthread_cond_destroy  (&machine->stateChange);
+    pthread_mutex_destroy (&machine->mutex);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// New core gets registers of the spawning one and empty stacks
+ProcessorErrorCode SpawnCore (SPU *spu, elem_t address, elem_t *coreId) {
+    PushLog (3);
+
+    custom_assert (spu,    pointer_is_null, NO_PROCESSOR);
+    custom_assert (coreId, pointer_is_null, NO_BUFFER);
+
+    MultiCore *machine = spu->machine;
+
+    if (!machine) {
+        RETURN NO_PROCESSOR;
+    }
+
+    if ((ssize_t) address >= spu->bytecode.buffer_size || address < 0) {
+        RETURN WRONG_ADDRESS;
+    }
+
+    ProcessorCore *core = NULL;
+
+    pthread_mutex_lock (&machine->mutex);
+
+    for (size_t coreIndex = 1; coreIndex < machine->coresCount; coreIndex++) {
+        if (!machine->cores [coreIndex].isRunning) {
+            core = machine->cores + coreIndex;
+            break;
+        }
+    }
+
+    if (core) {
+        core->isRunning = true;
+        core->status    = NO_PROCESSOR_ERRORS;
+
+        machine->runningCount++;
+    }
+
+    pthread_mutex_unlock (&machine->mutex);
+
+    if (!core) {
+        RETURN NO_PROCESSOR;
+    }
+
+    SPU *coreSpu = core->spu;
+
+    memcpy (coreSpu->registerValues, spu->registerValues, sizeof (spu->registerValues));
+
+    coreSpu->ip                   = (size_t) address;
+    coreSpu->processorStack.size  = 0;
+    coreSpu->callStack.size       = 0;
+    coreSpu->executedInstructions = 0;
+
+    // previous run of the core is past StopCore, launch waits for its thread to exit
+    core->thread->launch ();
+
+    *coreId = (elem_t) coreSpu->coreId;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Returns error code of the joined core if it has failed
+ProcessorErrorCode JoinCore (SPU *spu, elem_t coreId) {
+    PushLog (3);
+
+    custom_assert (spu, pointer_is_null, NO_PROCESSOR);
+
+    MultiCore *machine = spu->machine;
+
+    if (!machine) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    if (coreId < 0 || (size_t) coreId >= machine->coresCount || (size_t) coreId == spu->coreId) {
+        RETURN NO_PROCESSOR;
+    }
+
+    ProcessorCore *core = machine->cores + (size_t) coreId;
+
+    pthread_mutex_lock (&machine->mutex);
+
+    while (core->isRunning) {
+        pthread_cond_wait (&machine->stateChange, &machine->mutex);
+    }
+
+    ProcessorErrorCode status = core->status;
+
+    pthread_mutex_unlock (&machine->mutex);
+
+    if (status == PROCESSOR_HALT || status == BUFFER_ENDED) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    RETURN status;
+}
+
+// Waits until every running core reaches a barrier. Stopped cores are not waited for
+ProcessorErrorCode WaitBarrier (SPU *spu) {
+    PushLog (3);
+
+    custom_assert (spu, pointer_is_null, NO_PROCESSOR);
+
+    MultiCore *machine = spu->machine;
+
+    if (!machine) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    pthread_mutex_lock (&machine->mutex);
+
+    size_t generation = machine->barrierGeneration;
+
+    machine->barrierArrived++;
+    ReleaseBarrierIfPassed (machine);
+
+    while (generation == machine->barrierGeneration) {
+        pthread_cond_wait (&machine->stateChange, &machine->mutex);
+    }
+
+    pthread_mutex_unlock (&machine->mutex);
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+size_t GetCoresCount (SPU *spu) {
+    PushLog (4);
+
+    custom_assert (spu, pointer_is_null, 0);
+
+    RETURN spu->machine ? spu->machine->coresCount : 1;
+}
+
+elem_t AtomicAdd (elem_t *destination, elem_t value) {
+    PushLog (4);
+
+    elem_t oldValue = 0;
+    __atomic_load (destination, &oldValue, __ATOMIC_SEQ_CST);
+
+    elem_t newValue = oldValue + value;
+
+    while (!__atomic_compare_exchange (destination, &oldValue, &newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        newValue = oldValue + value;
+    }
+
+    RETURN oldValue;
+}
+
+// Values are compared bitwise, not with EPS as in conditional jumps
+elem_t AtomicCompareExchange (elem_t *destination, elem_t expected, elem_t desired) {
+    PushLog (4);
+
+    __atomic_compare_exchange (destination, &expected, &desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+
+    RETURN expected;
+}
+
+static void RunCore (ProcessorCore *core) {
+    PushLog (2);
+
+    custom_assert (core,      pointer_is_null, (void) 0);
+    custom_assert (core->spu, pointer_is_null, (void) 0);
+
+    SPU *spu = core->spu;
+
+    ProcessorErrorCode status = ExecuteProgramImage (spu, spu->machine->image);
+
+    StopCore (spu->machine, core, status);
+
+    RETURN;
+}
+
+static void StopCore (MultiCore *machine, ProcessorCore *core, ProcessorErrorCode status) {
+    PushLog (3);
+
+    pthread_mutex_lock (&machine->mutex);
+
+    core->isRunning = false;
+    core->status    = status;
+
+    machine->runningCount--;
+
+    // cores waiting on a barrier do not wait for the stopped one any more
+    ReleaseBarrierIfPassed (machine);
+
+    pthread_cond_broadcast (&machine->stateChange);
+    pthread_mutex_unlock   (&machine->mutex);
+
+    RETURN;
+}
+
+// Machine mutex has to be locked
+static void ReleaseBarrierIfPassed (MultiCore *machine) {
+    PushLog (4);
+
+    if (machine->barrierArrived == 0 || machine->barrierArrived < machine->runningCount) {
+        RETURN;
+    }
+
+    machine->barrierArrived = 0;
+    machine->barrierGeneration++;
+
+    pthread_cond_broadcast (&machine->stateChange);
+
+    RETURN;
+}
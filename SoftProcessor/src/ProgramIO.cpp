@@ -0,0 +1,33 @@
+#include <stddef.h>
+
+#include "ProgramIO.h"
+#include "Buffer.h"
+#include "CommonModules.h"
+#include "CustomAssert.h"
+#include "Logger.h"
+#include "SPU.h"
+
+ProcessorErrorCode WriteProgramOutput (SPU *spu, elem_t value) {
+    PushLog (3);
+
+    custom_assert (spu,     pointer_is_null, NO_PROCESSOR);
+    custom_assert (spu->io, pointer_is_null, NO_BUFFER);
+
+    RETURN WriteDataToBuffer (&spu->io->output, &value, 1);
+}
+
+ProcessorErrorCode ReadProgramInput (SPU *spu, elem_t *value) {
+    PushLog (3);
+
+    custom_assert (spu,     pointer_is_null, NO_PROCESSOR);
+    custom_assert (spu->io, pointer_is_null, NO_BUFFER);
+    custom_assert (value,   pointer_is_null, NO_BUFFER);
+
+    if (spu->io->inputIndex >= spu->io->input.currentIndex) {
+        RETURN INPUT_FILE_ERROR;
+    }
+
+    *value = spu->io->input.data [spu->io->inputIndex++];
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
@@ -3,6 +3,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/types.h>
@@ -15,7 +16,15 @@
 #include "Debugger.h"
 #include "FileIO.h"
 #include "GraphicsProvider.h"
+#include "InstructionDecoder.h"
+#include "JitCompiler.h"
+#include "SpecializedEngine.h"
+#include "StackCachingEngine.h"
+#include "ThreadedEngine.h"
+#include "TieredEngine.h"
 #include "MessageHandler.h"
+#include "MultiCore.h"
+#include "ProgramIO.h"
 #include "SecureStack/SecureStack.h"
 #include "SoftProcessor.h"
 #include "ColorConsole.h"
@@ -27,21 +36,142 @@
 #include "SPU.h"
 #include "DSLFunctions.h"
 
-static DebuggerAction ExecuteProgram (SPU *spu, Buffer <DebugInfoChunk> *debugInfoBuffer,
-										Buffer <DebugInfoChunk> *breakpointsBuffer, TextBuffer *sourceText);
+static DebuggerAction ExecuteProgram (SPU *spu, ProgramImage *image, Buffer <DebugInfoChunk> *breakpointsBuffer, TextBuffer *sourceText);
 
-static ProcessorErrorCode GetArgumentsPointer  (SPU *spu, const AssemblerInstruction *instruction,
-												const CommandCode *commandCode, elem_t **argumentPointer);
+static ProcessorErrorCode InitExecutionContext    (SPU *spu);
+static void               DestroyExecutionContext (SPU *spu);
 
-static ProcessorErrorCode ReadHeader      (SPU *spu, Header *readHeader);
-static ProcessorErrorCode ReadDebugInfo   (SPU *spu, Buffer <DebugInfoChunk> *debugInfoBuffer, Header *header, char *sourcePath);
+static ProcessorErrorCode GetArgumentsPointer        (SPU *spu, const AssemblerInstruction *instruction,
+														const CommandCode *commandCode, elem_t **argumentPointer);
+static ProcessorErrorCode GetDecodedArgumentPointer  (SPU *spu, DecodedInstruction *instruction, elem_t **argumentPointer);
+static ProcessorErrorCode GetMemoryArgumentPointer   (SPU *spu, elem_t **argumentPointer);
+
+static ProcessorErrorCode ReadDebugInfo   (BinaryContainer *container, ProgramImage *image);
+static ProcessorErrorCode ReadConstants   (BinaryContainer *container, ProgramImage *image);
+static void               LoadConstants   (SPU *spu, ProgramImage *image);
 static ProcessorErrorCode ReadInstruction (SPU *spu, Buffer <DebugInfoChunk> *breakpointsBuffer,
 												Buffer <DebugInfoChunk> *debugInfoBuffer, TextBuffer *sourceText, bool *doStep);
+static ProcessorErrorCode ExecuteDecodedInstruction (SPU *spu, DecodedProgram *decodedProgram, DecodedInstruction **currentInstruction);
+static ProcessorErrorCode InterpretInstruction      (SPU *spu);
 
 static ProcessorErrorCode GenerateDisassembly (TextBuffer *disassemblyText, FileBuffer *disassemblyBuffer,
 												Buffer <DebugInfoChunk> *debugInfoBuffer, char *binaryFilepath);
 
-ProcessorErrorCode LaunchProgram (SPU *spu, char *sourceFilename, char *binaryFilename, sf::Mutex *workMutex) {
+ProcessorErrorCode LoadProgramImage (ProgramImage *image, FileBuffer *binary, ExecutionOptions *options) {
+	PushLog (1);
+
+	custom_assert (image,   pointer_is_null, NO_BUFFER);
+	custom_assert (binary,  pointer_is_null, NO_BUFFER);
+	custom_assert (options, pointer_is_null, NO_BUFFER);
+
+	#define DestroyImageAndReturnIfErrors(message, ...)								\
+			do {																	\
+				ProcessorErrorCode errorCode_ = __VA_ARGS__;						\
+				if (errorCode_ != NO_PROCESSOR_ERRORS) {							\
+					DestroyProgramImage (image);									\
+					ProgramErrorCheck (errorCode_, message);						\
+				}																	\
+			} while (0)
+
+	image->engine = options->engine;
+
+	if (image->engine == JIT_ENGINE && !JIT_SUPPORTED) {
+		PrintWarningMessage (NO_PROCESSOR_ERRORS, "JIT is not supported on this platform. Using callback engine.", NULL, NULL, -1);
+		image->engine = CALLBACK_ENGINE;
+	}
+
+	BinaryContainer container = {
+		.verifyChecksums = options->verifyChecksums,
+	};
+
+	DestroyImageAndReturnIfErrors ("Error occuried while reading header", OpenContainer (&container, binary));
+
+	// compressed code is decompressed at once, as blocks are decoded from it while the program runs
+	DestroyImageAndReturnIfErrors ("Error occuried while reading code",
+									ReadSection (&container, CODE_SECTION, &image->code, &image->decompressedCode));
+
+	if (!image->code.buffer)
+		DestroyImageAndReturnIfErrors ("Binary has no code", WRONG_HEADER);
+
+	DestroyImageAndReturnIfErrors ("Error occuried while reading constants", ReadConstants (&container, image));
+
+	// debug lines are needed by debugger only, other optional sections are not used by the processor
+	if (IsDebugMode ())
+		DestroyImageAndReturnIfErrors ("Error occuried while reading debug info", ReadDebugInfo (&container, image));
+
+	// Debugger works with raw bytecode and tiered engine decodes hot blocks by itself.
+	// Other engines decode blocks when execution enters them, nothing is decoded here
+	bool decodeProgram = !IsDebugMode () && image->engine != TIERED_ENGINE;
+
+	DecodingOptions decodingOptions = {
+		.verify     = image->engine == UNCHECKED_ENGINE,
+		// stack caching engine executes fused sequences instruction by instruction
+		.fuse       = options->fuseInstructions && image->engine != CACHED_ENGINE,
+		.bindLabels = NULL,
+	};
+
+	if (image->engine == THREADED_ENGINE)
+		decodingOptions.bindLabels = BindThreadedLabels;
+
+	if (image->engine == CACHED_ENGINE)
+		decodingOptions.bindLabels = BindStackCachingLabels;
+
+	if (decodeProgram)
+		DestroyImageAndReturnIfErrors ("Error occuried while preparing decoded program",
+										InitDecodedProgram (&image->decodedProgram, &image->code, &decodingOptions));
+
+	// native code does not depend on a processor, so cores and runs of the image share it
+	if (decodeProgram && image->engine == JIT_ENGINE)
+		DestroyImageAndReturnIfErrors ("Error occuried while preparing native code", InitJitProgram (&image->jitProgram));
+
+	RETURN NO_PROCESSOR_ERRORS;
+
+	#undef DestroyImageAndReturnIfErrors
+}
+
+ProcessorErrorCode DestroyProgramImage (ProgramImage *image) {
+	PushLog (2);
+
+	custom_assert (image, pointer_is_null, NO_BUFFER);
+
+	if (image->isDebugInfoOwned) {
+		DestroyBuffer (&image->debugInfo);
+	}
+
+	DestroyJitProgram     (&image->jitProgram);
+	DestroyDecodedProgram (&image->decodedProgram);
+	DestroyBuffer (&image->decompressedCode);
+
+	image->debugInfo        = {0, 0, NULL};
+	image->hasDebugInfo     = false;
+	image->code             = {};
+	image->decompressedCode = {0, 0, NULL};
+	image->constants        = {};
+
+	RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode RunProgramImage (SPU *spu, ProgramImage *image) {
+	PushLog (1);
+
+	custom_assert (spu,   pointer_is_null, NO_PROCESSOR);
+	custom_assert (image, pointer_is_null, NO_BUFFER);
+
+	ProgramErrorCheck (InitExecutionContext (spu), "Error occuried while initializing processor");
+
+	spu->bytecode = image->code;
+
+	Buffer <DebugInfoChunk> breakpointsBuffer = {0, 0, NULL};
+	TextBuffer sourceText = {};
+
+	while (ExecuteProgram (spu, image, &breakpointsBuffer, &sourceText) != QUIT_PROGRAM) {};
+
+	DestroyExecutionContext (spu);
+
+	RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode LaunchProgram (SPU *spu, char *sourceFilename, char *binaryFilename, sf::Mutex *workMutex, ExecutionOptions *options) {
   	PushLog (1);
 
 	#define FreeDataAndReturnIfErrors(message, ...)									\
@@ -54,10 +184,9 @@ ProcessorErrorCode LaunchProgram (SPU *spu, char *sourceFilename, char *binaryFi
 					workMutex->lock ();												\
 					spu->isWorking = false;											\
 					workMutex->unlock ();											\
-					StackDestruct_ (&spu->processorStack);							\
-					StackDestruct_ (&spu->callStack);								\
-					DestroyBuffer  (&debugInfoBuffer);								\
-					free (spu->ram);												\
+					DestroyMultiCore (&machine);									\
+					DestroyExecutionContext (spu);									\
+					DestroyProgramImage (&image);									\
 					DestroyFileBuffer (&sourceData);								\
 					DestroyBuffer (&breakpointsBuffer);								\
 					free (sourceText.lines);										\
@@ -69,36 +198,45 @@ ProcessorErrorCode LaunchProgram (SPU *spu, char *sourceFilename, char *binaryFi
 	spu->isWorking = true;
 	workMutex->unlock ();
 
-	Buffer <DebugInfoChunk> debugInfoBuffer  = {0, 0, NULL};
 	Buffer <DebugInfoChunk> breakpointsBuffer = {0, 0, NULL};
-	Header header = {};
+	ProgramImage image = {};
+	MultiCore machine = {};
 	TextBuffer sourceText = {};
 	FileBuffer sourceData = {};
 
-	StackInitDefault_ (&spu->processorStack);
-	StackInitDefault_ (&spu->callStack);
-
-	spu->ram = (elem_t *) calloc (VRAM_SIZE + RAM_SIZE, sizeof (elem_t));
-	if (!spu->ram) {
-		FreeDataAndReturnIfErrors ("Can not allocate ram arrray", NO_BUFFER);
-	}
+	FreeDataAndReturnIfErrors ("Can not allocate ram arrray", InitExecutionContext (spu));
 
 	PrintSuccessMessage ("Reading header...", NULL);
 
-	FreeDataAndReturnIfErrors ("Error occuried while reading header", ReadHeader (spu, &header));
+	FreeDataAndReturnIfErrors ("Error occuried while loading program", LoadProgramImage (&image, &spu->bytecode, options));
+
+	spu->bytecode = image.code;
 
-	FreeDataAndReturnIfErrors ("Error occuried while reading debug info", ReadDebugInfo (spu, &debugInfoBuffer, &header, sourceFilename));
+	if (options->coresCount > 1 && IsDebugMode ()) {
+		PrintWarningMessage (NO_PROCESSOR_ERRORS, "Multi-core mode is not available in debug mode. Using one core.", NULL, NULL, -1);
+	} else if (options->coresCount > 1) {
+		FreeDataAndReturnIfErrors ("Error occuried while initializing cores", InitMultiCore (&machine, spu, &image, options->coresCount));
+	}
 
 	if (sourceFilename && IsDebugMode ())
 		FreeDataAndReturnIfErrors ("Error occuried while reading source file", ReadSourceFile (&sourceData, &sourceText, sourceFilename));
 
-	if (IsDebugMode () && (!sourceFilename || !header.hasDebugInfo)) {
+	if (IsDebugMode () && (!sourceFilename || !image.hasDebugInfo)) {
 		if (sourceFilename) {
 			free (sourceText.lines);
 			DestroyFileBuffer (&sourceData);
 		}
+
+		// disassembly lines replace debug info of the binary
+		if (image.isDebugInfoOwned) {
+			DestroyBuffer (&image.debugInfo);
+		}
+
+		image.debugInfo        = {0, 0, NULL};
+		image.isDebugInfoOwned = true;
+
 		FreeDataAndReturnIfErrors ("Error occuried while generating disassembly",
-										GenerateDisassembly (&sourceText, &sourceData, &debugInfoBuffer, binaryFilename));
+										GenerateDisassembly (&sourceText, &sourceData, &image.debugInfo, binaryFilename));
 	}
 
 	if (IsDebugMode ()) {
@@ -107,14 +245,21 @@ ProcessorErrorCode LaunchProgram (SPU *spu, char *sourceFilename, char *binaryFi
 
 		InitDebugConsole ();
 
-		if (DebugConsole (spu, &debugInfoBuffer, &breakpointsBuffer) == QUIT_PROGRAM) {
+		if (DebugConsole (spu, &image.debugInfo, &breakpointsBuffer) == QUIT_PROGRAM) {
 			FreeDataAndReturnIfErrors ("", PROCESSOR_HALT);
 		}
 	}
 
 	PrintSuccessMessage ("Starting execution...", NULL);
 
-	while (ExecuteProgram (spu, &debugInfoBuffer, &breakpointsBuffer, &sourceText) != QUIT_PROGRAM) {};
+	while (ExecuteProgram (spu, &image, &breakpointsBuffer, &sourceText) != QUIT_PROGRAM) {};
+
+	// program ends when all cores have stopped
+	if (spu->machine) {
+		StopMultiCore (&machine);
+	}
+
+	PrintDecodingStatistics (&image.decodedProgram);
 
   	FreeDataAndReturnIfErrors ("", PROCESSOR_HALT);
   	RETURN NO_PROCESSOR_ERRORS;
@@ -122,27 +267,68 @@ ProcessorErrorCode LaunchProgram (SPU *spu, char *sourceFilename, char *binaryFi
 	#undef FreeDataAndReturnIfErrors
 }
 
-static DebuggerAction ExecuteProgram (SPU *spu, Buffer <DebugInfoChunk> *debugInfoBuffer,
-										Buffer <DebugInfoChunk> *breakpointsBuffer, TextBuffer *sourceText) {
+static ProcessorErrorCode InitExecutionContext (SPU *spu) {
+	PushLog (2);
+
+	custom_assert (spu, pointer_is_null, NO_PROCESSOR);
+
+	StackInitDefault_ (&spu->processorStack);
+	StackInitDefault_ (&spu->callStack);
+
+	spu->ram = (elem_t *) calloc (VRAM_SIZE + RAM_SIZE, sizeof (elem_t));
+
+	if (!spu->ram) {
+		RETURN NO_BUFFER;
+	}
+
+	RETURN NO_PROCESSOR_ERRORS;
+}
+
+static void DestroyExecutionContext (SPU *spu) {
+	PushLog (2);
+
+	custom_assert (spu, pointer_is_null, (void) 0);
+
+	StackDestruct_ (&spu->processorStack);
+	StackDestruct_ (&spu->callStack);
+
+	free (spu->ram);
+	spu->ram = NULL;
+
+	RETURN;
+}
+
+static DebuggerAction ExecuteProgram (SPU *spu, ProgramImage *image, Buffer <DebugInfoChunk> *breakpointsBuffer, TextBuffer *sourceText) {
 	PushLog (1);
 
 	custom_assert (spu, 				  	pointer_is_null, QUIT_PROGRAM);
-	custom_assert (debugInfoBuffer, 	  	pointer_is_null, QUIT_PROGRAM);
+	custom_assert (image, 		  			pointer_is_null, QUIT_PROGRAM);
 	custom_assert (breakpointsBuffer, 	  	pointer_is_null, QUIT_PROGRAM);
 
 	spu->ip = 0;
 	spu->callStack.size      = 0;
 	spu->processorStack.size = 0;
+	spu->executedInstructions = 0;
+
+	memset (spu->ram, 0, (RAM_SIZE + VRAM_SIZE) * sizeof (elem_t));
+	LoadConstants (spu, image);
 
 	for (size_t ramIndex = 0; ramIndex < RAM_SIZE + VRAM_SIZE; ramIndex++) {
-		spu->ram [ramIndex] = 0;
 		UpdateGraphics (spu, ramIndex);
 	}
 
 	bool doStep = false;
 	ProcessorErrorCode errorCode = NO_PROCESSOR_ERRORS;
 
-	while ((errorCode = ReadInstruction (spu, breakpointsBuffer, debugInfoBuffer, sourceText, &doStep)) == NO_PROCESSOR_ERRORS) {};
+	if (IsDebugMode ()) {
+		while ((errorCode = ReadInstruction (spu, breakpointsBuffer, &image->debugInfo, sourceText, &doStep)) == NO_PROCESSOR_ERRORS) {};
+	} else {
+		errorCode = ExecuteProgramImage (spu, image);
+	}
+
+	if (spu->io) {
+		spu->io->status = errorCode;
+	}
 
 	if (errorCode == PROCESSOR_HALT) {
 		RETURN QUIT_PROGRAM;
@@ -153,6 +339,48 @@ static DebuggerAction ExecuteProgram (SPU *spu, Buffer <DebugInfoChunk> *debugIn
 	RETURN QUIT_PROGRAM;
 }
 
+ProcessorErrorCode ExecuteProgramImage (SPU *spu, ProgramImage *image) {
+	PushLog (1);
+
+	custom_assert (spu,   pointer_is_null, NO_PROCESSOR);
+	custom_assert (image, pointer_is_null, NO_BUFFER);
+
+	DecodedProgram  *decodedProgram  = &image->decodedProgram;
+	ExecutionEngine  engine          = image->engine;
+
+	ProcessorErrorCode errorCode = NO_PROCESSOR_ERRORS;
+
+	if (engine == THREADED_ENGINE) {
+		errorCode = ExecuteThreaded (spu, decodedProgram);
+	} else if (engine == SPECIALIZED_ENGINE) {
+		errorCode = ExecuteSpecialized (spu, decodedProgram);
+	} else if (engine == UNCHECKED_ENGINE) {
+		errorCode = ExecuteUnchecked (spu, decodedProgram);
+	} else if (engine == CACHED_ENGINE) {
+		errorCode = ExecuteStackCaching (spu, decodedProgram);
+	} else if (engine == TIERED_ENGINE) {
+		TieredCache tieredCache = {};
+
+		if ((errorCode = InitTieredCache (&tieredCache, (size_t) spu->bytecode.buffer_size)) == NO_PROCESSOR_ERRORS) {
+			errorCode = ExecuteTiered (spu, &tieredCache, InterpretInstruction);
+
+			PrintTieredStatistics (&tieredCache);
+			DestroyTieredCache    (&tieredCache);
+		}
+	} else if (engine == JIT_ENGINE) {
+		errorCode = ExecuteJit (spu, decodedProgram, &image->jitProgram);
+	} else {
+		DecodedInstruction *currentInstruction = NULL;
+
+		errorCode = GetDecodedInstruction (decodedProgram, spu->ip, &currentInstruction);
+		ProgramErrorCheck (errorCode, "Error occuried while decoding the first block");
+
+		while ((errorCode = ExecuteDecodedInstruction (spu, decodedProgram, &currentInstruction)) == NO_PROCESSOR_ERRORS) {};
+	}
+
+	RETURN errorCode;
+}
+
 static ProcessorErrorCode GenerateDisassembly (TextBuffer *disassemblyText, FileBuffer *disassemblyBuffer,
 												Buffer <DebugInfoChunk> *debugInfoBuffer, char *binaryFilepath) {
 	PushLog (2);
@@ -205,8 +433,9 @@ static ProcessorErrorCode GenerateDisassembly (TextBuffer *disassemblyText, File
 		DebugInfoChunk debugInfo = {};
 		int addressLength = 0;
 
+		// label lines have no address
 		if (sscanf (disassemblyText->lines [lineIndex].pointer, "%lu%n", &debugInfo.address, &addressLength) <= 0) {
-			break;
+			continue;
 		}
 
 		disassemblyText->lines [lineIndex].pointer += addressLength;
@@ -219,40 +448,71 @@ static ProcessorErrorCode GenerateDisassembly (TextBuffer *disassemblyText, File
 }
 
 
-static ProcessorErrorCode ReadHeader (SPU *spu, Header *readHeader) {
+// Blocks are checked once here, so they are copied to ram without checks before every run
+static ProcessorErrorCode ReadConstants (BinaryContainer *container, ProgramImage *image) {
 	PushLog (2);
 
-	custom_assert (spu, 	   pointer_is_null, NO_PROCESSOR);
-	custom_assert (readHeader, pointer_is_null, WRONG_HEADER);
+	custom_assert (container, pointer_is_null, NO_BUFFER);
+	custom_assert (image, 	  pointer_is_null, NO_BUFFER);
 
-	Header mainHeader {};
-    InitHeader (&mainHeader);
-    ReadData (spu, readHeader, Header);
+	ProgramErrorCheck (GetSection (container, CONSTANTS_SECTION, &image->constants), "Error occuried while reading constants section");
 
-	ShrinkBytecodeBuffer (spu, spu->ip);
+	for (size_t offset = 0; offset < (size_t) image->constants.buffer_size;) {
+		ConstantsBlock block  = {};
+		const char    *values = NULL;
 
-	RETURN CheckHeader (readHeader);
+		ProcessorErrorCode errorCode = ReadConstantsBlock (&image->constants, &offset, &block, &values);
+		ProgramErrorCheck (errorCode, "Constants section is corrupted");
+	}
+
+	RETURN NO_PROCESSOR_ERRORS;
 }
 
-static ProcessorErrorCode ReadDebugInfo (SPU *spu, Buffer <DebugInfoChunk> *debugInfoBuffer, Header *header, char *sourcePath) {
+static void LoadConstants (SPU *spu, ProgramImage *image) {
 	PushLog (2);
 
-	custom_assert (spu, 			pointer_is_null, NO_PROCESSOR);
-	custom_assert (debugInfoBuffer, pointer_is_null, NO_BUFFER);
-	custom_assert (header, 			pointer_is_null, WRONG_HEADER);
+	custom_assert (spu,   pointer_is_null, (void) 0);
+	custom_assert (image, pointer_is_null, (void) 0);
+
+	for (size_t offset = 0; offset < (size_t) image->constants.buffer_size;) {
+		ConstantsBlock block  = {};
+		const char    *values = NULL;
+
+		ReadConstantsBlock (&image->constants, &offset, &block, &values);
+		memcpy (spu->ram + block.address, values, block.size * sizeof (elem_t));
+	}
 
-	if (!header->hasDebugInfo) {
+	RETURN;
+}
+
+// Table is used right in the binary, as it is never changed. Copy is made only if the table is misaligned
+static ProcessorErrorCode ReadDebugInfo (BinaryContainer *container, ProgramImage *image) {
+	PushLog (2);
+
+	custom_assert (container, pointer_is_null, NO_BUFFER);
+	custom_assert (image, 	  pointer_is_null, NO_BUFFER);
+
+	FileBuffer section = {};
+	ProgramErrorCheck (GetSection (container, DEBUG_LINES_SECTION, &section), "Error occuried while reading debug lines section");
+
+	if (!section.buffer) {
 		RETURN NO_PROCESSOR_ERRORS;
 	}
 
-	ProgramErrorCheck (InitBuffer (debugInfoBuffer, header->commandsCount), "Error occuried while initializing debug info buffer");
-	ReadArrayData (spu, debugInfoBuffer->data, header->commandsCount, DebugInfoChunk);
+	size_t chunksCount = (size_t) section.buffer_size / sizeof (DebugInfoChunk);
 
-	if (sourcePath) {
-		debugInfoBuffer->currentIndex = debugInfoBuffer->capacity;
+	if ((uintptr_t) section.buffer % alignof (DebugInfoChunk) == 0) {
+		image->debugInfo.data = (DebugInfoChunk *) section.buffer;
+	} else {
+		ProgramErrorCheck (InitBuffer (&image->debugInfo, chunksCount + 1), "Error occuried while initializing debug info buffer");
+		image->isDebugInfoOwned = true;
+
+		memcpy (image->debugInfo.data, section.buffer, chunksCount * sizeof (DebugInfoChunk));
 	}
 
-	ShrinkBytecodeBuffer (spu, spu->ip);
+	image->debugInfo.capacity     = chunksCount;
+	image->debugInfo.currentIndex = chunksCount;
+	image->hasDebugInfo           = true;
 
 	RETURN NO_PROCESSOR_ERRORS;
 }
@@ -307,6 +567,8 @@ static ProcessorErrorCode ReadInstruction (SPU *spu, Buffer <DebugInfoChunk> *br
 
 	GetArgumentsPointer (spu, instruction, &commandCode, &argumentPointer);
 
+	spu->executedInstructions++;
+
 	ON_DEBUG (
         char message [MAX_MESSAGE_LENGTH] = "";
         sprintf (message, "Reading command %s", instruction->instructionName);
@@ -322,11 +584,20 @@ static ProcessorErrorCode ReadInstruction (SPU *spu, Buffer <DebugInfoChunk> *br
 	RETURN operationErrorCode;
 }
 
+// Cold code of the tiered engine runs in the same way as in the regular interpreter
+static ProcessorErrorCode InterpretInstruction (SPU *spu) {
+	PushLog (2);
+
+	bool doStep = false;
+
+	RETURN ReadInstruction (spu, NULL, NULL, NULL, &doStep);
+}
+
 static ProcessorErrorCode GetArgumentsPointer (SPU *spu, const AssemblerInstruction *instruction,
 												const CommandCode *commandCode, elem_t **argumentPointer) {
 	PushLog (2);
 
-	if ((~instruction->commandCode.arguments) & commandCode->arguments) {
+	if (!IsPermittedArguments (instruction->commandCode.arguments, commandCode->arguments)) {
 		ProgramErrorCheck (WRONG_INSTRUCTION, "Instruction does not takes this set of arguments");
 	}
 
@@ -341,7 +612,7 @@ static ProcessorErrorCode GetArgumentsPointer (SPU *spu, const AssemblerInstruct
 			commandCode->arguments == (IMMED_ARGUMENT | REGISTER_ARGUMENT | MEMORY_ARGUMENT)) {
 
 		ReadData (spu, &registerIndex, unsigned char);
-		ReadData (spu, &immedArgument, elem_t);
+		ReadImmediateData (spu, &immedArgument);
 
 		spu->tmpArgument = spu->registerValues [registerIndex] + immedArgument;
 
@@ -352,29 +623,119 @@ static ProcessorErrorCode GetArgumentsPointer (SPU *spu, const AssemblerInstruct
 
 		*argumentPointer = (spu->registerValues + registerIndex);
 	} else if (commandCode->arguments & IMMED_ARGUMENT) {
-		ReadData (spu, &spu->tmpArgument, elem_t);
+		ReadImmediateData (spu, &spu->tmpArgument);
 
 		*argumentPointer = &spu->tmpArgument;
 	}
 
 	if (commandCode->arguments & MEMORY_ARGUMENT) {
-		if (spu->frequencySleep > 0) {
-			usleep (spu->frequencySleep);
-		}
+		RETURN GetMemoryArgumentPointer (spu, argumentPointer);
+	}
+
+	RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode ExecuteDecodedInstruction (SPU *spu, DecodedProgram *decodedProgram, DecodedInstruction **currentInstruction) {
+	PushLog (2);
+
+	custom_assert (spu, 				pointer_is_null, NO_PROCESSOR);
+	custom_assert (decodedProgram, 		pointer_is_null, NO_BUFFER);
+	custom_assert (currentInstruction, 	pointer_is_null, NO_BUFFER);
 
-		if ((ssize_t) **argumentPointer < 0 || (ssize_t) **argumentPointer >= (ssize_t) (RAM_SIZE + VRAM_SIZE)) {
-			ProgramErrorCheck (TOO_FEW_ARGUMENTS, "Wrong memory address access attempt");
+	DecodedInstruction *instruction = *currentInstruction;
+
+	// next block is decoded when execution reaches it for the first time
+	if (!instruction->instruction) {
+		if (instruction->address >= decodedProgram->bytecodeSize) {
+			RETURN BUFFER_ENDED;
 		}
 
-		*argumentPointer = (spu->ram + (size_t) **argumentPointer);
+		ProcessorErrorCode blockErrorCode = GetDecodedInstruction (decodedProgram, instruction->address, currentInstruction);
+		ProgramErrorCheck (blockErrorCode, "Error occuried while decoding the next block");
+
+		RETURN NO_PROCESSOR_ERRORS;
+	}
+
+	// superinstructions never jump, so execution continues right after the fused sequence
+	if (instruction->fusedHandler) {
+		DecodedInstruction *nextInstruction = instruction + instruction->fusedLength;
+		spu->ip = nextInstruction->address;
+
+		spu->executedInstructions += instruction->fusedLength;
+
+		ProcessorErrorCode fusedErrorCode = instruction->fusedHandler (spu, instruction);
+
+		*currentInstruction = nextInstruction;
+
+		RETURN fusedErrorCode;
+	}
+
+	// ip points to the next instruction during callback execution, as it does in ReadInstruction
+	size_t nextAddress = (instruction + 1)->address;
+	spu->ip = nextAddress;
+	spu->executedInstructions++;
+
+	elem_t *argumentPointer = NULL;
+
+	ProgramErrorCheck (GetDecodedArgumentPointer (spu, instruction, &argumentPointer), "Error occuried while getting instruction argument");
+
+	ON_DEBUG (
+        char message [MAX_MESSAGE_LENGTH] = "";
+        sprintf (message, "Executing command %s", instruction->instruction->instructionName);
+        PrintInfoMessage (message, NULL);
+	)
+
+	ProcessorErrorCode operationErrorCode = instruction->instruction->callbackFunction (spu, &instruction->commandCode, argumentPointer);
+
+	if (instruction->commandCode.arguments & MEMORY_ARGUMENT) {
+		ProgramErrorCheck(UpdateGraphics (spu, (size_t) (argumentPointer - spu->ram)), "Error occuried while updating graphics");
+	}
+
+	if (spu->ip == nextAddress) {
+		*currentInstruction = instruction + 1;
+	} else {
+		ProcessorErrorCode jumpErrorCode = GetDecodedInstruction (decodedProgram, spu->ip, currentInstruction);
+		ProgramErrorCheck (jumpErrorCode, "Error occuried while decoding jump target");
+	}
+
+	RETURN operationErrorCode;
+}
+
+static ProcessorErrorCode GetDecodedArgumentPointer (SPU *spu, DecodedInstruction *instruction, elem_t **argumentPointer) {
+	PushLog (2);
+
+	if (instruction->commandCode.arguments == NO_ARGUMENTS) {
+		RETURN NO_PROCESSOR_ERRORS;
+	}
+
+	*argumentPointer = ResolveDecodedArgument (spu, instruction);
+
+	if (!*argumentPointer) {
+		ProgramErrorCheck (TOO_FEW_ARGUMENTS, "Wrong memory address access attempt");
 	}
 
 	RETURN NO_PROCESSOR_ERRORS;
 }
 
+static ProcessorErrorCode GetMemoryArgumentPointer (SPU *spu, elem_t **argumentPointer) {
+	PushLog (3);
+
+	if (spu->frequencySleep > 0) {
+		usleep (spu->frequencySleep);
+	}
+
+	if ((ssize_t) **argumentPointer < 0 || (ssize_t) **argumentPointer >= (ssize_t) (RAM_SIZE + VRAM_SIZE)) {
+		ProgramErrorCheck (TOO_FEW_ARGUMENTS, "Wrong memory address access attempt");
+	}
+
+	*argumentPointer = (spu->ram + (size_t) **argumentPointer);
+
+	RETURN NO_PROCESSOR_ERRORS;
+}
+
 // Processor instructions
 
-#define INSTRUCTION(NAME, COMMAND_CODE, PROCESSOR_CALLBACK, ...) 	\
+#define INSTRUCTION(NAME, COMMAND_CODE, FLOW, PROCESSOR_CALLBACK, ...) \
             INSTRUCTION_CALLBACK_FUNCTION (NAME) {               	\
                 PushLog (3);                                     	\
                 CheckBuffer (spu);                               	\
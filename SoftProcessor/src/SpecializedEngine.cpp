@@ -0,0 +1,247 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "SpecializedEngine.h"
+#include "ColorConsole.h"
+#include "CommonModules.h"
+#include "CustomAssert.h"
+#include "GraphicsProvider.h"
+#include "InstructionDecoder.h"
+#include "Logger.h"
+#include "MessageHandler.h"
+#include "MultiCore.h"
+#include "ProgramIO.h"
+#include "SecureStack/SecureStack.h"
+#include "SPU.h"
+#include "Stack/Stack.h"
+#include "Stack/StackPrintf.h"
+#include "DSLFunctions.h"
+
+struct SpecializedHandlersTable {
+    specializedHandler_t handlers         [HANDLERS_TABLE_SIZE] = {};
+    specializedHandler_t verifiedHandlers [HANDLERS_TABLE_SIZE] = {};     // used by unchecked engine for verified instructions
+};
+
+static SpecializedHandlersTable CreateHandlersTable ();
+static ProcessorErrorCode       WrongInstructionHandler (SPU *spu, DecodedInstruction *instruction);
+
+template <bool UNCHECKED>
+static ProcessorErrorCode ExecuteDecoded (SPU *spu, DecodedProgram *decodedProgram);
+
+// Verified instructions have static jump targets, that were checked by the verifier
+#undef Jump
+#define Jump(spu, jmpAddress)                                                                                       \
+            do {                                                                                                    \
+                if constexpr (!VERIFIED) {                                                                          \
+                    if ((ssize_t) jmpAddress >= (spu)->bytecode.buffer_size || jmpAddress < 0) {                    \
+                        ProgramErrorCheck (WRONG_ADDRESS, "Out of buffer jump attempt");                            \
+                    }                                                                                               \
+                }                                                                                                   \
+                (spu)->ip = (size_t) jmpAddress;                                                                    \
+            } while (0)
+
+// Immediate operands are stored in a handler's local variable instead of spu->tmpArgument
+template <unsigned char ARGUMENTS, bool VERIFIED>
+inline elem_t *FetchArgument (SPU *spu, DecodedInstruction *instruction, elem_t *argumentValue) {
+    elem_t *argument = NULL;
+
+    if constexpr ((ARGUMENTS & (IMMED_ARGUMENT | REGISTER_ARGUMENT)) == (IMMED_ARGUMENT | REGISTER_ARGUMENT)) {
+        *argumentValue = spu->registerValues [instruction->registerIndex] + instruction->immedArgument;
+        argument       = argumentValue;
+
+    } else if constexpr (ARGUMENTS & REGISTER_ARGUMENT) {
+        argument       = spu->registerValues + instruction->registerIndex;
+
+    } else if constexpr (ARGUMENTS & IMMED_ARGUMENT) {
+        *argumentValue = instruction->immedArgument;
+        argument       = argumentValue;
+    }
+
+    if constexpr (ARGUMENTS & MEMORY_ARGUMENT) {
+        if (spu->frequencySleep > 0) {
+            usleep (spu->frequencySleep);
+        }
+
+        ssize_t address = (ssize_t) *argument;
+
+        if constexpr (!VERIFIED) {
+            if (address < 0 || address >= (ssize_t) (RAM_SIZE + VRAM_SIZE)) {
+                return NULL;
+            }
+        }
+
+        argument = spu->ram + address;
+    }
+
+    return argument;
+}
+
+// Every instruction gets a handler template, instantiated for each arguments mode it accepts.
+// VERIFIED handlers skip checks of static operands and jump targets
+#define INSTRUCTION(NAME, COMMAND_CODE, FLOW, PROCESSOR_CALLBACK, ...)                                                  \
+            constexpr CommandCode NAME##CommandCode = COMMAND_CODE;                                                     \
+                                                                                                                        \
+            template <unsigned char ARGUMENTS, bool VERIFIED>                                                           \
+            static ProcessorErrorCode NAME##Specialized (SPU *spu, DecodedInstruction *instruction) {                   \
+                if constexpr (!IsPermittedArguments (NAME##CommandCode.arguments, ARGUMENTS)) {                         \
+                    return WrongInstructionHandler (spu, instruction);                                                  \
+                } else {                                                                                                \
+                    PushLog (3);                                                                                        \
+                    elem_t  argumentValue = NAN;                                                                        \
+                    elem_t *argument      = FetchArgument <ARGUMENTS, VERIFIED> (spu, instruction, &argumentValue);     \
+                    (void) argument;                                                                                    \
+                    if constexpr ((ARGUMENTS & MEMORY_ARGUMENT) && !VERIFIED) {                                         \
+                        if (!argument) {                                                                                \
+                            ProgramErrorCheck (TOO_FEW_ARGUMENTS, "Wrong memory address access attempt");               \
+                        }                                                                                               \
+                    }                                                                                                   \
+                    do                                                                                                  \
+                    PROCESSOR_CALLBACK                                                                                  \
+                    while (0);                                                                                          \
+                    if constexpr (ARGUMENTS & MEMORY_ARGUMENT) {                                                        \
+                        ProgramErrorCheck (UpdateGraphics (spu, (size_t) (argument - spu->ram)),                        \
+                                            "Error occuried while updating graphics");                                  \
+                    }                                                                                                   \
+                    RETURN NO_PROCESSOR_ERRORS;                                                                         \
+                }                                                                                                       \
+            }
+
+#include "Instructions.def"
+
+#undef INSTRUCTION
+
+ProcessorErrorCode ExecuteSpecialized (SPU *spu, DecodedProgram *decodedProgram) {
+    return ExecuteDecoded <false> (spu, decodedProgram);
+}
+
+ProcessorErrorCode ExecuteUnchecked (SPU *spu, DecodedProgram *decodedProgram) {
+    return ExecuteDecoded <true> (spu, decodedProgram);
+}
+
+specializedHandler_t GetSpecializedHandler (CommandCode commandCode, bool verified) {
+    static const SpecializedHandlersTable HandlersTable = CreateHandlersTable ();
+
+    if (verified) {
+        return HandlersTable.verifiedHandlers [GetRawCommandCode (commandCode)];
+    }
+
+    return HandlersTable.handlers [GetRawCommandCode (commandCode)];
+}
+
+template <bool UNCHECKED>
+static ProcessorErrorCode ExecuteDecoded (SPU *spu, DecodedProgram *decodedProgram) {
+    PushLog (1);
+
+    custom_assert (spu,                   pointer_is_null, NO_PROCESSOR);
+    custom_assert (decodedProgram,        pointer_is_null, NO_BUFFER);
+    custom_assert (decodedProgram->slots, pointer_is_null, NO_BUFFER);
+
+    static const SpecializedHandlersTable HandlersTable = CreateHandlersTable ();
+
+    DecodedInstruction *currentInstruction = NULL;
+
+    ProcessorErrorCode startErrorCode = GetDecodedInstruction (decodedProgram, spu->ip, &currentInstruction);
+    ProgramErrorCheck (startErrorCode, "Error occuried while decoding the first block");
+
+    while (true) {
+        // next block is decoded when execution reaches it for the first time
+        if (!currentInstruction->instruction) {
+            if (currentInstruction->address >= decodedProgram->bytecodeSize) {
+                break;
+            }
+
+            ProcessorErrorCode blockErrorCode = GetDecodedInstruction (decodedProgram, currentInstruction->address, &currentInstruction);
+            ProgramErrorCheck (blockErrorCode, "Error occuried while decoding the next block");
+
+            continue;
+        }
+
+        DecodedInstruction *nextInstruction = currentInstruction + currentInstruction->fusedLength;
+        spu->ip = nextInstruction->address;
+        spu->executedInstructions += currentInstruction->fusedLength;
+
+        specializedHandler_t handler = currentInstruction->fusedHandler;
+
+        if (!handler) {
+            if (UNCHECKED && currentInstruction->verified) {
+                handler = HandlersTable.verifiedHandlers [GetRawCommandCode (currentInstruction->commandCode)];
+            } else {
+                handler = HandlersTable.handlers         [GetRawCommandCode (currentInstruction->commandCode)];
+            }
+        }
+
+        ProcessorErrorCode errorCode = handler (spu, currentInstruction);
+
+        if (errorCode != NO_PROCESSOR_ERRORS) {
+            RETURN errorCode;
+        }
+
+        if (spu->ip == nextInstruction->address) {
+            currentInstruction = nextInstruction;
+            continue;
+        }
+
+        // verified instruction changes ip only by jumping to its argument, so the target is looked up once.
+        // Processors may store it at the same time, but they store the same value
+        DecodedInstruction *jumpTarget = NULL;
+
+        if (UNCHECKED) {
+            jumpTarget = __atomic_load_n (&currentInstruction->jumpTarget, __ATOMIC_ACQUIRE);
+        }
+
+        if (jumpTarget) {
+            currentInstruction = jumpTarget;
+            continue;
+        }
+
+        DecodedInstruction *jumpInstruction = currentInstruction;
+
+        ProcessorErrorCode jumpErrorCode = GetDecodedInstruction (decodedProgram, spu->ip, &currentInstruction);
+        ProgramErrorCheck (jumpErrorCode, "Error occuried while decoding jump target");
+
+        if (UNCHECKED && jumpInstruction->verified) {
+            __atomic_store_n (&jumpInstruction->jumpTarget, currentInstruction, __ATOMIC_RELEASE);
+        }
+    }
+
+    RETURN BUFFER_ENDED;
+}
+
+static SpecializedHandlersTable CreateHandlersTable () {
+    PushLog (3);
+
+    SpecializedHandlersTable table = {};
+
+    for (size_t handlerIndex = 0; handlerIndex < HANDLERS_TABLE_SIZE; handlerIndex++) {
+        table.handlers         [handlerIndex] = WrongInstructionHandler;
+        table.verifiedHandlers [handlerIndex] = WrongInstructionHandler;
+    }
+
+    #define SPECIALIZE_(NAME, ARGUMENTS)                                                                \
+                do {                                                                                    \
+                    CommandCode commandCode = {NAME##CommandCode.opcode, ARGUMENTS};                    \
+                    table.handlers         [GetRawCommandCode (commandCode)] = NAME##Specialized <ARGUMENTS, false>;  \
+                    table.verifiedHandlers [GetRawCommandCode (commandCode)] = NAME##Specialized <ARGUMENTS, true>;   \
+                } while (0);
+
+    #define INSTRUCTION(NAME, ...)                                                                      \
+                SPECIALIZE_ (NAME, 0) SPECIALIZE_ (NAME, 1) SPECIALIZE_ (NAME, 2) SPECIALIZE_ (NAME, 3) \
+                SPECIALIZE_ (NAME, 4) SPECIALIZE_ (NAME, 5) SPECIALIZE_ (NAME, 6) SPECIALIZE_ (NAME, 7)
+
+    #include "Instructions.def"
+
+    #undef INSTRUCTION
+    #undef SPECIALIZE_
+
+    RETURN table;
+}
+
+static ProcessorErrorCode WrongInstructionHandler (SPU *spu, DecodedInstruction *instruction) {
+    PushLog (3);
+
+    ProgramErrorCheck (WRONG_INSTRUCTION, "Wrong instruction readed");
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
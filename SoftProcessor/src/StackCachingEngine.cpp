@@ -0,0 +1,291 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "StackCachingEngine.h"
+#include "ColorConsole.h"
+#include "CommonModules.h"
+#include "CustomAssert.h"
+#include "GraphicsProvider.h"
+#include "InstructionDecoder.h"
+#include "Logger.h"
+#include "MessageHandler.h"
+#include "MultiCore.h"
+#include "ProgramIO.h"
+#include "SecureStack/SecureStack.h"
+#include "SPU.h"
+#include "Stack/Stack.h"
+#include "Stack/StackPrintf.h"
+#include "DSLFunctions.h"
+
+static ProcessorErrorCode RunStackCaching (SPU *spu, DecodedProgram *decodedProgram, StackCache *cache,
+                                            DecodedInstruction *instructions, size_t instructionsCount);
+
+static ProcessorErrorCode GrowStackCache  (StackCache *cache, size_t minCapacity);
+static ProcessorErrorCode FillStackCache  (SPU *spu, StackCache *cache);
+static ProcessorErrorCode SpillStackCache (SPU *spu, StackCache *cache);
+
+// Cache state is copied to locals of RunStackCaching, so the compiler can keep it in registers.
+// Locals are written back by destructor, as instruction bodies return from any place
+struct StackCacheWriteBack {
+    StackCache *cache;
+    elem_t     *topValue;
+    size_t     *stackSize;
+
+    StackCacheWriteBack (StackCache *cacheToUpdate, elem_t *cachedTopValue, size_t *cachedStackSize) :
+        cache (cacheToUpdate), topValue (cachedTopValue), stackSize (cachedStackSize) {}
+
+    StackCacheWriteBack            (const StackCacheWriteBack &) = delete;
+    StackCacheWriteBack &operator= (const StackCacheWriteBack &) = delete;
+
+    ~StackCacheWriteBack () {
+        cache->topValue = *topValue;
+        cache->size     = *stackSize;
+    }
+};
+
+// Instructions.def bodies work with the cache instead of the stack library
+#undef PushValue
+#undef PopValue
+
+#define PushValue(spu, value)                                                                                       \
+            do {                                                                                                    \
+                elem_t pushedValue_ = (value);                                                                      \
+                if (stackSize > 0) {                                                                                \
+                    if (stackSize >= stackCapacity) {                                                               \
+                        ProcessorErrorCode growErrorCode_ = GrowStackCache (cache, stackSize + 1);                  \
+                        ProgramErrorCheck (growErrorCode_, "Error occuried while growing stack cache");             \
+                        stackValues   = cache->values;                                                              \
+                        stackCapacity = cache->capacity;                                                            \
+                    }                                                                                               \
+                    stackValues [stackSize - 1] = topValue;                                                         \
+                }                                                                                                   \
+                topValue = pushedValue_;                                                                            \
+                stackSize++;                                                                                        \
+            } while (0)
+
+#define PopValue(spu, destination)                                                                                  \
+            do {                                                                                                    \
+                if (stackSize == 0) {                                                                               \
+                    ProgramErrorCheck (STACK_ERROR, "Stack error occuried while poping value");                     \
+                }                                                                                                   \
+                *(destination) = topValue;                                                                          \
+                stackSize--;                                                                                        \
+                if (stackSize > 0) {                                                                                \
+                    topValue = stackValues [stackSize - 1];                                                         \
+                }                                                                                                   \
+            } while (0)
+
+ProcessorErrorCode BindStackCachingLabels (DecodedInstruction *instructions, size_t instructionsCount) {
+    PushLog (2);
+
+    custom_assert (instructions, pointer_is_null, NO_BUFFER);
+
+    RETURN RunStackCaching (NULL, NULL, NULL, instructions, instructionsCount);
+}
+
+ProcessorErrorCode ExecuteStackCaching (SPU *spu, DecodedProgram *decodedProgram) {
+    PushLog (1);
+
+    custom_assert (spu,                   pointer_is_null, NO_PROCESSOR);
+    custom_assert (decodedProgram,        pointer_is_null, NO_BUFFER);
+    custom_assert (decodedProgram->slots, pointer_is_null, NO_BUFFER);
+
+    StackCache cache = {};
+
+    ProcessorErrorCode errorCode = FillStackCache (spu, &cache);
+
+    if (errorCode == NO_PROCESSOR_ERRORS) {
+        errorCode = RunStackCaching (spu, decodedProgram, &cache, NULL, 0);
+    }
+
+    // stack has to be visible for the debugger and error dumps whatever the execution result is
+    ProcessorErrorCode spillErrorCode = SpillStackCache (spu, &cache);
+    free (cache.values);
+
+    if (errorCode != NO_PROCESSOR_ERRORS) {
+        RETURN errorCode;
+    }
+
+    ProgramErrorCheck (spillErrorCode, "Error occuried while moving stack cache to processor stack");
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Same dispatch as in threaded engine. Superinstructions are not used: they work with spu->processorStack
+// and the cache already removes most of the stack traffic they save
+static ProcessorErrorCode RunStackCaching (SPU *spu, DecodedProgram *decodedProgram, StackCache *cache,
+                                            DecodedInstruction *instructions, size_t instructionsCount) {
+    PushLog (1);
+
+    const void *instructionLabels [OPCODES_COUNT] = {};
+
+    for (size_t opcode = 0; opcode < OPCODES_COUNT; opcode++) {
+        instructionLabels [opcode] = &&WrongInstruction;
+    }
+
+    #define INSTRUCTION(NAME, COMMAND_CODE, ...) \
+                instructionLabels [((CommandCode) COMMAND_CODE).opcode] = &&NAME##Label;
+
+    #include "Instructions.def"
+
+    #undef INSTRUCTION
+
+    // without spu labels are only bound to the block and its sentinel, as in threaded engine
+    if (!spu) {
+        for (size_t instructionIndex = 0; instructionIndex <= instructionsCount; instructionIndex++) {
+            DecodedInstruction *instruction = instructions + instructionIndex;
+
+            if (instruction->instruction) {
+                instruction->threadedLabel = instructionLabels [instruction->commandCode.opcode];
+            } else {
+                instruction->threadedLabel = &&BlockEnd;
+            }
+        }
+
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    elem_t  topValue      = cache->topValue;
+    size_t  stackSize     = cache->size;
+    elem_t *stackValues   = cache->values;
+    size_t  stackCapacity = cache->capacity;
+
+    StackCacheWriteBack writeBack (cache, &topValue, &stackSize);
+
+    DecodedInstruction *currentInstruction = NULL;
+    DecodedInstruction *nextInstruction    = NULL;
+    CommandCode        *commandCode        = NULL;
+    elem_t             *argument           = NULL;
+
+    ProcessorErrorCode startErrorCode = GetDecodedInstruction (decodedProgram, spu->ip, &currentInstruction);
+    ProgramErrorCheck (startErrorCode, "Error occuried while decoding the first block");
+
+    if (!currentInstruction->threadedLabel) {
+        ProgramErrorCheck (NO_BUFFER, "Threaded labels are not bound");
+    }
+
+    #define DISPATCH_()                                                                                 \
+                do {                                                                                    \
+                    if (spu->ip == nextInstruction->address) {                                          \
+                        currentInstruction = nextInstruction;                                           \
+                    } else {                                                                            \
+                        ProcessorErrorCode jumpErrorCode_ =                                             \
+                            GetDecodedInstruction (decodedProgram, spu->ip, &currentInstruction);       \
+                        ProgramErrorCheck (jumpErrorCode_, "Error occuried while decoding jump target");\
+                    }                                                                                   \
+                    goto *currentInstruction->threadedLabel;                                            \
+                } while (0)
+
+    #define INSTRUCTION(NAME, COMMAND_CODE, FLOW, PROCESSOR_CALLBACK, ...)                              \
+                NAME##Label: {                                                                          \
+                    nextInstruction = currentInstruction + 1;                                           \
+                    commandCode     = &currentInstruction->commandCode;                                 \
+                    spu->ip         = nextInstruction->address;                                         \
+                    spu->executedInstructions++;                                                        \
+                    if (commandCode->arguments != NO_ARGUMENTS) {                                       \
+                        argument = ResolveDecodedArgument (spu, currentInstruction);                    \
+                        if (!argument) {                                                                \
+                            ProgramErrorCheck (TOO_FEW_ARGUMENTS, "Wrong memory address access attempt");\
+                        }                                                                               \
+                    }                                                                                   \
+                    do                                                                                  \
+                    PROCESSOR_CALLBACK                                                                  \
+                    while (0);                                                                          \
+                    if (commandCode->arguments & MEMORY_ARGUMENT) {                                     \
+                        ProgramErrorCheck (UpdateGraphics (spu, (size_t) (argument - spu->ram)),        \
+                                            "Error occuried while updating graphics");                  \
+                    }                                                                                   \
+                    DISPATCH_ ();                                                                       \
+                }
+
+    goto *currentInstruction->threadedLabel;
+
+    #include "Instructions.def"
+
+    #undef INSTRUCTION
+    #undef DISPATCH_
+
+    WrongInstruction:
+        ProgramErrorCheck (WRONG_INSTRUCTION, "Wrong instruction readed");
+
+    BlockEnd: {
+        if (currentInstruction->address >= decodedProgram->bytecodeSize) {
+            RETURN BUFFER_ENDED;
+        }
+
+        ProcessorErrorCode blockErrorCode = GetDecodedInstruction (decodedProgram, currentInstruction->address, &currentInstruction);
+        ProgramErrorCheck (blockErrorCode, "Error occuried while decoding the next block");
+
+        goto *currentInstruction->threadedLabel;
+    }
+}
+
+static ProcessorErrorCode GrowStackCache (StackCache *cache, size_t minCapacity) {
+    PushLog (3);
+
+    size_t capacity = cache->capacity > 0 ? cache->capacity : STACK_CACHE_MIN_CAPACITY;
+
+    while (capacity < minCapacity) {
+        capacity *= 2;
+    }
+
+    if (capacity == cache->capacity) {
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    elem_t *values = (elem_t *) realloc (cache->values, capacity * sizeof (elem_t));
+
+    if (!values) {
+        RETURN NO_BUFFER;
+    }
+
+    cache->values   = values;
+    cache->capacity = capacity;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode FillStackCache (SPU *spu, StackCache *cache) {
+    PushLog (3);
+
+    size_t stackSize = (size_t) spu->processorStack.size;
+
+    if (GrowStackCache (cache, stackSize) != NO_PROCESSOR_ERRORS) {
+        RETURN NO_BUFFER;
+    }
+
+    for (size_t stackIndex = stackSize; stackIndex > 0; stackIndex--) {
+        if (StackPop_ (&spu->processorStack, cache->values + stackIndex - 1) != NO_ERRORS) {
+            RETURN STACK_ERROR;
+        }
+    }
+
+    cache->size = stackSize;
+
+    if (stackSize > 0) {
+        cache->topValue = cache->values [stackSize - 1];
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode SpillStackCache (SPU *spu, StackCache *cache) {
+    PushLog (3);
+
+    if (cache->size > 0) {
+        cache->values [cache->size - 1] = cache->topValue;
+    }
+
+    for (size_t stackIndex = 0; stackIndex < cache->size; stackIndex++) {
+        if (StackPush_ (&spu->processorStack, cache->values [stackIndex]) != NO_ERRORS) {
+            RETURN STACK_ERROR;
+        }
+    }
+
+    cache->size = 0;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
@@ -0,0 +1,162 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "ThreadedEngine.h"
+#include "ColorConsole.h"
+#include "CommonModules.h"
+#include "CustomAssert.h"
+#include "GraphicsProvider.h"
+#include "InstructionDecoder.h"
+#include "Logger.h"
+#include "MessageHandler.h"
+#include "MultiCore.h"
+#include "ProgramIO.h"
+#include "SecureStack/SecureStack.h"
+#include "SPU.h"
+#include "Stack/Stack.h"
+#include "Stack/StackPrintf.h"
+#include "DSLFunctions.h"
+
+static ProcessorErrorCode RunThreaded (SPU *spu, DecodedProgram *decodedProgram, DecodedInstruction *instructions, size_t instructionsCount);
+
+ProcessorErrorCode BindThreadedLabels (DecodedInstruction *instructions, size_t instructionsCount) {
+    PushLog (2);
+
+    custom_assert (instructions, pointer_is_null, NO_BUFFER);
+
+    RETURN RunThreaded (NULL, NULL, instructions, instructionsCount);
+}
+
+ProcessorErrorCode ExecuteThreaded (SPU *spu, DecodedProgram *decodedProgram) {
+    PushLog (1);
+
+    custom_assert (spu,                   pointer_is_null, NO_PROCESSOR);
+    custom_assert (decodedProgram,        pointer_is_null, NO_BUFFER);
+    custom_assert (decodedProgram->slots, pointer_is_null, NO_BUFFER);
+
+    RETURN RunThreaded (spu, decodedProgram, NULL, 0);
+}
+
+// Whole interpreter lives in one function: every instruction from Instructions.def becomes a label
+// and decoded instructions store addresses of these labels, so dispatch is a single indirect jump.
+// Label addresses are available only inside this function, so without spu it just binds them to the block
+// of instructions and the sentinel after it
+static ProcessorErrorCode RunThreaded (SPU *spu, DecodedProgram *decodedProgram, DecodedInstruction *instructions, size_t instructionsCount) {
+    PushLog (1);
+
+    const void *instructionLabels [OPCODES_COUNT] = {};
+
+    for (size_t opcode = 0; opcode < OPCODES_COUNT; opcode++) {
+        instructionLabels [opcode] = &&WrongInstruction;
+    }
+
+    #define INSTRUCTION(NAME, COMMAND_CODE, ...) \
+                instructionLabels [((CommandCode) COMMAND_CODE).opcode] = &&NAME##Label;
+
+    #include "Instructions.def"
+
+    #undef INSTRUCTION
+
+    if (!spu) {
+        for (size_t instructionIndex = 0; instructionIndex <= instructionsCount; instructionIndex++) {
+            DecodedInstruction *instruction = instructions + instructionIndex;
+
+            if (instruction->fusedHandler) {
+                instruction->threadedLabel = &&FusedInstruction;
+            } else if (instruction->instruction) {
+                instruction->threadedLabel = instructionLabels [instruction->commandCode.opcode];
+            } else {
+                instruction->threadedLabel = &&BlockEnd;
+            }
+        }
+
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    DecodedInstruction *currentInstruction = NULL;
+    DecodedInstruction *nextInstruction    = NULL;
+    CommandCode        *commandCode        = NULL;
+    elem_t             *argument           = NULL;
+
+    ProcessorErrorCode startErrorCode = GetDecodedInstruction (decodedProgram, spu->ip, &currentInstruction);
+    ProgramErrorCheck (startErrorCode, "Error occuried while decoding the first block");
+
+    if (!currentInstruction->threadedLabel) {
+        ProgramErrorCheck (NO_BUFFER, "Threaded labels are not bound");
+    }
+
+    #define DISPATCH_()                                                                                 \
+                do {                                                                                    \
+                    if (spu->ip == nextInstruction->address) {                                          \
+                        currentInstruction = nextInstruction;                                           \
+                    } else {                                                                            \
+                        ProcessorErrorCode jumpErrorCode_ =                                             \
+                            GetDecodedInstruction (decodedProgram, spu->ip, &currentInstruction);       \
+                        ProgramErrorCheck (jumpErrorCode_, "Error occuried while decoding jump target");\
+                    }                                                                                   \
+                    goto *currentInstruction->threadedLabel;                                            \
+                } while (0)
+
+    #define INSTRUCTION(NAME, COMMAND_CODE, FLOW, PROCESSOR_CALLBACK, ...)                              \
+                NAME##Label: {                                                                          \
+                    nextInstruction = currentInstruction + 1;                                           \
+                    commandCode     = &currentInstruction->commandCode;                                 \
+                    spu->ip         = nextInstruction->address;                                         \
+                    spu->executedInstructions++;                                                        \
+                    if (commandCode->arguments != NO_ARGUMENTS) {                                       \
+                        argument = ResolveDecodedArgument (spu, currentInstruction);                    \
+                        if (!argument) {                                                                \
+                            ProgramErrorCheck (TOO_FEW_ARGUMENTS, "Wrong memory address access attempt");\
+                        }                                                                               \
+                    }                                                                                   \
+                    do                                                                                  \
+                    PROCESSOR_CALLBACK                                                                  \
+                    while (0);                                                                          \
+                    if (commandCode->arguments & MEMORY_ARGUMENT) {                                     \
+                        ProgramErrorCheck (UpdateGraphics (spu, (size_t) (argument - spu->ram)),        \
+                                            "Error occuried while updating graphics");                  \
+                    }                                                                                   \
+                    DISPATCH_ ();                                                                       \
+                }
+
+    goto *currentInstruction->threadedLabel;
+
+    #include "Instructions.def"
+
+    #undef INSTRUCTION
+    #undef DISPATCH_
+
+    // superinstructions never jump, so execution continues right after the fused sequence
+    FusedInstruction: {
+        nextInstruction = currentInstruction + currentInstruction->fusedLength;
+        spu->ip         = nextInstruction->address;
+
+        spu->executedInstructions += currentInstruction->fusedLength;
+
+        ProcessorErrorCode fusedErrorCode = currentInstruction->fusedHandler (spu, currentInstruction);
+
+        if (fusedErrorCode != NO_PROCESSOR_ERRORS) {
+            RETURN fusedErrorCode;
+        }
+
+        currentInstruction = nextInstruction;
+        goto *currentInstruction->threadedLabel;
+    }
+
+    WrongInstruction:
+        ProgramErrorCheck (WRONG_INSTRUCTION, "Wrong instruction readed");
+
+    // next block is decoded when execution reaches it for the first time
+    BlockEnd: {
+        if (currentInstruction->address >= decodedProgram->bytecodeSize) {
+            RETURN BUFFER_ENDED;
+        }
+
+        ProcessorErrorCode blockErrorCode = GetDecodedInstruction (decodedProgram, currentInstruction->address, &currentInstruction);
+        ProgramErrorCheck (blockErrorCode, "Error occuried while decoding the next block");
+
+        goto *currentInstruction->threadedLabel;
+    }
+}
@@ -0,0 +1,317 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "TieredEngine.h"
+#include "BytecodeVerifier.h"
+#include "CommonModules.h"
+#include "CustomAssert.h"
+#include "InstructionDecoder.h"
+#include "InstructionFusion.h"
+#include "Logger.h"
+#include "MessageHandler.h"
+#include "SpecializedEngine.h"
+#include "SPU.h"
+
+static ProcessorErrorCode TranslateBlock (SPU *spu, TieredCache *cache, size_t startAddress);
+static ProcessorErrorCode RunBlock       (SPU *spu, TranslatedBlock *block);
+static void               DestroyBlock   (TranslatedBlock *block);
+
+static TieredEntry       *FindTieredEntry    (TieredCache *cache, size_t address);
+static TieredEntry       *AddTieredEntry     (TieredCache *cache, size_t address);
+static InstructionFlow    GetInstructionFlow (SPU *spu, size_t address);
+
+ProcessorErrorCode InitTieredCache (TieredCache *cache, size_t bytecodeSize) {
+    PushLog (2);
+
+    custom_assert (cache, pointer_is_null, NO_BUFFER);
+
+    // only entered blocks are counted, so the table does not depend on the program size
+    cache->bytecodeSize    = bytecodeSize;
+    cache->entries         = (TieredEntry *) calloc (MIN_TIERED_ENTRIES, sizeof (TieredEntry));
+    cache->entriesCapacity = MIN_TIERED_ENTRIES;
+    cache->entriesCount    = 0;
+    cache->statistics      = {};
+
+    if (!cache->entries) {
+        DestroyTieredCache (cache);
+        ProgramErrorCheck (NO_BUFFER, "Error occuried while allocating translation cache");
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode DestroyTieredCache (TieredCache *cache) {
+    PushLog (2);
+
+    custom_assert (cache, pointer_is_null, NO_BUFFER);
+
+    if (cache->entries) {
+        for (size_t entryIndex = 0; entryIndex < cache->entriesCapacity; entryIndex++) {
+            DestroyBlock (cache->entries [entryIndex].block);
+        }
+    }
+
+    free (cache->entries);
+
+    cache->entries         = NULL;
+    cache->entriesCapacity = 0;
+    cache->entriesCount    = 0;
+    cache->bytecodeSize    = 0;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+ProcessorErrorCode ExecuteTiered (SPU *spu, TieredCache *cache, interpreterStep_t interpretInstruction) {
+    PushLog (1);
+
+    custom_assert (spu,                  pointer_is_null, NO_PROCESSOR);
+    custom_assert (cache,                pointer_is_null, NO_BUFFER);
+    custom_assert (interpretInstruction, pointer_is_null, NO_PROCESSOR);
+
+    ProcessorErrorCode errorCode = NO_PROCESSOR_ERRORS;
+    bool isBlockStart            = true;    // program start, jump target or instruction after conditional jump
+
+    while (errorCode == NO_PROCESSOR_ERRORS) {
+        size_t address = spu->ip;
+
+        if (address >= cache->bytecodeSize) {
+            RETURN BUFFER_ENDED;
+        }
+
+        TieredEntry *entry = FindTieredEntry (cache, address);
+
+        if (entry->isUsed && entry->block) {
+            cache->statistics.cacheHits++;
+
+            errorCode    = RunBlock (spu, entry->block);
+            isBlockStart = true;
+
+            continue;
+        }
+
+        if (isBlockStart && !entry->isUsed) {
+            entry = AddTieredEntry (cache, address);
+
+            if (!entry) {
+                ProgramErrorCheck (NO_BUFFER, "Error occuried while adding translation cache entry");
+            }
+        }
+
+        if (isBlockStart && ++entry->entriesCount == TIER_UP_THRESHOLD) {
+            cache->statistics.tierUps++;
+
+            ProgramErrorCheck (TranslateBlock (spu, cache, address), "Error occuried while translating block");
+
+            if (FindTieredEntry (cache, address)->block) {
+                continue;
+            }
+        }
+
+        isBlockStart = GetInstructionFlow (spu, address) != LINEAR_FLOW;
+        errorCode    = interpretInstruction (spu);
+    }
+
+    RETURN errorCode;
+}
+
+void PrintTieredStatistics (TieredCache *cache) {
+    PushLog (2);
+
+    custom_assert (cache, pointer_is_null, (void) 0);
+
+    char message [MAX_MESSAGE_LENGTH] = "";
+
+    snprintf (message, MAX_MESSAGE_LENGTH, "Tier-ups: %lu, blocks translated: %lu, cache hits: %lu",
+                cache->statistics.tierUps, cache->statistics.blocksTranslated, cache->statistics.cacheHits);
+    PrintInfoMessage (message, NULL);
+
+    PrintFusionStatistics (cache->statistics.fusedCounts);
+
+    RETURN;
+}
+
+// Block is decoded up to the first instruction that changes control flow. Blocks that can not be decoded
+// (wrong instruction or register) stay in the interpreter, so errors are reported the usual way
+static ProcessorErrorCode TranslateBlock (SPU *spu, TieredCache *cache, size_t startAddress) {
+    PushLog (2);
+
+    // one more instruction holds the address after the block
+    DecodedInstruction *instructions = (DecodedInstruction *) calloc (MAX_BLOCK_LENGTH + 1, sizeof (DecodedInstruction));
+    BlockOperation     *operations   = (BlockOperation *)     calloc (MAX_BLOCK_LENGTH,     sizeof (BlockOperation));
+
+    if (!instructions || !operations) {
+        free (instructions);
+        free (operations);
+        ProgramErrorCheck (NO_BUFFER, "Error occuried while allocating translated block");
+    }
+
+    size_t savedIp           = spu->ip;
+    size_t instructionsCount = 0;
+    size_t blockEnd          = startAddress;
+
+    spu->ip = startAddress;
+
+    while (instructionsCount < MAX_BLOCK_LENGTH && spu->ip < cache->bytecodeSize) {
+        DecodedInstruction instruction = {};
+
+        if (DecodeInstruction (spu, &instruction) != NO_PROCESSOR_ERRORS) {
+            break;
+        }
+
+        instructions [instructionsCount++] = instruction;
+        blockEnd = spu->ip;
+
+        if (instruction.instruction->flow != LINEAR_FLOW) {
+            break;
+        }
+    }
+
+    instructions [instructionsCount]         = {};
+    instructions [instructionsCount].address = blockEnd;
+
+    spu->ip = savedIp;
+
+    if (instructionsCount == 0) {
+        free (instructions);
+        free (operations);
+        RETURN NO_PROCESSOR_ERRORS;
+    }
+
+    FuseBlock (instructions, instructionsCount, cache->statistics.fusedCounts);
+
+    size_t operationsCount = 0;
+
+    for (size_t instructionIndex = 0; instructionIndex < instructionsCount; operationsCount++) {
+        DecodedInstruction *instruction = instructions + instructionIndex;
+        BlockOperation     *operation   = operations   + operationsCount;
+
+        operation->instruction = instruction;
+        operation->handler     = instruction->fusedHandler;
+
+        if (!operation->handler) {
+            operation->handler = GetSpecializedHandler (instruction->commandCode, VerifyInstruction (instruction, cache->bytecodeSize));
+        }
+
+        instructionIndex      += instruction->fusedLength;
+        operation->nextAddress = instructions [instructionIndex].address;
+    }
+
+    TranslatedBlock *block = (TranslatedBlock *) calloc (1, sizeof (TranslatedBlock));
+
+    if (!block) {
+        free (instructions);
+        free (operations);
+        ProgramErrorCheck (NO_BUFFER, "Error occuried while allocating translated block");
+    }
+
+    block->instructions    = instructions;
+    block->operations      = operations;
+    block->operationsCount = operationsCount;
+
+    FindTieredEntry (cache, startAddress)->block = block;
+    cache->statistics.blocksTranslated++;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Only the last operation can change ip, the others continue with the next one
+static ProcessorErrorCode RunBlock (SPU *spu, TranslatedBlock *block) {
+    PushLog (2);
+
+    BlockOperation *operation     = block->operations;
+    BlockOperation *lastOperation = block->operations + block->operationsCount;
+
+    for (; operation < lastOperation; operation++) {
+        spu->ip = operation->nextAddress;
+        spu->executedInstructions += operation->instruction->fusedLength;
+
+        ProcessorErrorCode errorCode = operation->handler (spu, operation->instruction);
+
+        if (errorCode != NO_PROCESSOR_ERRORS) {
+            RETURN errorCode;
+        }
+    }
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static void DestroyBlock (TranslatedBlock *block) {
+    PushLog (3);
+
+    if (!block) {
+        RETURN;
+    }
+
+    free (block->instructions);
+    free (block->operations);
+    free (block);
+
+    RETURN;
+}
+
+// Returns the entry of the address or the free slot where it has to be added
+static TieredEntry *FindTieredEntry (TieredCache *cache, size_t address) {
+    PushLog (4);
+
+    size_t slotMask = cache->entriesCapacity - 1;
+
+    for (size_t slot = GetAddressSlot (address, cache->entriesCapacity); ; slot = (slot + 1) & slotMask) {
+        TieredEntry *entry = cache->entries + slot;
+
+        if (!entry->isUsed || entry->address == address) {
+            RETURN entry;
+        }
+    }
+}
+
+// Table is doubled at half load, so pointers to entries are valid only until the next addition
+static TieredEntry *AddTieredEntry (TieredCache *cache, size_t address) {
+    PushLog (3);
+
+    if ((cache->entriesCount + 1) * 2 > cache->entriesCapacity) {
+        TieredEntry *oldEntries  = cache->entries;
+        size_t       oldCapacity = cache->entriesCapacity;
+
+        TieredEntry *newEntries = (TieredEntry *) calloc (oldCapacity * 2, sizeof (TieredEntry));
+
+        if (!newEntries) {
+            RETURN NULL;
+        }
+
+        cache->entries         = newEntries;
+        cache->entriesCapacity = oldCapacity * 2;
+
+        for (size_t entryIndex = 0; entryIndex < oldCapacity; entryIndex++) {
+            if (oldEntries [entryIndex].isUsed) {
+                *FindTieredEntry (cache, oldEntries [entryIndex].address) = oldEntries [entryIndex];
+            }
+        }
+
+        free (oldEntries);
+    }
+
+    TieredEntry *entry = FindTieredEntry (cache, address);
+
+    entry->address = address;
+    entry->isUsed  = true;
+
+    cache->entriesCount++;
+
+    RETURN entry;
+}
+
+// Looks at the instruction before interpreter executes it. Wrong instruction is reported by the interpreter
+static InstructionFlow GetInstructionFlow (SPU *spu, size_t address) {
+    PushLog (3);
+
+    CommandCode commandCode = {0, 0};
+
+    if (!CopyVariableValue (&commandCode, spu->bytecode.buffer + address, sizeof (CommandCode))) {
+        RETURN LINEAR_FLOW;
+    }
+
+    const AssemblerInstruction *instruction = FindInstructionByOpcode (commandCode.opcode);
+
+    RETURN instruction ? instruction->flow : LINEAR_FLOW;
+}
@@ -0,0 +1,10 @@
+#ifndef TRANSLATOR_H_
+#define TRANSLATOR_H_
+
+#include "CommonModules.h"
+#include "SPU.h"
+
+// Writes C++ translation of binary. It has to be compiled with Translator/runtime in include path
+ProcessorErrorCode TranslateFile (int outFileDescriptor, SPU *spu, const char *binaryName);
+
+#endif
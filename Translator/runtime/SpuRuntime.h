@@ -0,0 +1,218 @@
+#ifndef SPU_RUNTIME_H_
+#define SPU_RUNTIME_H_
+
+// Runtime for programs produced by Translator. Translated file defines SPU_REGISTER_COUNT, SPU_RAM_SIZE,
+// SPU_VRAM_SIZE, SPU_BYTECODE_SIZE and SPU_COMPARISON_EPS before including it.
+// Every instruction NAME from Instructions.def is implemented by SPU_NAME macro
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+const size_t SPU_STACK_CAPACITY      = 1 << 16;
+const size_t SPU_CALL_STACK_CAPACITY = 1 << 16;
+
+struct SpuState {
+    double stack [SPU_STACK_CAPACITY]          = {};
+    size_t stackSize                           = 0;
+
+    size_t callStack [SPU_CALL_STACK_CAPACITY] = {};
+    size_t callStackSize                       = 0;
+
+    double registers [SPU_REGISTER_COUNT]      = {};
+    double ram [SPU_RAM_SIZE + SPU_VRAM_SIZE]  = {};
+
+    double tmpArgument                         = 0;
+};
+
+typedef void (*spuVramHook_t) (SpuState *spu, size_t address);
+
+// Called after every write to VRAM (addresses 0 ~ SPU_VRAM_SIZE - 1), e.g. to draw the pixel
+inline spuVramHook_t SpuVramHook = NULL;
+
+enum SpuComparisonResult {
+    SPU_GREATER = 1 << 0,
+    SPU_LESS    = 1 << 1,
+    SPU_EQUAL   = 1 << 2,
+};
+
+[[noreturn]] inline void SpuFail (const char *message) {
+    fprintf (stderr, "Runtime error: %s\n", message);
+    exit (EXIT_FAILURE);
+}
+
+inline void SpuPush (SpuState *spu, double value) {
+    if (spu->stackSize >= SPU_STACK_CAPACITY) {
+        SpuFail ("Stack overflow");
+    }
+
+    spu->stack [spu->stackSize++] = value;
+}
+
+inline double SpuPop (SpuState *spu) {
+    if (spu->stackSize == 0) {
+        SpuFail ("Pop from the empty stack");
+    }
+
+    return spu->stack [--spu->stackSize];
+}
+
+inline void SpuPushReturnAddress (SpuState *spu, size_t address) {
+    if (spu->callStackSize >= SPU_CALL_STACK_CAPACITY) {
+        SpuFail ("Call stack overflow");
+    }
+
+    spu->callStack [spu->callStackSize++] = address;
+}
+
+inline double SpuPopReturnAddress (SpuState *spu) {
+    if (spu->callStackSize == 0) {
+        SpuFail ("Return without call");
+    }
+
+    return (double) spu->callStack [--spu->callStackSize];
+}
+
+inline double *SpuMemory (SpuState *spu, double address) {
+    ssize_t index = (ssize_t) address;
+
+    if (index < 0 || index >= (ssize_t) (SPU_RAM_SIZE + SPU_VRAM_SIZE)) {
+        SpuFail ("Wrong memory address access attempt");
+    }
+
+    return spu->ram + index;
+}
+
+inline void SpuStore (SpuState *spu, double *destination, double value) {
+    *destination = value;
+
+    if (SpuVramHook && destination >= spu->ram && destination < spu->ram + SPU_VRAM_SIZE) {
+        SpuVramHook (spu, (size_t) (destination - spu->ram));
+    }
+}
+
+// Data directives of the source are placed to ram before the program starts
+inline void SpuLoadData (SpuState *spu, size_t address, const double *values, size_t count) {
+    memcpy (spu->ram + address, values, count * sizeof (double));
+
+    for (size_t index = address; SpuVramHook && index < address + count && index < SPU_VRAM_SIZE; index++) {
+        SpuVramHook (spu, index);
+    }
+}
+
+inline size_t SpuJumpAddress (double address) {
+    if ((ssize_t) address >= (ssize_t) SPU_BYTECODE_SIZE || address < 0) {
+        SpuFail ("Out of buffer jump attempt");
+    }
+
+    return (size_t) address;
+}
+
+inline int SpuCompare (double value1, double value2) {
+    if (value1 - value2 > SPU_COMPARISON_EPS) {
+        return SPU_GREATER;
+    } else if (value2 - value1 > SPU_COMPARISON_EPS) {
+        return SPU_LESS;
+    } else {
+        return SPU_EQUAL;
+    }
+}
+
+inline void SpuOut (SpuState *spu) {
+    printf ("%lg\n", SpuPop (spu));
+}
+
+// Translated program runs on a single core, so atomic instructions are plain memory operations
+inline void SpuAtomicAdd (SpuState *spu, double *destination) {
+    double value    = SpuPop (spu);
+    double oldValue = *destination;
+
+    SpuStore (spu, destination, oldValue + value);
+    SpuPush  (spu, oldValue);
+}
+
+inline void SpuCompareExchange (SpuState *spu, double *destination) {
+    double desired  = SpuPop (spu);
+    double expected = SpuPop (spu);
+    double oldValue = *destination;
+
+    if (memcmp (&oldValue, &expected, sizeof (double)) == 0) {
+        SpuStore (spu, destination, desired);
+    }
+
+    SpuPush (spu, oldValue);
+}
+
+inline void SpuIn (SpuState *spu) {
+    double value = 0;
+
+    if (scanf ("%lf", &value) != 1) {
+        SpuFail ("Unable to read value");
+    }
+
+    SpuPush (spu, value);
+}
+
+// Arguments
+#define SPU_IMMEDIATE(value)                    (spu->tmpArgument = (value))
+#define SPU_REGISTER(index)                     (spu->registers [index])
+#define SPU_REGISTER_IMMEDIATE(index, value)    (spu->tmpArgument = spu->registers [index] + (value))
+#define SPU_MEMORY(address)                     (*SpuMemory (spu, address))
+
+// Jumps. Dynamic jump needs jumpAddress variable and Dispatch label in translated function
+#define SPU_GOTO(label)                         goto label
+#define SPU_DYNAMIC_JUMP(address)               do { jumpAddress = SpuJumpAddress (address); goto Dispatch; } while (0)
+#define SPU_WRONG_JUMP()                        SpuFail ("Jump to the middle of an instruction")
+
+#define SPU_ARITHMETIC_(expression)                                                             \
+            do {                                                                                \
+                double value1 = SpuPop (spu);                                                   \
+                double value2 = SpuPop (spu);                                                   \
+                SpuPush (spu, expression);                                                      \
+            } while (0)
+
+#define SPU_CONDITIONAL_JUMP_(comparison, jump)                                                 \
+            do {                                                                                \
+                double value1 = SpuPop (spu);                                                   \
+                double value2 = SpuPop (spu);                                                   \
+                if (SpuCompare (value2, value1) & (comparison)) {                               \
+                    jump;                                                                       \
+                }                                                                               \
+            } while (0)
+
+#define SPU_hlt()                       return EXIT_SUCCESS
+#define SPU_out()                       SpuOut (spu)
+#define SPU_in()                        SpuIn (spu)
+#define SPU_push(argument)              SpuPush (spu, argument)
+#define SPU_pop(argument)               SpuStore (spu, &(argument), SpuPop (spu))
+#define SPU_add()                       SPU_ARITHMETIC_ (value1 + value2)
+#define SPU_sub()                       SPU_ARITHMETIC_ (value2 - value1)
+#define SPU_mul()                       SPU_ARITHMETIC_ (value1 * value2)
+#define SPU_div()                       SPU_ARITHMETIC_ (value2 / value1)
+#define SPU_sin()                       SpuPush (spu, sin  (SpuPop (spu)))
+#define SPU_cos()                       SpuPush (spu, cos  (SpuPop (spu)))
+#define SPU_sqrt()                      SpuPush (spu, sqrt (SpuPop (spu)))
+#define SPU_floor()                     SpuPush (spu, (double) (ssize_t) SpuPop (spu))
+#define SPU_jmp(jump)                   jump
+#define SPU_ja(jump)                    SPU_CONDITIONAL_JUMP_ (SPU_GREATER,             jump)
+#define SPU_jae(jump)                   SPU_CONDITIONAL_JUMP_ (SPU_GREATER | SPU_EQUAL, jump)
+#define SPU_jb(jump)                    SPU_CONDITIONAL_JUMP_ (SPU_LESS,                jump)
+#define SPU_jbe(jump)                   SPU_CONDITIONAL_JUMP_ (SPU_LESS    | SPU_EQUAL, jump)
+#define SPU_je(jump)                    SPU_CONDITIONAL_JUMP_ (SPU_EQUAL,               jump)
+#define SPU_jne(jump)                   SPU_CONDITIONAL_JUMP_ (SPU_LESS    | SPU_GREATER, jump)
+#define SPU_call(jump, returnAddress)   do { SpuPushReturnAddress (spu, returnAddress); jump; } while (0)
+#define SPU_ret()                       SPU_DYNAMIC_JUMP (SpuPopReturnAddress (spu))
+#define SPU_sleep(argument)             usleep ((useconds_t) (argument))
+#define SPU_core()                      SpuPush (spu, 0)
+#define SPU_cores()                     SpuPush (spu, 1)
+#define SPU_spawn(argument)             SpuFail ("No free cores to spawn")
+#define SPU_join()                      SpuPop (spu)
+#define SPU_aadd(argument)              SpuAtomicAdd       (spu, &(argument))
+#define SPU_cas(argument)               SpuCompareExchange (spu, &(argument))
+#define SPU_barrier()                   ((void) 0)
+
+#endif
@@ -0,0 +1,531 @@
+#include "Translator.h"
+#include "AssemblyHeader.h"
+#include "Buffer.h"
+#include "CommonModules.h"
+#include "CustomAssert.h"
+#include "FileIO.h"
+#include "MessageHandler.h"
+#include "Registers.h"
+#include "TextTypes.h"
+#include "Stack/Stack.h"
+#include "SPU.h"
+#include "DSLFunctions.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct TranslatedInstruction {
+    const AssemblerInstruction *instruction = NULL;
+    CommandCode commandCode                 = {0, 0};
+
+    unsigned char registerIndex             = REGISTER_COUNT;
+    elem_t immedArgument                    = NAN;
+
+    size_t address                          = 0;
+    size_t size                             = 0;        // encoded size in bytes
+};
+
+struct ProgramLabels {
+    bool *isInstructionStart = NULL;        // only these addresses can get labels
+    bool *isLabel            = NULL;        // address has a label in translated code
+    bool *isDispatchTarget   = NULL;        // address can be reached by a jump with computed address
+
+    bool hasDispatch         = false;
+};
+
+const size_t MAX_TRANSLATED_LINE_LENGTH = 512;
+const size_t TRANSLATED_COMMENT_COLUMN  = 56;
+const size_t TRANSLATED_DATA_PER_LINE   = 8;
+
+static ProcessorErrorCode ReadHeader      (SPU *spu, FileBuffer *constants, Buffer <char> *decompressedCode);
+static ProcessorErrorCode ReadInstruction (SPU *spu, Buffer <TranslatedInstruction> *instructions);
+
+static ProcessorErrorCode MarkLabels      (Buffer <TranslatedInstruction> *instructions, size_t bytecodeSize, ProgramLabels *labels);
+
+static ProcessorErrorCode WriteProgram     (Buffer <char> *output, Buffer <TranslatedInstruction> *instructions, ProgramLabels *labels,
+                                                FileBuffer *constants, size_t bytecodeSize, const char *binaryName);
+static ProcessorErrorCode WriteConstants   (Buffer <char> *output, FileBuffer *constants, bool writeLoads);
+static ProcessorErrorCode WriteInstruction (Buffer <char> *output, TranslatedInstruction *instruction, ProgramLabels *labels, size_t bytecodeSize);
+static ProcessorErrorCode WriteLine        (Buffer <char> *output, const char *format, ...) __attribute__ ((format (printf, 2, 3)));
+
+static void FormatNumber   (char *destination, elem_t number);
+static void FormatValue    (char *destination, TranslatedInstruction *instruction);
+static void FormatArgument (char *destination, TranslatedInstruction *instruction);
+static void FormatJump     (char *destination, TranslatedInstruction *instruction, ProgramLabels *labels, size_t bytecodeSize);
+
+ProcessorErrorCode TranslateFile (int outFileDescriptor, SPU *spu, const char *binaryName) {
+    PushLog (1);
+
+    custom_assert (spu,        pointer_is_null, NO_PROCESSOR);
+    custom_assert (binaryName, pointer_is_null, NO_BUFFER);
+
+    CheckBuffer (spu);
+
+    Buffer <TranslatedInstruction> instructions     = {};
+    Buffer <char>                  output           = {};
+    ProgramLabels                  labels           = {};
+    Buffer <char>                  decompressedCode = {};
+    FileBuffer                     constants        = {};
+
+    #define FreeDataAndReturnIfErrors(message, ...)                 \
+                do {                                                \
+                    ProcessorErrorCode errorCode_ = __VA_ARGS__;    \
+                    if (errorCode_ != NO_PROCESSOR_ERRORS) {        \
+                        DestroyBuffer (&instructions);              \
+                        DestroyBuffer (&output);                    \
+                        free (labels.isInstructionStart);           \
+                        free (labels.isLabel);                      \
+                        free (labels.isDispatchTarget);             \
+                        DestroyBuffer (&decompressedCode);          \
+                        ProgramErrorCheck (errorCode_, message);    \
+                    }                                               \
+                } while (0)
+
+    PrintSuccessMessage ("Reading header...", NULL);
+    FreeDataAndReturnIfErrors ("Invalid header readed", ReadHeader (spu, &constants, &decompressedCode));
+
+    size_t bytecodeSize = (size_t) spu->bytecode.buffer_size;
+
+    FreeDataAndReturnIfErrors ("Unable to create instructions buffer", InitBuffer (&instructions, bytecodeSize / 4 + 1));
+    FreeDataAndReturnIfErrors ("Unable to create output buffer",       InitBuffer (&output,       bytecodeSize * 16 + (size_t) constants.buffer_size * 4 + 1024));
+
+    PrintSuccessMessage ("Decoding instructions...", NULL);
+
+    while (spu->ip < bytecodeSize) {
+        FreeDataAndReturnIfErrors ("Error occuried while decoding instruction", ReadInstruction (spu, &instructions));
+    }
+
+    FreeDataAndReturnIfErrors ("Error occuried while resolving jump targets", MarkLabels (&instructions, bytecodeSize, &labels));
+
+    PrintSuccessMessage ("Writing translation...", NULL);
+
+    FreeDataAndReturnIfErrors ("Error occuried while generating translation",
+                                WriteProgram (&output, &instructions, &labels, &constants, bytecodeSize, binaryName));
+
+    if (!WriteBuffer (outFileDescriptor, output.data, (ssize_t) output.currentIndex)) {
+        FreeDataAndReturnIfErrors ("Error occuried while writing translation file", OUTPUT_FILE_ERROR);
+    }
+
+    DestroyBuffer (&instructions);
+    DestroyBuffer (&output);
+    free (labels.isInstructionStart);
+    free (labels.isLabel);
+    free (labels.isDispatchTarget);
+    DestroyBuffer (&decompressedCode);
+
+    #undef FreeDataAndReturnIfErrors
+
+    PrintSuccessMessage ("Translation finished successfully!", NULL);
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode ReadHeader (SPU *spu, FileBuffer *constants, Buffer <char> *decompressedCode) {
+    PushLog (2);
+
+    custom_assert (spu,              pointer_is_null, NO_PROCESSOR);
+    custom_assert (constants,        pointer_is_null, NO_BUFFER);
+    custom_assert (decompressedCode, pointer_is_null, NO_BUFFER);
+
+    BinaryContainer container {};
+    ProgramErrorCheck (OpenContainer (&container, &spu->bytecode), "Header is corrupted");
+
+    FileBuffer code = {};
+    ProgramErrorCheck (ReadSection (&container, CODE_SECTION, &code, decompressedCode), "Error occuried while reading code");
+    ProgramErrorCheck (GetSection  (&container, CONSTANTS_SECTION, constants),         "Error occuried while reading constants");
+
+    if (!code.buffer) {
+        ProgramErrorCheck (WRONG_HEADER, "Binary has no code");
+    }
+
+    spu->bytecode = code;
+    spu->ip       = 0;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode ReadInstruction (SPU *spu, Buffer <TranslatedInstruction> *instructions) {
+    PushLog (2);
+
+    CheckBuffer (spu);
+
+    TranslatedInstruction translatedInstruction = {};
+    translatedInstruction.address = spu->ip;
+
+    ReadData (spu, &translatedInstruction.commandCode, CommandCode);
+
+    translatedInstruction.instruction = FindInstructionByOpcode (translatedInstruction.commandCode.opcode);
+
+    if (!translatedInstruction.instruction) {
+        ProgramErrorCheck (WRONG_INSTRUCTION, "Wrong instruction readed");
+    }
+
+    unsigned char arguments    = translatedInstruction.commandCode.arguments;
+    size_t        bytecodeSize = (size_t) spu->bytecode.buffer_size;
+
+    if (!IsPermittedArguments (translatedInstruction.instruction->commandCode.arguments, arguments)) {
+        ProgramErrorCheck (WRONG_INSTRUCTION, "Instruction does not takes this set of arguments");
+    }
+
+    if ((arguments & REGISTER_ARGUMENT) && spu->ip + sizeof (unsigned char) > bytecodeSize) {
+        ProgramErrorCheck (BUFFER_ENDED, "Instruction arguments are truncated");
+    }
+
+    if (arguments & REGISTER_ARGUMENT) {
+        ReadData (spu, &translatedInstruction.registerIndex, unsigned char);
+
+        if (!FindRegisterByIndex (translatedInstruction.registerIndex)) {
+            ProgramErrorCheck (TOO_FEW_ARGUMENTS, "Wrong register index");
+        }
+    }
+
+    if (arguments & IMMED_ARGUMENT) {
+        ProcessorErrorCode errorCode = ReadImmediate (spu, &translatedInstruction.immedArgument);
+
+        if (errorCode != NO_PROCESSOR_ERRORS) {
+            ProgramErrorCheck (errorCode, "Wrong immediate argument");
+        }
+    }
+
+    translatedInstruction.size = spu->ip - translatedInstruction.address;
+
+    RETURN WriteDataToBuffer (instructions, &translatedInstruction, 1);
+}
+
+// Only jump targets get labels. Jumps with computed addresses can reach any instruction, ret - any instruction after call.
+// Static jump to the middle of an instruction gets no label and is translated as a wrong jump
+static ProcessorErrorCode MarkLabels (Buffer <TranslatedInstruction> *instructions, size_t bytecodeSize, ProgramLabels *labels) {
+    PushLog (2);
+
+    custom_assert (instructions, pointer_is_null, NO_BUFFER);
+    custom_assert (labels,       pointer_is_null, NO_BUFFER);
+
+    labels->isInstructionStart = (bool *) calloc (bytecodeSize + 1, sizeof (bool));
+    labels->isLabel            = (bool *) calloc (bytecodeSize + 1, sizeof (bool));
+    labels->isDispatchTarget   = (bool *) calloc (bytecodeSize + 1, sizeof (bool));
+
+    if (!labels->isInstructionStart || !labels->isLabel || !labels->isDispatchTarget) {
+        ProgramErrorCheck (NO_BUFFER, "Error occuried while allocating labels table");
+    }
+
+    for (size_t instructionIndex = 0; instructionIndex < instructions->currentIndex; instructionIndex++) {
+        labels->isInstructionStart [instructions->data [instructionIndex].address] = true;
+    }
+
+    bool hasComputedJumps = false;
+    bool hasReturns       = false;
+
+    for (size_t instructionIndex = 0; instructionIndex < instructions->currentIndex; instructionIndex++) {
+        TranslatedInstruction *instruction = instructions->data + instructionIndex;
+        InstructionFlow        flow        = instruction->instruction->flow;
+
+        if (flow == RETURN_FLOW) {
+            hasReturns = true;
+        }
+
+        if (flow != JUMP_FLOW && flow != CONDITIONAL_JUMP_FLOW && flow != CALL_FLOW) {
+            continue;
+        }
+
+        if (instruction->commandCode.arguments != IMMED_ARGUMENT) {
+            hasComputedJumps = true;
+        } else if (instruction->immedArgument >= 0 && instruction->immedArgument < (elem_t) bytecodeSize &&
+                    labels->isInstructionStart [(size_t) instruction->immedArgument]) {
+            labels->isLabel [(size_t) instruction->immedArgument] = true;
+        }
+    }
+
+    for (size_t instructionIndex = 0; instructionIndex < instructions->currentIndex; instructionIndex++) {
+        TranslatedInstruction *instruction = instructions->data + instructionIndex;
+
+        if (hasComputedJumps || (hasReturns && instructionIndex > 0 && (instruction - 1)->instruction->flow == CALL_FLOW)) {
+            labels->isDispatchTarget [instruction->address] = true;
+            labels->isLabel          [instruction->address] = true;
+        }
+    }
+
+    labels->hasDispatch = hasComputedJumps || hasReturns;
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+static ProcessorErrorCode WriteProgram (Buffer <char> *output, Buffer <TranslatedInstruction> *instructions, ProgramLabels *labels,
+                                            FileBuffer *constants, size_t bytecodeSize, const char *binaryName) {
+    PushLog (2);
+
+    custom_assert (output,       pointer_is_null, NO_BUFFER);
+    custom_assert (instructions, pointer_is_null, NO_BUFFER);
+    custom_assert (labels,       pointer_is_null, NO_BUFFER);
+    custom_assert (constants,    pointer_is_null, NO_BUFFER);
+
+    char epsilon [MAX_TRANSLATED_LINE_LENGTH] = "";
+    FormatNumber (epsilon, EPS);
+
+    #define WriteLineCheck(...) ProgramErrorCheck (WriteLine (output, __VA_ARGS__), "Error occuried while writing translation")
+
+    WriteLineCheck ("// Translated from %s", binaryName);
+    WriteLineCheck ("// Build: g++ -O3 -I <Processor>/Translator/runtime <this file>. Define SPU_NO_MAIN to use RunSpuProgram from your own code\n");
+    WriteLineCheck ("#define SPU_REGISTER_COUNT %lu", REGISTER_COUNT);
+    WriteLineCheck ("#define SPU_RAM_SIZE       %lu", RAM_SIZE);
+    WriteLineCheck ("#define SPU_VRAM_SIZE      %lu", VRAM_SIZE);
+    WriteLineCheck ("#define SPU_BYTECODE_SIZE  %lu", bytecodeSize);
+    WriteLineCheck ("#define SPU_COMPARISON_EPS %s\n", epsilon);
+    WriteLineCheck ("#include \"SpuRuntime.h\"\n");
+
+    ProgramErrorCheck (WriteConstants (output, constants, false), "Error occuried while writing constants");
+
+    WriteLineCheck ("int RunSpuProgram (SpuState *spu) {");
+
+    ProgramErrorCheck (WriteConstants (output, constants, true), "Error occuried while writing constants");
+
+    if (labels->hasDispatch) {
+        WriteLineCheck ("    size_t jumpAddress = 0;\n");
+    }
+
+    for (size_t instructionIndex = 0; instructionIndex < instructions->currentIndex; instructionIndex++) {
+        TranslatedInstruction *instruction = instructions->data + instructionIndex;
+
+        if (labels->isLabel [instruction->address]) {
+            WriteLineCheck ("L%lu:", instruction->address);
+        }
+
+        ProgramErrorCheck (WriteInstruction (output, instruction, labels, bytecodeSize), "Error occuried while writing instruction");
+    }
+
+    WriteLineCheck ("\n    return EXIT_SUCCESS;");
+
+    if (labels->hasDispatch) {
+        WriteLineCheck ("\nDispatch:");
+        WriteLineCheck ("    switch (jumpAddress) {");
+
+        for (size_t address = 0; address < bytecodeSize; address++) {
+            if (labels->isDispatchTarget [address]) {
+                WriteLineCheck ("        case %lu: goto L%lu;", address, address);
+            }
+        }
+
+        WriteLineCheck ("        default: SPU_WRONG_JUMP ();");
+        WriteLineCheck ("    }");
+    }
+
+    WriteLineCheck ("}\n");
+
+    WriteLineCheck ("#ifndef SPU_NO_MAIN");
+    WriteLineCheck ("int main () {");
+    WriteLineCheck ("    static SpuState state = {};\n");
+    WriteLineCheck ("    return RunSpuProgram (&state);");
+    WriteLineCheck ("}");
+    WriteLineCheck ("#endif");
+
+    #undef WriteLineCheck
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Every block of the constants section becomes an array, which is loaded at the beginning of RunSpuProgram
+static ProcessorErrorCode WriteConstants (Buffer <char> *output, FileBuffer *constants, bool writeLoads) {
+    PushLog (3);
+
+    custom_assert (output,    pointer_is_null, NO_BUFFER);
+    custom_assert (constants, pointer_is_null, NO_BUFFER);
+
+    #define WriteLineCheck(...) ProgramErrorCheck (WriteLine (output, __VA_ARGS__), "Error occuried while writing constants")
+
+    size_t blockIndex = 0;
+
+    for (size_t offset = 0; offset < (size_t) constants->buffer_size; blockIndex++) {
+        ConstantsBlock block  = {};
+        const char    *values = NULL;
+
+        ProcessorErrorCode errorCode = ReadConstantsBlock (constants, &offset, &block, &values);
+        ProgramErrorCheck (errorCode, "Constants section is corrupted");
+
+        if (writeLoads) {
+            bool isLastBlock = offset >= (size_t) constants->buffer_size;
+
+            WriteLineCheck ("    SpuLoadData (spu, %lu, SpuData%lu, %lu);%s", block.address, blockIndex, block.size, isLastBlock ? "\n" : "");
+            continue;
+        }
+
+        WriteLineCheck ("static const double SpuData%lu [] = {", blockIndex);
+
+        for (size_t valueIndex = 0; valueIndex < block.size; valueIndex += TRANSLATED_DATA_PER_LINE) {
+            char line [MAX_TRANSLATED_LINE_LENGTH] = "";
+            size_t lineLength = 0;
+
+            for (size_t index = valueIndex; index < block.size && index < valueIndex + TRANSLATED_DATA_PER_LINE; index++) {
+                char   number [MAX_TRANSLATED_LINE_LENGTH / TRANSLATED_DATA_PER_LINE] = "";
+                elem_t value = 0;
+
+                memcpy (&value, values + index * sizeof (elem_t), sizeof (elem_t));
+                FormatNumber (number, value);
+
+                lineLength += (size_t) snprintf (line + lineLength, MAX_TRANSLATED_LINE_LENGTH - lineLength, " %s,", number);
+            }
+
+            WriteLineCheck ("   %s", line);
+        }
+
+        WriteLineCheck ("};\n");
+    }
+
+    #undef WriteLineCheck
+
+    RETURN NO_PROCESSOR_ERRORS;
+}
+
+// Each instruction becomes SPU_NAME (...) macro call of the runtime. Arguments depend on instruction flow
+static ProcessorErrorCode WriteInstruction (Buffer <char> *output, TranslatedInstruction *instruction, ProgramLabels *labels, size_t bytecodeSize) {
+    PushLog (3);
+
+    char arguments [MAX_TRANSLATED_LINE_LENGTH] = "";
+
+    switch (instruction->instruction->flow) {
+        case JUMP_FLOW:
+        case CONDITIONAL_JUMP_FLOW:
+            FormatJump (arguments, instruction, labels, bytecodeSize);
+            break;
+
+        // call may be the last instruction, so return address is not taken from the next one
+        case CALL_FLOW:
+            FormatJump (arguments, instruction, labels, bytecodeSize);
+            snprintf (arguments + strlen (arguments), MAX_TRANSLATED_LINE_LENGTH - strlen (arguments),
+                        ", %lu", instruction->address + instruction->size);
+            break;
+
+        case LINEAR_FLOW:
+        case RETURN_FLOW:
+        case HALT_FLOW:
+        case SPAWN_FLOW:
+        default:
+            if (instruction->commandCode.arguments != NO_ARGUMENTS) {
+                FormatArgument (arguments, instruction);
+            }
+            break;
+    }
+
+    char call [MAX_TRANSLATED_LINE_LENGTH + MAX_INSTRUCTION_LENGTH] = "";
+    snprintf (call, sizeof (call), "SPU_%s (%s);", instruction->instruction->instructionName, arguments);
+
+    RETURN WriteLine (output, "    %-*s // %.4lu", (int) TRANSLATED_COMMENT_COLUMN, call, instruction->address);
+}
+
+static ProcessorErrorCode WriteLine (Buffer <char> *output, const char *format, ...) {
+    PushLog (4);
+
+    char line [MAX_TRANSLATED_LINE_LENGTH] = "";
+
+    va_list arguments;
+    va_start (arguments, format);
+
+    int lineLength = vsnprintf (line, MAX_TRANSLATED_LINE_LENGTH - 1, format, arguments);
+
+    va_end (arguments);
+
+    if (lineLength < 0 || (size_t) lineLength >= MAX_TRANSLATED_LINE_LENGTH - 1) {
+        ProgramErrorCheck (BUFFER_ENDED, "Translated line is too long");
+    }
+
+    line [lineLength++] = '\n';
+
+    RETURN WriteDataToBuffer (output, line, (size_t) lineLength);
+}
+
+// Hexadecimal floating literals keep immediates exact
+static void FormatNumber (char *destination, elem_t number) {
+    PushLog (4);
+
+    if (isnan (number)) {
+        sprintf (destination, "NAN");
+    } else if (isinf (number)) {
+        sprintf (destination, number > 0 ? "INFINITY" : "-INFINITY");
+    } else {
+        sprintf (destination, "%a", number);
+    }
+
+    RETURN;
+}
+
+// Value of argument without memory access
+static void FormatValue (char *destination, TranslatedInstruction *instruction) {
+    PushLog (4);
+
+    unsigned char arguments = instruction->commandCode.arguments;
+    char immediate [MAX_TRANSLATED_LINE_LENGTH / 4] = "";
+
+    FormatNumber (immediate, instruction->immedArgument);
+
+    if ((arguments & (IMMED_ARGUMENT | REGISTER_ARGUMENT)) == (IMMED_ARGUMENT | REGISTER_ARGUMENT)) {
+        sprintf (destination, "SPU_REGISTER (%u) + %s", instruction->registerIndex, immediate);
+    } else if (arguments & REGISTER_ARGUMENT) {
+        sprintf (destination, "SPU_REGISTER (%u)", instruction->registerIndex);
+    } else {
+        sprintf (destination, "%s", immediate);
+    }
+
+    RETURN;
+}
+
+// Argument as an lvalue, so pop can write into it
+static void FormatArgument (char *destination, TranslatedInstruction *instruction) {
+    PushLog (4);
+
+    unsigned char arguments = instruction->commandCode.arguments;
+    char value [MAX_TRANSLATED_LINE_LENGTH / 2] = "";
+
+    FormatValue (value, instruction);
+
+    if (arguments & MEMORY_ARGUMENT) {
+        sprintf (destination, "SPU_MEMORY (%s)", value);
+    } else if (arguments == REGISTER_ARGUMENT) {
+        sprintf (destination, "%s", value);
+    } else if (arguments & REGISTER_ARGUMENT) {
+        char immediate [MAX_TRANSLATED_LINE_LENGTH / 4] = "";
+        FormatNumber (immediate, instruction->immedArgument);
+
+        sprintf (destination, "SPU_REGISTER_IMMEDIATE (%u, %s)", instruction->registerIndex, immediate);
+    } else {
+        sprintf (destination, "SPU_IMMEDIATE (%s)", value);
+    }
+
+    RETURN;
+}
+
+// Static jump goes to the label of its target, so the target has to be marked by MarkLabels
+static void FormatJump (char *destination, TranslatedInstruction *instruction, ProgramLabels *labels, size_t bytecodeSize) {
+    PushLog (4);
+
+    if (instruction->commandCode.arguments != IMMED_ARGUMENT) {
+        char value [MAX_TRANSLATED_LINE_LENGTH / 2] = "";
+
+        if (instruction->commandCode.arguments & MEMORY_ARGUMENT) {
+            FormatArgument (value, instruction);
+        } else {
+            FormatValue (value, instruction);
+        }
+
+        sprintf (destination, "SPU_DYNAMIC_JUMP (%s)", value);
+        RETURN;
+    }
+
+    elem_t address = instruction->immedArgument;
+
+    if (address >= 0 && address < (elem_t) bytecodeSize && labels->isLabel [(size_t) address]) {
+        sprintf (destination, "SPU_GOTO (L%lu)", (size_t) address);
+    } else {
+        sprintf (destination, "SPU_WRONG_JUMP ()");
+    }
+
+    RETURN;
+}
+
+#define INSTRUCTION(NAME, COMMAND_CODE, FLOW, PROCESSOR_CALLBACK, DISASSEMBLER_CALLBACK)                \
+            INSTRUCTION_CALLBACK_FUNCTION (NAME) {                                                      \
+                return NO_PROCESSOR_ERRORS;                                                             \
+            }
+
+#include "Instructions.def"
+
+#undef INSTRUCTION
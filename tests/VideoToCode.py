@@ -22,6 +22,14 @@ with open (outFile, 'w') as file:
         image = cv2.cvtColor(image, cv2.COLOR_BGR2RGB) # remove for SMURRRRRFIKS
         rows, cols, _ = image.shape
 
+        # the first frame is loaded before the start, a column of pixels takes consecutive addresses
+        if count == 1:
+            for j in range (cols):
+                column = [int (channel) for i in range (rows) for channel in image [i, j]]
+                file.write (f".data [{j * dims [0] * 3}] {' '.join (map (str, column))}\n")
+
+            vramState = [int (channel) for j in range (cols) for i in range (rows) for channel in image [i, j]]
+
         for i in range (rows):
             for j in range (cols):
                 pixelAddress = (j * dims [0] + i) * 3
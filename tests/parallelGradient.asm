@@ -0,0 +1,104 @@
+; Draws a gradient with all cores: core n paints columns n, n + cores, n + 2 * cores...
+; and prints count of painted pixels. Run with --cores and --graphics flags
+
+cores
+pop rdx             ; cores count
+
+push 1
+pop rax             ; next core to spawn
+
+SpawnLoop:
+    push rax
+    push rdx
+    jae Worker      ; core 0 paints its columns too
+
+    spawn Worker
+    pop [rax+30010] ; spawned core id
+
+    push rax+1
+    pop rax
+    jmp SpawnLoop
+
+Worker:
+    core
+    pop rbx         ; column
+
+ColumnLoop:
+    push rbx
+    push 100
+    jae ColumnsDone
+
+    push 0
+    pop rcx         ; line
+
+    PixelLoop:
+        push rbx
+        push 100
+        mul
+        push rcx
+        add
+        push 3
+        mul
+        pop rgx     ; pixel address
+
+        push rbx
+        push 2.55
+        mul
+        pop [rgx]   ; red grows with column
+
+        push rcx
+        push 2.55
+        mul
+        pop [rgx+1] ; green grows with line
+
+        core
+        push 60
+        mul
+        pop [rgx+2] ; blue shows the core
+
+        push 1
+        aadd [30000]
+        pop rhx     ; painted pixels count before this one
+
+        push rcx+1
+        pop rcx
+
+        push rcx
+        push 100
+        jb PixelLoop
+
+    push rbx
+    push rdx
+    add
+    pop rbx
+    jmp ColumnLoop
+
+ColumnsDone:
+    barrier         ; every column is painted
+
+    core
+    push 0
+    je PrintCount
+    hlt
+
+PrintCount:
+    push [30000]
+    out
+
+    push 1
+    pop rax
+
+JoinLoop:
+    push rax
+    push rdx
+    jae Stop
+
+    push [rax+30010]
+    join
+
+    push rax+1
+    pop rax
+    jmp JoinLoop
+
+Stop:
+    hlt
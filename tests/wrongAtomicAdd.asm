@@ -0,0 +1,5 @@
+; aadd works on memory only, so the assembler must reject an immediate argument
+
+push 1
+aadd 5
+hlt
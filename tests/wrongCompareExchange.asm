@@ -0,0 +1,6 @@
+; cas works on memory only, so the assembler must reject a register argument
+
+push 0
+push 1
+cas rax
+hlt